@@ -44,7 +44,9 @@ SOFTWARE.
 using namespace Akamai::Mapper::RadixTree;
 
 // Typical round of typedefs to make the rest of the code more readable.
-using AlphabetTree10 = SimpleRadixTree<bool,26,10,10>;
+// Most nodes in a dictionary tree only have a handful of the 26 possible
+// children, so use the adaptive node rather than a full child array per node.
+using AlphabetTree10 = SimpleRadixTreeAdaptive<bool,26,10,10>;
 using Alphabet10Cursor = AlphabetTree10::CursorType;
 using Alphabet10CursorRO = AlphabetTree10::CursorROType;
 using AlphabetPath10 = SimplePath<26,10>;
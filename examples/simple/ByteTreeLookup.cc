@@ -0,0 +1,99 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "SimpleRadixTree.h"
+#include "RadixTree.h"
+#include "CursorOps.h"
+#include "SimplePath.h"
+
+// This example times longest prefix lookups in byte keyed (order 256) trees
+// using the three child storage strategies available for simple nodes:
+// a full child array per node, a hash map per node, and the adaptive
+// node whose small sorted key arrays are searched with SIMD compares.
+//
+// Usage: ByteTreeLookup [key count] [lookup count]
+
+using namespace Akamai::Mapper::RadixTree;
+
+constexpr std::size_t KeyDepth = 6;
+using BytePath = SimplePath<256,KeyDepth>;
+
+using ByteTreeArray = SimpleRadixTree<uint32_t,256,KeyDepth,1>;
+using ByteTreeMap = SimpleRadixTreeMap<uint32_t,256,KeyDepth,1>;
+using ByteTreeAdaptive = SimpleRadixTreeAdaptive<uint32_t,256,KeyDepth,1>;
+
+// Keys are drawn from a skewed byte distribution so that upper nodes are
+// dense and lower nodes sparse, roughly what text or address keys look like.
+std::vector<BytePath> makePaths(std::size_t count,std::mt19937_64& rng) {
+  std::geometric_distribution<std::size_t> byteDist(0.05);
+  std::uniform_int_distribution<std::size_t> lenDist(1,KeyDepth);
+  std::vector<BytePath> paths;
+  paths.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    BytePath p{};
+    std::size_t len = lenDist(rng);
+    for (std::size_t d = 0; d < len; ++d) { p.push_back(byteDist(rng) % 256); }
+    paths.push_back(p);
+  }
+  return paths;
+}
+
+template <typename TreeType>
+void timeTree(const std::string& name,const std::vector<BytePath>& keys,const std::vector<BytePath>& lookups) {
+  TreeType tree{};
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    cursorAddValueAt(tree.lookupCursorWO(),keys[i],static_cast<uint32_t>(i));
+  }
+  uint64_t checksum{0};
+  auto start = std::chrono::steady_clock::now();
+  for (const BytePath& p : lookups) {
+    auto c = tree.lookupCursorRO();
+    for (std::size_t d = 0; (d < p.size()) && c.canGoChildNode(p[d]); ++d) { c.goChild(p[d]); }
+    auto v = c.coveringNodeValueRO();
+    if (v.atValue()) { checksum += *v.getPtrRO(); }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  std::cout << name << ": " << (static_cast<double>(elapsed.count())/lookups.size()) << " ns/lookup"
+            << " (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc,const char** argv) {
+  std::size_t keyCount = ((argc > 1) ? std::strtoul(argv[1],nullptr,10) : 100000);
+  std::size_t lookupCount = ((argc > 2) ? std::strtoul(argv[2],nullptr,10) : 1000000);
+  std::mt19937_64 rng(42);
+  std::vector<BytePath> keys = makePaths(keyCount,rng);
+  std::vector<BytePath> lookups = makePaths(lookupCount,rng);
+
+  timeTree<ByteTreeArray>("child array   ",keys,lookups);
+  timeTree<ByteTreeMap>("child map     ",keys,lookups);
+  timeTree<ByteTreeAdaptive>("adaptive node ",keys,lookups);
+  return 0;
+}
@@ -24,6 +24,7 @@ SOFTWARE.
 */
 
 #include <exception>
+#include <stdexcept>
 #include <array>
 #include <string>
 #include <cstring>
@@ -27,6 +27,7 @@ SOFTWARE.
 #include <stdint.h>
 
 #include "NodeInterface.h"
+#include "InlineLeafNode.h"
 #include "BinaryWordEdge.h"
 #include "BinaryWordNode.h"
 #include "SimpleNodeImpl.h"
@@ -72,6 +73,19 @@ using BinaryRadixTree32 = RadixTree<BinaryPath<MaxDepth>,BinaryTreeNode32<ValueT
 template <typename ValueT,std::size_t MaxDepth,template <typename> class AllocatorT = AllocatorNew>
 using BinaryRadixTree64 = RadixTree<BinaryPath<MaxDepth>,BinaryTreeNode64<ValueT,AllocatorT>,SimpleFixedDepthStack>;
 
+/**
+ * \brief BinaryTreeNode32 whose small leaves are packed into the parent's child pointer.
+ *
+ * For integer values that fit in 48 bits, see InlineLeafNodeInterface. Leaves are packed by
+ * compact() and unpacked again as needed by later writes.
+ */
+template <typename ValueT,template <typename> class AllocatorT = AllocatorNew>
+using InlineLeafBinaryTreeNode32 = InlineLeafNodeInterface<AllocatorT<BinaryTreeSimpleNodeImpl<ValueT,SimpleBinaryWordEdge<uint32_t>,AllocatorT>>,
+                                                           BinaryTreeSimpleNodeImpl<ValueT,SimpleBinaryWordEdge<uint32_t>,AllocatorT>>;
+
+template <typename ValueT,std::size_t MaxDepth,template <typename> class AllocatorT = AllocatorNew>
+using InlineLeafBinaryRadixTree32 = RadixTree<BinaryPath<MaxDepth>,InlineLeafBinaryTreeNode32<ValueT,AllocatorT>,SimpleFixedDepthStack>;
+
 /**
  * \brief Vector "word" based tree, each node is stored in 4 uint32_t or uint64_t values.
  * 
@@ -81,6 +95,33 @@ using BinaryRadixTree64 = RadixTree<BinaryPath<MaxDepth>,BinaryTreeNode64<ValueT
 template <typename WordType,std::size_t MaxDepth>
 using BinaryWordTree = RadixTree<BinaryPath<MaxDepth>,BinaryWordNode<WordType,WordBlockVectorAllocator>,SimpleFixedDepthStack>;
 
+/**
+ * \brief BinaryWordTree variant whose nodes live in fixed size pages.
+ *
+ * Node refs stay valid and nothing is copied as the tree grows, at the cost of one extra
+ * indirection per node access.
+ */
+template <typename WordType,std::size_t MaxDepth>
+using PagedBinaryWordTree = RadixTree<BinaryPath<MaxDepth>,BinaryWordNode<WordType,WordBlockPagedAllocator>,SimpleFixedDepthStack>;
+
+/**
+ * \brief BinaryWordTree variant whose nodes carry EdgeWords extra words of edge.
+ *
+ * Aimed at sparse deep trees, e.g. IPv6, where long single child runs would otherwise
+ * need several chained nodes.
+ */
+template <typename WordType,std::size_t MaxDepth,std::size_t EdgeWords = 2>
+using LongEdgeBinaryWordTree = RadixTree<BinaryPath<MaxDepth>,BinaryWordLongEdgeNode<WordType,EdgeWords,WordBlockVectorAllocator>,SimpleFixedDepthStack>;
+
+/**
+ * \brief BinaryWordTree variant with values kept apart from the nodes, see BinaryWordSplitValueNode.
+ *
+ * Nodes are 3 words, values (any default constructible type) sit in a parallel array so
+ * lookups walk topology only.
+ */
+template <typename WordType,typename ValueT,std::size_t MaxDepth>
+using SplitValueBinaryWordTree = RadixTree<BinaryPath<MaxDepth>,BinaryWordSplitValueNode<WordType,ValueT>,SimpleFixedDepthStack>;
+
 template <std::size_t MaxDepth>
 using BinaryWordTree32 = BinaryWordTree<uint32_t,MaxDepth>;
 
@@ -100,6 +141,21 @@ using BinaryWordTree64 = BinaryWordTree<uint64_t,MaxDepth>;
 template <typename ValueT,typename WordType,std::size_t MaxDepth>
 using CompactBinaryWordTree = RadixTree<BinaryPath<MaxDepth>,CompactBinaryWordNode<ValueT,WordType,WordBlockVectorAllocator>,SimpleFixedDepthStack>;
 
+/**
+ * \brief CompactBinaryWordTree variant whose nodes live in fixed size pages.
+ */
+template <typename ValueT,typename WordType,std::size_t MaxDepth>
+using PagedCompactBinaryWordTree = RadixTree<BinaryPath<MaxDepth>,CompactBinaryWordNode<ValueT,WordType,WordBlockPagedAllocator>,SimpleFixedDepthStack>;
+
+/**
+ * \brief Two word node tree, left children are implicit (the next chunk), see ImplicitLeftBinaryWordNode.
+ *
+ * Half the size of BinaryWordTree, values are packed in with the edge as for
+ * CompactBinaryWordTree. Build it, then compact() to put every left child in place.
+ */
+template <typename ValueT,typename WordType,std::size_t MaxDepth>
+using ImplicitLeftBinaryWordTree = RadixTree<BinaryPath<MaxDepth>,ImplicitLeftBinaryWordNode<ValueT,WordType,WordBlockImplicitLeftAllocator>,SimpleFixedDepthStack>;
+
 template <std::size_t MaxDepth>
 using CompactBinaryBoolTree32 = CompactBinaryWordTree<bool,uint32_t,MaxDepth>;
 
@@ -0,0 +1,336 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_STRIDE_CURSOR_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_STRIDE_CURSOR_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdexcept>
+
+#include "BinaryStrideNode.h"
+#include "NodeValue.h"
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \file BinaryStrideCursor.h
+ * Cursors over BinaryStrideNode trees. They present the usual single bit positions;
+ * steps inside a stride node are bitmap tests on the node already loaded, only
+ * crossing into a child node touches new memory.
+ */
+
+/**
+ * \brief Read-only cursor for binary stride trees, full navigation allowed.
+ */
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+class BinaryStrideCursorRO {
+public:
+  static constexpr std::size_t Radix = 2;
+  static constexpr std::size_t MaxDepth = PathT::MaxDepth;
+  using PathType = PathT;
+  using Node = NodeT;
+  using NodeRef = BinaryStrideNodeRef<NodeT>;
+  using ValueType = typename NodeT::ValueType;
+  using NodeValueRO = Mapper::RadixTree::NodeValueRO<NodeRef>;
+  using NodeValue = NodeValueRO;
+
+  explicit BinaryStrideCursorRO(NodeT* root) { nodeStack_.push_back(NodePos{root,NodeT::RootPos}); }
+
+  PathType getPath() const { return curPath_; }
+  bool atNode() const { return (nodeStack_.back().node != nullptr); }
+  bool atLeafNode() const { return (atNode() && nodeStack_.back().node->isLeaf(nodeStack_.back().pos)); }
+  bool atValue() const { return (atNode() && nodeStack_.back().node->hasValue(nodeStack_.back().pos)); }
+  inline bool goChild(std::size_t child);
+  bool canGoChild(std::size_t /* child */) const { return (curPath_.size() < MaxDepth); }
+  bool canGoChildNode(std::size_t child) const {
+    return (canGoChild(child) && atNode() && nodeStack_.back().node->hasPosition(2*nodeStack_.back().pos + child));
+  }
+
+  inline bool goParent();
+  bool canGoParent() const { return (curPath_.size() > 0); }
+
+  NodeValueRO coveringNodeValueRO() const { return NodeValueRO{coveringRef()}; }
+  std::size_t coveringNodeValueDepth() const { return coveringDepth(); }
+  NodeValue nodeValue() const { return NodeValue{backRef()}; }
+  NodeValueRO nodeValueRO() const { return nodeValue(); }
+
+protected:
+  struct NodePos {
+    // Stride node holding this position, nullptr if the position isn't a node
+    NodeT* node{nullptr};
+    // Heap position inside the stride node
+    std::size_t pos{0};
+  };
+  using NodeStack = NodeStackT<NodePos,MaxDepth+1>;
+
+  NodeRef backRef() const { return (atNode() ? NodeRef{nodeStack_.back().node,nodeStack_.back().pos} : NodeRef{}); }
+  inline std::size_t coveringDepth() const;
+  inline NodeRef coveringRef() const;
+
+  PathType curPath_{};
+  NodeStack nodeStack_{};
+};
+
+/**
+ * \brief Read/write cursor for binary stride trees.
+ */
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+class BinaryStrideCursor
+  : public BinaryStrideCursorRO<PathT,NodeT,NodeStackT>
+{
+public:
+  using CursorROType = BinaryStrideCursorRO<PathT,NodeT,NodeStackT>;
+  using NodeRef = typename CursorROType::NodeRef;
+  using ValueType = typename CursorROType::ValueType;
+  using NodeValueRO = typename CursorROType::NodeValueRO;
+  using NodeValue = Mapper::RadixTree::NodeValue<NodeRef>;
+
+  explicit BinaryStrideCursor(NodeT* root) : CursorROType(root) {}
+
+  /**
+   * \brief Create a node at current position (and any missing nodes above it).
+   */
+  inline NodeValue addNode();
+  /**
+   * \brief Remove the node at the current position if it has no value and no children.
+   */
+  inline bool removeNode();
+  inline bool canRemoveNode() const;
+
+  NodeValue nodeValue() { return NodeValue{this->backRef()}; }
+  void setValue(const ValueType& v) { nodeValue().set(v); }
+  void setValue(ValueType&& v) { nodeValue().set(std::move(v)); }
+  inline bool clearValue();
+};
+
+/**
+ * \brief Lookup-only RO cursor for binary stride trees.
+ */
+template <typename PathT,typename NodeT>
+class BinaryStrideLookupCursorRO {
+public:
+  static constexpr std::size_t Radix = 2;
+  static constexpr std::size_t MaxDepth = PathT::MaxDepth;
+  using PathType = PathT;
+  using Node = NodeT;
+  using NodeRef = BinaryStrideNodeRef<NodeT>;
+  using ValueType = typename NodeT::ValueType;
+  using NodeValueRO = Mapper::RadixTree::NodeValueRO<NodeRef>;
+  using NodeValue = NodeValueRO;
+
+  explicit BinaryStrideLookupCursorRO(NodeT* root)
+    : node_(root)
+  {
+    if (root->hasValue(pos_)) { coveringNode_ = root; }
+  }
+
+  PathType getPath() const { return curPath_; }
+  bool atNode() const { return (node_ != nullptr); }
+  bool atLeafNode() const { return (atNode() && node_->isLeaf(pos_)); }
+  bool atValue() const { return (atNode() && node_->hasValue(pos_)); }
+  inline bool goChild(std::size_t child);
+  bool canGoChild(std::size_t) const { return (curPath_.size() < MaxDepth); }
+  bool canGoChildNode(std::size_t child) const {
+    return (canGoChild(child) && atNode() && node_->hasPosition(2*pos_ + child));
+  }
+
+  bool goParent() { throw std::runtime_error("BinaryStrideLookupCursorRO: can't return"); return false; }
+  bool canGoParent() const { return false; }
+
+  NodeValueRO coveringNodeValueRO() const {
+    return ((coveringNode_ != nullptr) ? NodeValueRO{NodeRef{coveringNode_,coveringPos_}} : NodeValueRO{});
+  }
+  std::size_t coveringNodeValueDepth() const { return coveringDepth_; }
+  NodeValue nodeValue() const { return (atNode() ? NodeValue{NodeRef{node_,pos_}} : NodeValue{}); }
+  NodeValueRO nodeValueRO() const { return nodeValue(); }
+
+private:
+  NodeT* node_{nullptr};
+  std::size_t pos_{NodeT::RootPos};
+  NodeT* coveringNode_{nullptr};
+  std::size_t coveringPos_{NodeT::RootPos};
+  std::size_t coveringDepth_{0};
+  PathType curPath_{};
+};
+
+/**
+ * \brief Write-only lookup cursor for binary stride trees, creates nodes on its way down.
+ */
+template <typename PathT,typename NodeT>
+class BinaryStrideLookupCursorWO {
+public:
+  static constexpr std::size_t Radix = 2;
+  static constexpr std::size_t MaxDepth = PathT::MaxDepth;
+  using PathType = PathT;
+  using Node = NodeT;
+  using NodeRef = BinaryStrideNodeRef<NodeT>;
+  using ValueType = typename NodeT::ValueType;
+  using NodeValueRO = Mapper::RadixTree::NodeValueRO<NodeRef>;
+  using NodeValue = Mapper::RadixTree::NodeValue<NodeRef>;
+
+  explicit BinaryStrideLookupCursorWO(NodeT* root) : node_(root) {}
+  BinaryStrideLookupCursorWO(const BinaryStrideLookupCursorWO& other) = delete;
+  BinaryStrideLookupCursorWO(BinaryStrideLookupCursorWO&& other) = default;
+  BinaryStrideLookupCursorWO& operator=(const BinaryStrideLookupCursorWO& other) = delete;
+  BinaryStrideLookupCursorWO& operator=(BinaryStrideLookupCursorWO&& other) = default;
+
+  PathType getPath() const { return curPath_; }
+  bool atNode() const { return true; }
+  bool atLeafNode() const { return node_->isLeaf(pos_); }
+  bool atValue() const { return node_->hasValue(pos_); }
+  bool goChild(std::size_t child) {
+    if (!canGoChild(child)) { return false; }
+    node_ = NodeT::addStep(node_,&pos_,child);
+    curPath_.push_back(child);
+    return true;
+  }
+  bool canGoChild(std::size_t) const { return (curPath_.size() < MaxDepth); }
+  bool canGoChildNode(std::size_t child) const { return (canGoChild(child) && node_->hasPosition(2*pos_ + child)); }
+
+  bool goParent() { throw std::runtime_error("BinaryStrideLookupCursorWO: can't return"); return false; }
+  bool canGoParent() const { return false; }
+
+  NodeValue nodeValue() { return NodeValue{NodeRef{node_,pos_}}; }
+  NodeValueRO nodeValueRO() const { return NodeValueRO{NodeRef{node_,pos_}}; }
+
+  NodeValue addNode() { return nodeValue(); }
+  bool removeNode() { throw std::runtime_error("BinaryStrideLookupCursorWO: can't remove nodes"); }
+  bool canRemoveNode() const { return false; }
+
+private:
+  NodeT* node_{nullptr};
+  std::size_t pos_{NodeT::RootPos};
+  PathType curPath_{};
+};
+
+////////////////////////////////////////////
+// IMPLEMENTATIONS - BinaryStrideCursorRO //
+////////////////////////////////////////////
+
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+bool BinaryStrideCursorRO<PathT,NodeT,NodeStackT>::goChild(std::size_t child) {
+  if (!canGoChild(child)) { return false; }
+  NodePos newPos = nodeStack_.back();
+  // Once off the tree we stay off, the position is tracked by the path alone.
+  if (newPos.node != nullptr) { newPos.node = NodeT::step(newPos.node,&newPos.pos,child); }
+  nodeStack_.push_back(newPos);
+  curPath_.push_back(child);
+  return true;
+}
+
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+bool BinaryStrideCursorRO<PathT,NodeT,NodeStackT>::goParent() {
+  if (curPath_.size() == 0) { return false; }
+  nodeStack_.pop_back();
+  curPath_.pop_back();
+  return true;
+}
+
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+std::size_t BinaryStrideCursorRO<PathT,NodeT,NodeStackT>::coveringDepth() const {
+  for (std::size_t d = nodeStack_.size(); d > 0; --d) {
+    const NodePos& p = nodeStack_[d - 1];
+    if ((p.node != nullptr) && p.node->hasValue(p.pos)) { return (d - 1); }
+  }
+  return 0;
+}
+
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+typename BinaryStrideCursorRO<PathT,NodeT,NodeStackT>::NodeRef
+BinaryStrideCursorRO<PathT,NodeT,NodeStackT>::coveringRef() const {
+  const NodePos& p = nodeStack_[coveringDepth()];
+  if ((p.node == nullptr) || !p.node->hasValue(p.pos)) { return NodeRef{}; }
+  return NodeRef{p.node,p.pos};
+}
+
+//////////////////////////////////////////
+// IMPLEMENTATIONS - BinaryStrideCursor //
+//////////////////////////////////////////
+
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+typename BinaryStrideCursor<PathT,NodeT,NodeStackT>::NodeValue
+BinaryStrideCursor<PathT,NodeT,NodeStackT>::addNode() {
+  auto& stack = this->nodeStack_;
+  if (this->atNode()) { return nodeValue(); }
+  // Find the deepest position on our path that is a node, then fill in
+  // everything between it and the current position.
+  std::size_t d = stack.size() - 1;
+  while (stack[d].node == nullptr) { --d; }
+  for (; (d + 1) < stack.size(); ++d) {
+    stack[d + 1].pos = stack[d].pos;
+    stack[d + 1].node = NodeT::addStep(stack[d].node,&(stack[d + 1].pos),this->curPath_[d]);
+  }
+  return nodeValue();
+}
+
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+bool BinaryStrideCursor<PathT,NodeT,NodeStackT>::canRemoveNode() const {
+  // No node at all here? Success.
+  if (!this->atNode()) { return true; }
+  // Can't remove values, children or the root
+  if (this->atValue() || (this->nodeStack_.size() <= 1)) { return false; }
+  return this->atLeafNode();
+}
+
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+bool BinaryStrideCursor<PathT,NodeT,NodeStackT>::removeNode() {
+  if (!this->atNode()) { return true; }
+  if (!canRemoveNode()) { return false; }
+  auto& stack = this->nodeStack_;
+  const auto& parent = stack[stack.size() - 2];
+  NodeT::removeStep(parent.node,parent.pos,this->curPath_[this->curPath_.size() - 1]);
+  stack.back().node = nullptr;
+  return true;
+}
+
+template <typename PathT,typename NodeT,template<typename,std::size_t> class NodeStackT>
+bool BinaryStrideCursor<PathT,NodeT,NodeStackT>::clearValue() {
+  if (!this->atValue()) { return false; }
+  nodeValue().clear();
+  return true;
+}
+
+//////////////////////////////////////////////////
+// IMPLEMENTATIONS - BinaryStrideLookupCursorRO //
+//////////////////////////////////////////////////
+
+template <typename PathT,typename NodeT>
+bool BinaryStrideLookupCursorRO<PathT,NodeT>::goChild(std::size_t child) {
+  if (!canGoChild(child)) { return false; }
+  if (node_ != nullptr) {
+    node_ = NodeT::step(node_,&pos_,child);
+    if ((node_ != nullptr) && node_->hasValue(pos_)) {
+      coveringNode_ = node_;
+      coveringPos_ = pos_;
+      coveringDepth_ = curPath_.size() + 1;
+    }
+  }
+  curPath_.push_back(child);
+  return true;
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_STRIDE_NODE_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_STRIDE_NODE_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \file BinaryStrideNode.h
+ * Multi-bit (Tree Bitmap style) node for binary trees. Each node covers StrideBits
+ * levels of the binary tree: the binary positions inside the node are tracked in
+ * bitmaps, values and child nodes are kept in arrays compressed by bitmap popcount.
+ */
+
+/**
+ * \brief Fixed size bitmap with popcount based rank, used for the stride node maps.
+ */
+template <std::size_t Bits>
+class BinaryStrideBitmap {
+public:
+  static constexpr std::size_t WordCount = (Bits + 63)/64;
+
+  bool test(std::size_t i) const { return ((words_[i/64] >> (i % 64)) & 0x1) != 0; }
+  void set(std::size_t i) { words_[i/64] |= (static_cast<uint64_t>(0x1) << (i % 64)); }
+  void reset(std::size_t i) { words_[i/64] &= ~(static_cast<uint64_t>(0x1) << (i % 64)); }
+
+  /**
+   * \brief Number of bits set below bit i, i.e. the index of bit i in a compressed array.
+   */
+  inline std::size_t rank(std::size_t i) const;
+
+  /**
+   * \brief Total number of bits set.
+   */
+  inline std::size_t count() const;
+
+private:
+  std::array<uint64_t,WordCount> words_{};
+};
+
+/**
+ * \brief Node covering StrideBits levels of a binary tree.
+ *
+ * Binary positions inside a node are numbered heap style: the node's own root is
+ * position 1 and the children of position p are 2p and 2p+1. Positions below
+ * SlotCount are inside the node, positions SlotCount..(2*SlotCount - 1) are the roots of
+ * child nodes, the child index being (position - SlotCount).
+ *
+ * Three bitmaps describe the node: which internal positions are binary tree nodes,
+ * which of those hold values, and which child nodes exist. Values and child pointers
+ * are stored densely in the order of their bitmap bits, so a position is located with
+ * a popcount rather than a pointer per binary step. Node positions are ancestor closed:
+ * every position on the way down to a node is itself a node, and a child node exists
+ * exactly when its root position is a node.
+ */
+template <typename ValueT,std::size_t StrideBits>
+class BinaryStrideNode {
+public:
+  static_assert((StrideBits >= 1) && (StrideBits <= 8),"BinaryStrideNode: stride must be 1..8 bits");
+  static constexpr std::size_t Stride = StrideBits;
+  static constexpr std::size_t SlotCount = (static_cast<std::size_t>(0x1) << StrideBits);
+  static constexpr std::size_t RootPos = 1;
+  using ValueType = ValueT;
+  using Bitmap = BinaryStrideBitmap<SlotCount>;
+
+  BinaryStrideNode() { nodeBits_.set(RootPos); }
+  BinaryStrideNode(const BinaryStrideNode& o) = delete;
+  BinaryStrideNode& operator=(const BinaryStrideNode& o) = delete;
+
+  static bool isInternal(std::size_t pos) { return (pos < SlotCount); }
+
+  bool hasNode(std::size_t pos) const { return nodeBits_.test(pos); }
+  bool hasValue(std::size_t pos) const { return valueBits_.test(pos); }
+  const ValueType& value(std::size_t pos) const { return values_[valueBits_.rank(pos)]; }
+  ValueType& value(std::size_t pos) { return values_[valueBits_.rank(pos)]; }
+  template <typename V>
+  inline void setValue(std::size_t pos,V&& v);
+  inline void clearValue(std::size_t pos);
+
+  /**
+   * \brief Return child node c (0..SlotCount-1), nullptr if it doesn't exist.
+   */
+  BinaryStrideNode* getChild(std::size_t c) const {
+    return (childBits_.test(c) ? children_[childBits_.rank(c)].get() : nullptr);
+  }
+
+  /**
+   * \brief True if the binary position pos (internal or child root) is a node.
+   */
+  bool hasPosition(std::size_t pos) const {
+    return (isInternal(pos) ? nodeBits_.test(pos) : childBits_.test(pos - SlotCount));
+  }
+
+  /**
+   * \brief True if the internal position pos has no binary children.
+   */
+  bool isLeaf(std::size_t pos) const { return !(hasPosition(2*pos) || hasPosition(2*pos + 1)); }
+
+  /**
+   * \brief Step from (n,*pos) to its binary child, returns the node holding the child (nullptr if none).
+   */
+  static inline BinaryStrideNode* step(BinaryStrideNode* n,std::size_t* pos,std::size_t child);
+
+  /**
+   * \brief As step(), but creates the child position if it doesn't exist.
+   */
+  static inline BinaryStrideNode* addStep(BinaryStrideNode* n,std::size_t* pos,std::size_t child);
+
+  /**
+   * \brief Remove the binary child of (n,pos), which must be a leaf without a value.
+   */
+  static inline void removeStep(BinaryStrideNode* n,std::size_t pos,std::size_t child);
+
+  /**
+   * \brief Number of binary positions in this node that are nodes.
+   */
+  std::size_t binaryNodeCount() const { return nodeBits_.count(); }
+  std::size_t valueCount() const { return values_.size(); }
+  std::size_t childCount() const { return children_.size(); }
+
+private:
+  Bitmap nodeBits_{};
+  Bitmap valueBits_{};
+  Bitmap childBits_{};
+  std::vector<ValueType> values_{};
+  std::vector<std::unique_ptr<BinaryStrideNode>> children_{};
+};
+
+/**
+ * \brief Flyweight for a single binary position inside a stride node.
+ *
+ * Provides the node side of the interface NodeValueRO/NodeValue expect, so stride cursors
+ * hand out the same value wrappers as the regular cursors.
+ */
+template <typename StrideNodeT>
+class BinaryStrideNodeRef {
+public:
+  using ValueType = typename StrideNodeT::ValueType;
+  static constexpr bool ValueIsCopy = false;
+
+  BinaryStrideNodeRef() = default;
+  BinaryStrideNodeRef(StrideNodeT* n,std::size_t pos) : node_(n), pos_(pos) {}
+
+  bool exists() const { return (node_ != nullptr); }
+  bool hasValue() const { return (exists() && node_->hasValue(pos_)); }
+  const ValueType& value() const { return node_->value(pos_); }
+  ValueType& value() { return node_->value(pos_); }
+  void setValue(const ValueType& v) { node_->setValue(pos_,v); }
+  void setValue(ValueType&& v) { node_->setValue(pos_,std::move(v)); }
+  void clearValue() { node_->clearValue(pos_); }
+
+private:
+  StrideNodeT* node_{nullptr};
+  std::size_t pos_{0};
+};
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <std::size_t Bits>
+std::size_t BinaryStrideBitmap<Bits>::rank(std::size_t i) const {
+  std::size_t r{0};
+  const std::size_t word = i/64;
+  for (std::size_t w = 0; w < word; ++w) { r += __builtin_popcountll(words_[w]); }
+  const uint64_t below = ((static_cast<uint64_t>(0x1) << (i % 64)) - 1);
+  return r + __builtin_popcountll(words_[word] & below);
+}
+
+template <std::size_t Bits>
+std::size_t BinaryStrideBitmap<Bits>::count() const {
+  std::size_t r{0};
+  for (uint64_t w : words_) { r += __builtin_popcountll(w); }
+  return r;
+}
+
+template <typename ValueT,std::size_t StrideBits>
+template <typename V>
+void BinaryStrideNode<ValueT,StrideBits>::setValue(std::size_t pos,V&& v) {
+  if (valueBits_.test(pos)) {
+    values_[valueBits_.rank(pos)] = std::forward<V>(v);
+  } else {
+    values_.emplace(values_.begin() + valueBits_.rank(pos),std::forward<V>(v));
+    valueBits_.set(pos);
+  }
+}
+
+template <typename ValueT,std::size_t StrideBits>
+void BinaryStrideNode<ValueT,StrideBits>::clearValue(std::size_t pos) {
+  if (!valueBits_.test(pos)) { return; }
+  values_.erase(values_.begin() + valueBits_.rank(pos));
+  valueBits_.reset(pos);
+}
+
+template <typename ValueT,std::size_t StrideBits>
+BinaryStrideNode<ValueT,StrideBits>*
+BinaryStrideNode<ValueT,StrideBits>::step(BinaryStrideNode* n,std::size_t* pos,std::size_t child) {
+  const std::size_t childPos = 2*(*pos) + child;
+  if (isInternal(childPos)) {
+    if (!n->nodeBits_.test(childPos)) { return nullptr; }
+    *pos = childPos;
+    return n;
+  }
+  *pos = RootPos;
+  return n->getChild(childPos - SlotCount);
+}
+
+template <typename ValueT,std::size_t StrideBits>
+BinaryStrideNode<ValueT,StrideBits>*
+BinaryStrideNode<ValueT,StrideBits>::addStep(BinaryStrideNode* n,std::size_t* pos,std::size_t child) {
+  const std::size_t childPos = 2*(*pos) + child;
+  if (isInternal(childPos)) {
+    n->nodeBits_.set(childPos);
+    *pos = childPos;
+    return n;
+  }
+  const std::size_t c = childPos - SlotCount;
+  *pos = RootPos;
+  const std::size_t r = n->childBits_.rank(c);
+  if (n->childBits_.test(c)) { return n->children_[r].get(); }
+  std::unique_ptr<BinaryStrideNode> newChild{new BinaryStrideNode{}};
+  n->children_.insert(n->children_.begin() + r,std::move(newChild));
+  n->childBits_.set(c);
+  return n->children_[r].get();
+}
+
+template <typename ValueT,std::size_t StrideBits>
+void BinaryStrideNode<ValueT,StrideBits>::removeStep(BinaryStrideNode* n,std::size_t pos,std::size_t child) {
+  const std::size_t childPos = 2*pos + child;
+  if (isInternal(childPos)) {
+    n->nodeBits_.reset(childPos);
+    return;
+  }
+  const std::size_t c = childPos - SlotCount;
+  if (!n->childBits_.test(c)) { return; }
+  n->children_.erase(n->children_.begin() + n->childBits_.rank(c));
+  n->childBits_.reset(c);
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_STRIDE_TREE_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_STRIDE_TREE_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <memory>
+
+#include "BinaryPath.h"
+#include "BinaryStrideCursor.h"
+#include "BinaryStrideNode.h"
+#include "SimpleStack.h"
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \brief Binary tree built from multi-bit stride nodes, same tree/cursor interface as RadixTree.
+ *
+ * The regular node types spend one node (and one dependent load) per binary step that
+ * isn't absorbed by an edge. Here each node covers StrideBits binary levels, so a lookup
+ * touches at most one node per StrideBits path bits while cursors still step one bit at
+ * a time. There are no edges: every position above a node is a node, so sparse deep
+ * trees cost more memory than the edge compressed variants.
+ */
+template <typename PathT,typename ValueT,std::size_t StrideBits = 4,template<typename,std::size_t> class NodeStackT = SimpleFixedDepthStack>
+class BinaryStrideTree {
+public:
+  static_assert(PathT::Radix == 2,"BinaryStrideTree: binary paths only");
+  static constexpr std::size_t Radix = 2;
+  static constexpr std::size_t MaxDepth = PathT::MaxDepth;
+  using PathType = PathT;
+  using NodeType = BinaryStrideNode<ValueT,StrideBits>;
+  using MyType = BinaryStrideTree<PathT,ValueT,StrideBits,NodeStackT>;
+
+  using CursorROType = BinaryStrideCursorRO<PathT,NodeType,NodeStackT>;
+  using CursorType = BinaryStrideCursor<PathT,NodeType,NodeStackT>;
+  using WalkCursorROType = CursorROType;
+  using LookupCursorROType = BinaryStrideLookupCursorRO<PathT,NodeType>;
+  using LookupCursorWOType = BinaryStrideLookupCursorWO<PathT,NodeType>;
+
+  using Value = ValueT;
+
+  BinaryStrideTree() = default;
+  BinaryStrideTree(const MyType& o) = delete;
+  MyType& operator=(const MyType& o) = delete;
+  BinaryStrideTree(MyType&& o) : root_(std::move(o.root_)) { o.clear(); }
+  MyType& operator=(MyType&& o) {
+    if (this != &o) {
+      root_ = std::move(o.root_);
+      o.clear();
+    }
+    return *this;
+  }
+  virtual ~BinaryStrideTree() = default;
+
+  /**
+   * \brief Destroy any existing tree, start with a new root.
+   */
+  void clear() { root_.reset(new NodeType{}); }
+
+  CursorROType cursorRO() const { return CursorROType{root_.get()}; }
+  CursorType cursor() { return CursorType{root_.get()}; }
+  WalkCursorROType walkCursorRO() const { return WalkCursorROType{root_.get()}; }
+  LookupCursorROType lookupCursorRO() const { return LookupCursorROType{root_.get()}; }
+  LookupCursorWOType lookupCursorWO() { return LookupCursorWOType{root_.get()}; }
+
+private:
+  std::unique_ptr<NodeType> root_{new NodeType{}};
+};
+
+/**
+ * \brief Convenience typedef - stride tree over a BinaryPath.
+ */
+template <typename ValueT,std::size_t MaxDepth,std::size_t StrideBits = 4>
+using BinaryPathStrideTree = BinaryStrideTree<BinaryPath<MaxDepth>,ValueT,StrideBits>;
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_BATCH_LOOKUP_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_BATCH_LOOKUP_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <array>
+#include <cstddef>
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \file BinaryWORMBatchLookup.h
+ * Covering value lookups for many paths at once, interleaved so their cache misses overlap.
+ *
+ * A single WORM lookup is a chain of dependent loads, one per node on the path, and on
+ * trees much larger than the cache nearly every one of them misses. The batch keeps
+ * BatchWidth lookups in flight (AMAC style): each one runs until its next step would read
+ * a node, prefetches that node and hands over to the next lookup. By the time it comes
+ * round again the node is usually in cache. Finished lookups are replaced by the next
+ * path straight away, so all lanes stay busy until the input runs out.
+ */
+
+/**
+ * \brief Result of one batch lookup: the covering value of the path, if any.
+ */
+template <typename ValueT>
+struct BinaryWORMLookupResult {
+  bool found{false};    ///< Whether a value covers the path.
+  ValueT value{};       ///< The covering value, default constructed if none.
+  std::size_t depth{0}; ///< Path length of the covering value.
+};
+
+/**
+ * \brief Look up the covering value of paths[0..count) into results[0..count).
+ *
+ * start is a lookup cursor at the tree root, as returned by lookupCursorRO() on
+ * BinaryWORMTree or BinaryWORMJumpTree; each lookup works on its own copy. Results match
+ * cursorGoto() on a fresh lookup cursor followed by coveringNodeValueRO() and
+ * coveringNodeValueDepth(). BatchWidth is the number of lookups in flight, 8-16 is
+ * usually enough to cover memory latency.
+ */
+template <std::size_t BatchWidth = 8,typename LookupCursorT,typename PathT>
+inline void
+lookupBinaryWORMBatch(const LookupCursorT& start,const PathT* paths,std::size_t count,
+                      BinaryWORMLookupResult<typename LookupCursorT::ValueType>* results);
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <std::size_t BatchWidth,typename LookupCursorT,typename PathT>
+void
+lookupBinaryWORMBatch(const LookupCursorT& start,const PathT* paths,std::size_t count,
+                      BinaryWORMLookupResult<typename LookupCursorT::ValueType>* results) {
+  static_assert(BatchWidth > 0,"lookupBinaryWORMBatch: BatchWidth must be > 0");
+  struct Lane {
+    LookupCursorT cursor{};
+    std::size_t path{0};
+    std::size_t step{0};
+    // Next node prefetched, take the step into it when resuming
+    bool stepPending{false};
+    bool active{false};
+  };
+  std::array<Lane,BatchWidth> lanes{};
+  std::size_t nextPath = 0;
+  std::size_t activeCount = 0;
+  auto startLane = [&](Lane& lane) {
+    lane.active = (nextPath < count);
+    if (!lane.active) { return; }
+    lane.cursor = start;
+    lane.path = nextPath++;
+    lane.step = 0;
+    lane.stepPending = false;
+    ++activeCount;
+  };
+  for (Lane& lane : lanes) { startLane(lane); }
+
+  while (activeCount > 0) {
+    for (Lane& lane : lanes) {
+      if (!lane.active) { continue; }
+      LookupCursorT& c = lane.cursor;
+      const PathT& p = paths[lane.path];
+      if (lane.stepPending) {
+        c.goChild(p[lane.step++]);
+        lane.stepPending = false;
+      }
+      // Run until the next step reads a node, or the lookup is done
+      bool finished = false;
+      while (!lane.stepPending) {
+        if (lane.step >= p.size()) { finished = true; break; }
+        const std::size_t child = p[lane.step];
+        if (c.jumpPending()) { c.goChild(child); ++lane.step; continue; }
+        const uint8_t* next = c.nextNode(child);
+        if (next != nullptr) {
+#if defined(__GNUC__)
+          __builtin_prefetch(next);
+#endif
+          lane.stepPending = true;
+        } else if (c.canGoChildNode(child)) {
+          c.goChild(child);
+          ++lane.step;
+        } else {
+          // Off the tree, nothing further down can cover the path
+          finished = true;
+          break;
+        }
+      }
+      if (finished) {
+        BinaryWORMLookupResult<typename LookupCursorT::ValueType>& r = results[lane.path];
+        auto v = c.coveringNodeValueRO();
+        r.found = (v.getPtrRO() != nullptr);
+        r.value = (r.found ? *v.getPtrRO() : typename LookupCursorT::ValueType{});
+        r.depth = c.coveringNodeValueDepth();
+        --activeCount;
+        startLane(lane);
+      }
+    }
+  }
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
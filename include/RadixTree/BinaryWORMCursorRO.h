@@ -27,6 +27,7 @@ SOFTWARE.
 #include <cstddef>
 
 #include "BinaryWORMNode.h"
+#include "BinaryWORMJumpTable.h"
 
 namespace Akamai {
 namespace Mapper {
@@ -126,6 +127,12 @@ private:
 
 /**
  * \brief Lookup-only RO cursor for binary WORM trees.
+ *
+ * Given a jump table (see BinaryWORMJumpTable.h) the cursor doesn't decode anything
+ * for the first JumpBits steps, it picks up its state from the table entry once it
+ * has all of them. Asking about the position in the middle of those steps falls back
+ * to walking from the root, so the table only pays off for lookups that go straight
+ * down (cursorGoto() and the like), not ones checking every step.
  */
 template <typename PathT,typename BinaryWORMNodeT>
 class BinaryWORMLookupCursorRO
@@ -142,27 +149,28 @@ public:
   using EdgeWordType = typename BinaryWORMNodeT::EdgeWordType;
 
   BinaryWORMLookupCursorRO() = default;
-  BinaryWORMLookupCursorRO(const uint8_t* rootPtr)
-    : nodeAtAbove_(rootPtr)
+  BinaryWORMLookupCursorRO(const uint8_t* rootPtr) : rootPtr_(rootPtr) { resetToRoot(); }
+  BinaryWORMLookupCursorRO(const uint8_t* rootPtr,const BinaryWORMJumpTable& jumpTable)
+    : rootPtr_(rootPtr)
+    , jumpTable_(jumpTable)
+    , jumpBits_(jumpTable.jumpBits())
   {
-    if (rootPtr == nullptr) { return; }
-    if (BinaryWORMNodeType{rootPtr}.hasValue()) {
-      coveringValueNode_ = rootPtr;
-      coveringValueNodeDepth_ = 0;
-    }
+    if (jumpBits_ > MaxDepth) { throw std::invalid_argument("BinaryWORMLookupCursorRO: jump table deeper than path"); }
+    resetToRoot();
   }
 
   // Interface methods start here
   
   PathType getPath() const { return curPath_; }
   
-  bool atNode() const { return (depthBelow_ == 0); }
+  bool atNode() const { resolveJump(); return (depthBelow_ == 0); }
   bool atValue() const { return (atNode() && coveringNode().hasValue()); }
   inline bool goChild(std::size_t child);
 
   bool canGoChild(std::size_t) const { return (curPath_.size() < MaxDepth); }
  
   bool canGoChildNode(std::size_t child) const {
+    resolveJump();
     if (depthBelow_ == 0) { return (coveringNode().getChild(child) != nullptr); }
     if (nodeBelow_ == nullptr) { return false; }
     return (firstEdgeStep() == child);
@@ -173,35 +181,70 @@ public:
   bool canGoParent() const { return false; }
 
   inline NodeValue coveringNodeValueRO() const;
-  std::size_t coveringNodeValueDepth() const { return coveringValueNodeDepth_; }
+  std::size_t coveringNodeValueDepth() const { resolveJump(); return coveringValueNodeDepth_; }
   inline NodeValue nodeValue() const;
   NodeValue nodeValueRO() const { return nodeValue(); }
 
   bool atLeafNode() const { return (atNode() && !(hasChildNode(0) || hasChildNode(1))); }
 
+  /**
+   * \brief Current state as a jump table entry, used to build jump tables.
+   */
+  inline BinaryWORMJumpEntry jumpEntry() const;
+
+  /**
+   * \brief True while the first jump table steps are still being collected.
+   */
+  bool jumpPending() const { return (jumpBits_ > 0); }
+
+  /**
+   * \brief Node goChild(child) is going to read, nullptr if it won't read one.
+   *
+   * Only at a node with that child, and never while a jump is pending. Used to
+   * prefetch the node before taking the step, see lookupBinaryWORMBatch().
+   */
+  const uint8_t* nextNode(std::size_t child) const {
+    return (((jumpBits_ == 0) && (depthBelow_ == 0)) ? coveringNode().getChild(child) : nullptr);
+  }
+
 private:
   using Node = BinaryWORMNodeType;
+  const uint8_t* rootPtr_{nullptr};
+  BinaryWORMJumpTable jumpTable_{};
+  // Steps still to take before jumping, 0 once jumped (or resolved the slow way).
+  // Everything below is mutable as the state is only filled in on demand
+  // while a jump is pending.
+  mutable std::size_t jumpBits_{0};
+  std::size_t jumpIndex_{0};
   // Reference to node at/above current position
-  const uint8_t* nodeAtAbove_{nullptr};
+  mutable const uint8_t* nodeAtAbove_{nullptr};
   // Steps below nodeRefAtAbove
-  std::size_t depthBelow_{0};
+  mutable std::size_t depthBelow_{0};
   // A node edge representing the rest of the steps below nodeRefAtAbove (if any)
-  EdgeWordType edgeToBelow_{0};
-  std::size_t edgeStepsRemaining_{0};
+  mutable EdgeWordType edgeToBelow_{0};
+  mutable std::size_t edgeStepsRemaining_{0};
   static std::size_t firstEdgeStep(EdgeWordType etb) { return (etb >> (8*sizeof(EdgeWordType) - 1)); }
   std::size_t firstEdgeStep() const { return firstEdgeStep(edgeToBelow_); }
-  void trimFirstEdgeStep() {
+  void trimFirstEdgeStep() const {
     if (edgeStepsRemaining_ > 0) {
       edgeToBelow_ = (edgeToBelow_ << 1);
       --edgeStepsRemaining_;
     }
   }
-  void clearEdge() { edgeStepsRemaining_ = 0; edgeToBelow_ = 0; }
+  void clearEdge() const { edgeStepsRemaining_ = 0; edgeToBelow_ = 0; }
   // Reference to node below the current position (if any)
-  const uint8_t* nodeBelow_{nullptr};
+  mutable const uint8_t* nodeBelow_{nullptr};
   bool edgeEmpty() const { return (edgeStepsRemaining_ == 0); }
-  const uint8_t* coveringValueNode_{nullptr};
-  std::size_t coveringValueNodeDepth_{0};
+  mutable const uint8_t* coveringValueNode_{nullptr};
+  mutable std::size_t coveringValueNodeDepth_{0};
+
+  inline void resetToRoot() const;
+  // Take one step from depth, the heart of goChild()
+  inline void stepChild(std::size_t child,std::size_t depth) const;
+  inline void jumpTo(const BinaryWORMJumpEntry& e) const;
+  // Mid-jump? Then walk from the root to where we are now.
+  void resolveJump() const { if ((jumpBits_ > 0) && !curPath_.empty()) { resolveJumpSlow(); } }
+  inline void resolveJumpSlow() const;
 
   BinaryWORMNodeType coveringNode() const { return BinaryWORMNodeType{nodeAtAbove_}; }
   BinaryWORMNodeType coveringValueNode() const { return BinaryWORMNodeType{coveringValueNode_}; }
@@ -285,6 +328,22 @@ BinaryWORMCursorRO<PathT,BinaryWORMNodeT,NodeStackT>::canGoChildNode(std::size_t
 template <typename PathT,typename BinaryWORMNodeT>
 bool BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::goChild(std::size_t child) {
   if (!canGoChild(child)) { return false; }
+  if (jumpBits_ > 0) {
+    jumpIndex_ = ((jumpIndex_ << 1) | child);
+    curPath_.push_back(child);
+    if (curPath_.size() == jumpBits_) {
+      jumpTo(jumpTable_.entry(jumpIndex_));
+      jumpBits_ = 0;
+    }
+    return true;
+  }
+  stepChild(child,curPath_.size());
+  curPath_.push_back(child);
+  return true;
+}
+
+template <typename PathT,typename BinaryWORMNodeT>
+void BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::stepChild(std::size_t child,std::size_t depth) const {
   if (depthBelow_ == 0) {
     // We're at a node, drop down into the immediate child
     nodeBelow_ = Node{nodeAtAbove_}.getChild(child);
@@ -310,19 +369,62 @@ bool BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::goChild(std::size_t child)
     nodeAtAbove_ = nodeBelow_;
     nodeBelow_ = nullptr;
     depthBelow_ = 0;
-    Node nodeAtAbove{nodeAtAbove_};
     if (Node{nodeAtAbove_}.hasValue()) {
       coveringValueNode_ = nodeAtAbove_;
-      coveringValueNodeDepth_ = curPath_.size() + 1;
+      coveringValueNodeDepth_ = depth + 1;
     }
   }
-  curPath_.push_back(child);
-  return true;
+}
+
+template <typename PathT,typename BinaryWORMNodeT>
+void BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::resetToRoot() const {
+  nodeAtAbove_ = rootPtr_;
+  depthBelow_ = 0;
+  clearEdge();
+  nodeBelow_ = nullptr;
+  coveringValueNode_ = nullptr;
+  coveringValueNodeDepth_ = 0;
+  if ((rootPtr_ != nullptr) && Node{rootPtr_}.hasValue()) { coveringValueNode_ = rootPtr_; }
+}
+
+template <typename PathT,typename BinaryWORMNodeT>
+void BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::jumpTo(const BinaryWORMJumpEntry& e) const {
+  static_assert(sizeof(EdgeWordType) <= sizeof(uint32_t),"BinaryWORMLookupCursorRO: edge word too large for jump table");
+  nodeAtAbove_ = rootPtr_ + e.nodeAtAbove;
+  nodeBelow_ = ((e.nodeBelow == BinaryWORMJumpEntry::NoNode) ? nullptr : (rootPtr_ + e.nodeBelow));
+  depthBelow_ = e.depthBelow;
+  edgeToBelow_ = static_cast<EdgeWordType>(e.edgeToBelow >> (8*(sizeof(uint32_t) - sizeof(EdgeWordType))));
+  edgeStepsRemaining_ = e.edgeStepsRemaining;
+  coveringValueNode_ = ((e.coveringValueNode == BinaryWORMJumpEntry::NoNode) ? nullptr : (rootPtr_ + e.coveringValueNode));
+  coveringValueNodeDepth_ = e.coveringValueNodeDepth;
+}
+
+template <typename PathT,typename BinaryWORMNodeT>
+void BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::resolveJumpSlow() const {
+  resetToRoot();
+  for (std::size_t i = 0; i < curPath_.size(); ++i) { stepChild(curPath_[i],i); }
+  jumpBits_ = 0;
+}
+
+template <typename PathT,typename BinaryWORMNodeT>
+BinaryWORMJumpEntry BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::jumpEntry() const {
+  static_assert(sizeof(EdgeWordType) <= sizeof(uint32_t),"BinaryWORMLookupCursorRO: edge word too large for jump table");
+  resolveJump();
+  BinaryWORMJumpEntry e;
+  e.nodeAtAbove = static_cast<uint32_t>(nodeAtAbove_ - rootPtr_);
+  if (nodeBelow_ != nullptr) { e.nodeBelow = static_cast<uint32_t>(nodeBelow_ - rootPtr_); }
+  if (coveringValueNode_ != nullptr) { e.coveringValueNode = static_cast<uint32_t>(coveringValueNode_ - rootPtr_); }
+  e.depthBelow = static_cast<uint8_t>(depthBelow_);
+  e.edgeStepsRemaining = static_cast<uint8_t>(edgeStepsRemaining_);
+  e.coveringValueNodeDepth = static_cast<uint8_t>(coveringValueNodeDepth_);
+  e.edgeToBelow = (static_cast<uint32_t>(edgeToBelow_) << (8*(sizeof(uint32_t) - sizeof(EdgeWordType))));
+  return e;
 }
 
 template <typename PathT,typename BinaryWORMNodeT>
 typename BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::NodeValue
 BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::coveringNodeValueRO() const {
+  resolveJump();
   if (coveringValueNode_ == nullptr) { return NodeValue{}; }
   Node coveringValueNode{coveringValueNode_};
   ValueType v{};
@@ -333,6 +435,7 @@ BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::coveringNodeValueRO() const {
 template <typename PathT,typename BinaryWORMNodeT>
 typename BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::NodeValue
 BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>::nodeValue() const {
+  resolveJump();
   Node nodeAtAbove{nodeAtAbove_};
   if (nodeAtAbove.hasValue() && (depthBelow_ == 0)) {
     ValueType v{};
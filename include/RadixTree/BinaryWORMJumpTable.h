@@ -0,0 +1,172 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_JUMP_TABLE_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_JUMP_TABLE_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+#include <stdexcept>
+
+#include "BinaryWORMNodeHeaderBytes.h"
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \file BinaryWORMJumpTable.h
+ * Optional section in front of a binary WORM tree root that lets lookups skip the
+ * (usually dense) top of the tree.
+ *
+ * The section is a direct indexed table over the first JumpBits steps of the path.
+ * Each entry holds the complete lookup cursor state after those steps: where the
+ * cursor sits relative to the nodes around it, and the covering value node and depth.
+ * All integers are little endian, node positions are byte offsets from the root.
+ * \verbatim
+   Header (16 bytes)
+     0: uint32 magic (BinaryWORMJumpTable::Magic)
+     4: uint8  format version
+     5: uint8  JumpBits
+     6: uint16 reserved, 0
+     8: uint64 root offset - section size, the tree root follows the section
+   Entries (EntrySize bytes each, 2^JumpBits of them, indexed by the first JumpBits path steps)
+     0: uint32 node at/above
+     4: uint32 node below + 1, 0 if none
+     8: uint32 covering value node + 1, 0 if none
+    12: uint8  steps below the node at/above
+    13: uint8  edge steps remaining to the node below
+    14: uint8  covering value depth
+    15: uint8  reserved, 0
+    16: uint32 edge bits to the node below, first step in the top bit
+   \endverbatim
+ */
+
+/**
+ * \brief Lookup cursor state at a jump table entry, node positions relative to the root.
+ */
+struct BinaryWORMJumpEntry {
+  static constexpr uint32_t NoNode = 0xFFFFFFFF;
+  uint32_t nodeAtAbove{0};
+  uint32_t nodeBelow{NoNode};
+  uint32_t coveringValueNode{NoNode};
+  uint8_t depthBelow{0};
+  uint8_t edgeStepsRemaining{0};
+  uint8_t coveringValueNodeDepth{0};
+  uint32_t edgeToBelow{0};
+};
+
+/**
+ * \brief Read-only view of a jump table section, see the file description for the layout.
+ *
+ * A default constructed table has no entries (JumpBits 0), lookup cursors then
+ * simply start at the root.
+ */
+class BinaryWORMJumpTable {
+public:
+  static constexpr uint32_t Magic = 0x544A5742; // "BWJT"
+  static constexpr uint8_t Version = 1;
+  static constexpr std::size_t HeaderSize = 16;
+  static constexpr std::size_t EntrySize = 20;
+  static constexpr std::size_t MaxJumpBits = 24;
+
+  BinaryWORMJumpTable() = default;
+  /**
+   * \brief View the section at the start of b, throws std::runtime_error if it isn't one.
+   */
+  inline BinaryWORMJumpTable(const uint8_t* b,std::size_t size);
+
+  std::size_t jumpBits() const { return jumpBits_; }
+  std::size_t rootOffset() const { return rootOffset_; }
+  inline BinaryWORMJumpEntry entry(std::size_t index) const;
+
+  static std::size_t sectionSize(std::size_t jumpBits) { return HeaderSize + (static_cast<std::size_t>(0x1) << jumpBits)*EntrySize; }
+  static inline void writeHeader(uint8_t* b,std::size_t jumpBits);
+  static inline void writeEntry(uint8_t* b,std::size_t index,const BinaryWORMJumpEntry& e);
+
+private:
+  using UInt8 = BinaryWORMNodeUIntOps<1,true>;
+  using UInt16 = BinaryWORMNodeUIntOps<2,true>;
+  using UInt32 = BinaryWORMNodeUIntOps<4,true>;
+  using UInt64 = BinaryWORMNodeUIntOps<8,true>;
+
+  const uint8_t* entries_{nullptr};
+  std::size_t jumpBits_{0};
+  std::size_t rootOffset_{0};
+};
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+BinaryWORMJumpTable::BinaryWORMJumpTable(const uint8_t* b,std::size_t size) {
+  if ((b == nullptr) || (size < HeaderSize) || (UInt32::readUInt(b) != Magic)) {
+    throw std::runtime_error("BinaryWORMJumpTable: no jump table section");
+  }
+  if (b[4] != Version) { throw std::runtime_error("BinaryWORMJumpTable: unsupported version"); }
+  jumpBits_ = b[5];
+  rootOffset_ = UInt64::readUInt(b + 8);
+  if ((jumpBits_ > MaxJumpBits) || (rootOffset_ != sectionSize(jumpBits_)) || (rootOffset_ >= size)) {
+    throw std::runtime_error("BinaryWORMJumpTable: corrupt jump table section");
+  }
+  entries_ = b + HeaderSize;
+}
+
+BinaryWORMJumpEntry BinaryWORMJumpTable::entry(std::size_t index) const {
+  const uint8_t* p = entries_ + index*EntrySize;
+  BinaryWORMJumpEntry e;
+  e.nodeAtAbove = UInt32::readUInt(p);
+  e.nodeBelow = UInt32::readUInt(p + 4) - 1;
+  e.coveringValueNode = UInt32::readUInt(p + 8) - 1;
+  e.depthBelow = p[12];
+  e.edgeStepsRemaining = p[13];
+  e.coveringValueNodeDepth = p[14];
+  e.edgeToBelow = UInt32::readUInt(p + 16);
+  return e;
+}
+
+void BinaryWORMJumpTable::writeHeader(uint8_t* b,std::size_t jumpBits) {
+  if (jumpBits > MaxJumpBits) { throw std::invalid_argument("BinaryWORMJumpTable: too many jump bits"); }
+  UInt32::writeUInt(b,Magic);
+  UInt8::writeUInt(b + 4,Version);
+  UInt8::writeUInt(b + 5,static_cast<uint8_t>(jumpBits));
+  UInt16::writeUInt(b + 6,0);
+  UInt64::writeUInt(b + 8,sectionSize(jumpBits));
+}
+
+void BinaryWORMJumpTable::writeEntry(uint8_t* b,std::size_t index,const BinaryWORMJumpEntry& e) {
+  uint8_t* p = b + HeaderSize + index*EntrySize;
+  UInt32::writeUInt(p,e.nodeAtAbove);
+  UInt32::writeUInt(p + 4,e.nodeBelow + 1);
+  UInt32::writeUInt(p + 8,e.coveringValueNode + 1);
+  p[12] = e.depthBelow;
+  p[13] = e.edgeStepsRemaining;
+  p[14] = e.coveringValueNodeDepth;
+  p[15] = 0;
+  UInt32::writeUInt(p + 16,e.edgeToBelow);
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
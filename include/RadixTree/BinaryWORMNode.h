@@ -97,15 +97,15 @@ private:
    std::size_t read(const uint8_t* valBuf,ValueType* valPtr) - read ValueType into *valPtr from valBuf, return bytes read
  * \endverbatim
  */
-template <std::size_t OFFSETSIZE,bool LITTLEENDIAN,typename ReadValueT>
+template <std::size_t OFFSETSIZE,bool LITTLEENDIAN,typename ReadValueT,template <std::size_t,bool> class HeaderBytesT = BinaryWORMNodeHeaderBytes>
 class BinaryWORMNodeRO
-  : public BinaryWORMNodeHeaderRO<OFFSETSIZE,LITTLEENDIAN>
+  : public BinaryWORMNodeHeaderRO<OFFSETSIZE,LITTLEENDIAN,HeaderBytesT>
 {
 public:
   using ReadValueType = ReadValueT;
-  using BaseType = BinaryWORMNodeHeaderRO<OFFSETSIZE,LITTLEENDIAN>;
+  using BaseType = BinaryWORMNodeHeaderRO<OFFSETSIZE,LITTLEENDIAN,HeaderBytesT>;
   using ValueType = typename ReadValueType::ValueType;
-  using HeaderBytes = BinaryWORMNodeHeaderBytes<OFFSETSIZE,LITTLEENDIAN>;
+  using HeaderBytes = HeaderBytesT<OFFSETSIZE,LITTLEENDIAN>;
   static constexpr bool VoidValue = std::is_same<ValueType,void>::value;
 
   BinaryWORMNodeRO() = default;
@@ -155,13 +155,13 @@ private:
    std::size_t write(const ValueType* valPtr,uint8_t* valBuf) - writes *valPtr to valBuf, returns bytes written 
  * \endverbatim
  */
-template <std::size_t OFFSETSIZE,bool LITTLEENDIAN,typename WriteValueT>
+template <std::size_t OFFSETSIZE,bool LITTLEENDIAN,typename WriteValueT,template <std::size_t,bool> class HeaderBytesT = BinaryWORMNodeHeaderBytes>
 class BinaryWORMNodeWO
-  : public BinaryWORMNodeHeaderRW<OFFSETSIZE,LITTLEENDIAN>
+  : public BinaryWORMNodeHeaderRW<OFFSETSIZE,LITTLEENDIAN,HeaderBytesT>
 {
 public:
   using WriteValueType = WriteValueT;
-  using BaseType = BinaryWORMNodeHeaderRW<OFFSETSIZE,LITTLEENDIAN>;
+  using BaseType = BinaryWORMNodeHeaderRW<OFFSETSIZE,LITTLEENDIAN,HeaderBytesT>;
   using ValueType = typename WriteValueT::ValueType;
   static constexpr bool VoidValue = std::is_same<ValueType,void>::value;
   BinaryWORMNodeWO() = default;
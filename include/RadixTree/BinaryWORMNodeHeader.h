@@ -37,10 +37,10 @@ namespace RadixTree {
 /**
  * \brief Wrapper class for the read-only version of our binary WORM node.
  */
-template <std::size_t OFFSETSIZE,bool LITTLEENDIAN>
+template <std::size_t OFFSETSIZE,bool LITTLEENDIAN,template <std::size_t,bool> class HeaderBytesT = BinaryWORMNodeHeaderBytes>
 class BinaryWORMNodeHeaderRO {
 public:
-  using HeaderBytes = BinaryWORMNodeHeaderBytes<OFFSETSIZE,LITTLEENDIAN>;
+  using HeaderBytes = HeaderBytesT<OFFSETSIZE,LITTLEENDIAN>;
   using OffsetType = typename HeaderBytes::OffsetType;
   static constexpr std::size_t Radix = 2;
   static constexpr std::size_t OffsetSize = OFFSETSIZE;
@@ -94,12 +94,12 @@ private:
  * 
  * Keeps writing state in an internal buffer.
  */
-template <std::size_t OFFSETSIZE,bool LITTLEENDIAN>
+template <std::size_t OFFSETSIZE,bool LITTLEENDIAN,template <std::size_t,bool> class HeaderBytesT = BinaryWORMNodeHeaderBytes>
 class BinaryWORMNodeHeaderRW
 {
 public:
-  using HeaderBytes = BinaryWORMNodeHeaderBytes<OFFSETSIZE,LITTLEENDIAN>;
-  using MyType = BinaryWORMNodeHeaderRW<OFFSETSIZE,LITTLEENDIAN>;
+  using HeaderBytes = HeaderBytesT<OFFSETSIZE,LITTLEENDIAN>;
+  using MyType = BinaryWORMNodeHeaderRW<OFFSETSIZE,LITTLEENDIAN,HeaderBytesT>;
   using OffsetType = typename HeaderBytes::OffsetType;
   static constexpr std::size_t Radix = 2;
   static constexpr std::size_t OffsetSize = OFFSETSIZE;
@@ -153,12 +153,10 @@ public:
       throw std::runtime_error("BinaryWORMNodeHeaderRW::edgePushBack: edge full");
     }
     std::size_t curStepCount = HeaderBytes::edgeStepCount(headerBytes_.data());
+    HeaderBytes::setEdgeStepCount(headerBytes_.data(),curStepCount + 1);
     HeaderBytes::setEdgeStepAt(headerBytes_.data(),curStepCount,step);
-    HeaderBytes::setEdgeStepCount(headerBytes_.data(),++curStepCount);
-  }
-  void copyEdgeFrom(const MyType& o) {
-    headerBytes_[0] = (headerBytes_[0] & HeaderBytes::MASK_ALL_EDGE_OUT) | (o.headerBytes_[0] & HeaderBytes::MASK_ALL_EDGE_IN);
   }
+  void copyEdgeFrom(const MyType& o) { HeaderBytes::copyEdge(headerBytes_.data(),o.headerBytes_.data()); }
   std::size_t writeHeader(uint8_t* b) const {
     if (b == nullptr) { throw std::runtime_error("BinaryWORMNodeHeaderRW: attempt to write to nullptr"); }
     std::memcpy(b,headerBytes_.data(),HeaderBytes::headerSize(headerBytes_.data()));
@@ -24,6 +24,8 @@ SOFTWARE.
 */
 
 #include <stdint.h>
+#include <cstring>
+#include <string>
 
 #include "RadixTreeUtils.h"
 
@@ -143,10 +145,103 @@ struct BinaryWORMNodeHeaderBytes {
   static uint8_t getEdgeBitsAsWord(const uint8_t* b) {
     return ((*b & EDGE_MASK) << (8 - EDGE_STEPCOUNT));
   }
+  static void copyEdge(uint8_t* dst,const uint8_t* src) { *dst = ((*dst & MASK_ALL_EDGE_OUT) | (*src & MASK_ALL_EDGE_IN)); }
   static std::size_t headerSize(const uint8_t* b) { return headerSize(hasChild(b,1) && hasChild(b,0)); }
   static std::size_t headerSize(bool hasBothChildren) { return (1 + (hasBothChildren ? OffsetSize : 0)); }
 };
 
+/**
+ * \brief Byte manipulation for a WORM node header with edges of up to 31 steps.
+ *
+ * The basic header only has room for 3 edge steps, so a long run of single child
+ * nodes (a lone /48 under a /16 in an IPv6 tree, say) gets written out as a chain of
+ * scaffolding nodes, one per 4 steps, each another hop on lookup. This header keeps
+ * the edge in bytes of its own so the whole run collapses into one node:
+ * \verbatim
+   Bit 7: 1/0 depending if node has/doesn't have a value
+   Bit 6: 1/0 depending if node has/doesn't have a "left" child (child 0)
+   Bit 5: 1/0 depending if node has/doesn't have a "right" child (child 1)
+   Bits 4-0: 5 bit integer, 0 - 31 as length of node edge
+ * \endverbatim
+ * Immediately following the metadata byte:
+ *  -# (edge length + 7)/8 bytes of edge steps, first step in the MSB of the first byte
+ *  -# If node has both children then OFFSETSIZE bytes representing the
+ *     offset of the right child (child 1). This offset is relative to the start of the node.
+ *  -# If node has a value then the bytes representing the value
+ *
+ * Nodes without an edge are the same size as with the basic header, 1 - 8 step edges
+ * cost one extra byte.
+ */
+template <std::size_t OFFSETSIZE,bool LITTLEENDIAN>
+struct BinaryWORMNodeHeaderLongEdgeBytes {
+  static constexpr std::size_t OffsetSize = OFFSETSIZE;
+  static_assert((OffsetSize <= 8) && (OffsetSize > 0),"Offset size must be > 0 bytes and <= 8");
+  static constexpr bool LittleEndian = LITTLEENDIAN;
+  static constexpr bool BigEndian = !LITTLEENDIAN;
+  using OffsetType = typename Utils::UIntRequired<8*OffsetSize>::type;
+  static constexpr std::size_t MaxEdgeSteps = 31;
+  static constexpr std::size_t MaxEdgeBytes = (MaxEdgeSteps + 7)/8;
+  static constexpr std::size_t MaxHeaderSize = (1 + MaxEdgeBytes + OffsetSize);
+  using EdgeWordType = uint32_t;
+  static_assert(8*sizeof(EdgeWordType) >= MaxEdgeSteps,"EdgeWordType too small for MaxEdgeSteps");
+  using UIntOps = BinaryWORMNodeUIntOps<OffsetSize,LittleEndian>;
+  static constexpr std::size_t Radix = 2;
+  static constexpr char HeaderTypeID[] = "AKAMAI-WORM-LONGEDGE";
+
+  static std::string headerTypeID() { static std::string hid = HeaderTypeID; return hid; }
+
+  static void clear(uint8_t* b) { *b = 0x0; }
+
+  static constexpr uint8_t MASK_HAS_CHILD(std::size_t c) { return ((c == 0) ? 0x40 : 0x20); };
+  static bool hasChild(const uint8_t* b,std::size_t c) { return ((MASK_HAS_CHILD(c) & *b) != 0); }
+  static void setHasChild(uint8_t* b,std::size_t c,bool hc) { *b = (hc ? (MASK_HAS_CHILD(c) | *b) : (~MASK_HAS_CHILD(c) & *b)); }
+  static OffsetType getRightChildOffset(const uint8_t* b) { return UIntOps::readUInt(b + 1 + edgeBytes(b)); }
+  static void setRightChildOffset(uint8_t* b,OffsetType o) { UIntOps::writeUInt(b + 1 + edgeBytes(b),o); }
+
+  static constexpr uint8_t MASK_HAS_VALUE = 0x80;
+  static bool hasValue(const uint8_t* b) { return ((*b & MASK_HAS_VALUE) != 0); }
+  static void setHasValue(uint8_t* b, bool hv) { *b = (hv ? (*b | MASK_HAS_VALUE) : (*b & ~MASK_HAS_VALUE)); }
+
+  static constexpr uint8_t MASK_STEPCOUNT = 0x1F;
+  static std::size_t edgeStepCount(const uint8_t* b) { return (*b & MASK_STEPCOUNT); }
+  static std::size_t edgeBytes(std::size_t sc) { return ((sc + 7)/8); }
+  static std::size_t edgeBytes(const uint8_t* b) { return edgeBytes(edgeStepCount(b)); }
+  /**
+   * \brief Set the edge length, moving any right child offset along if the edge changes byte count.
+   *
+   * Set the count before the steps - a step in a new edge byte lands where the offset used to be.
+   */
+  static void setEdgeStepCount(uint8_t* b,std::size_t sc) {
+    const std::size_t oldBytes = edgeBytes(b);
+    const std::size_t newBytes = edgeBytes(sc);
+    if ((oldBytes != newBytes) && hasChild(b,0) && hasChild(b,1)) {
+      std::memmove(b + 1 + newBytes,b + 1 + oldBytes,OffsetSize);
+    }
+    for (std::size_t i = oldBytes; i < newBytes; ++i) { b[1 + i] = 0x0; }
+    *b = ((*b & ~MASK_STEPCOUNT) | (static_cast<uint8_t>(sc) & MASK_STEPCOUNT));
+  }
+  static constexpr uint8_t ONE = 0x1;
+  static std::size_t edgeStepAt(const uint8_t* b,std::size_t es) { return ((b[1 + es/8] >> (7 - (es % 8))) & 0x1); }
+  static void setEdgeStepAt(uint8_t* b,std::size_t es,std::size_t sv) {
+    uint8_t& eb = b[1 + es/8];
+    const uint8_t bit = static_cast<uint8_t>(ONE << (7 - (es % 8)));
+    eb = ((sv == 0) ? (eb & ~bit) : (eb | bit));
+  }
+  // return the edge bits (if any) in the top N bits of a uint32_t
+  static EdgeWordType getEdgeBitsAsWord(const uint8_t* b) {
+    const std::size_t sc = edgeStepCount(b);
+    if (sc == 0) { return 0; }
+    EdgeWordType w{0};
+    for (std::size_t i = 0; i < edgeBytes(sc); ++i) { w |= (static_cast<EdgeWordType>(b[1 + i]) << (8*(sizeof(EdgeWordType) - i - 1))); }
+    return (w & ~((static_cast<EdgeWordType>(0x1) << (8*sizeof(EdgeWordType) - sc)) - 1));
+  }
+  static void copyEdge(uint8_t* dst,const uint8_t* src) {
+    setEdgeStepCount(dst,edgeStepCount(src));
+    std::memcpy(dst + 1,src + 1,edgeBytes(src));
+  }
+  static std::size_t headerSize(const uint8_t* b) { return (1 + edgeBytes(b) + ((hasChild(b,1) && hasChild(b,0)) ? OffsetSize : 0)); }
+};
+
 } // namespace RadixTree
 } // namespace Mapper
 } // namespace Akamai
@@ -25,7 +25,11 @@ SOFTWARE.
 
 #include <stdint.h>
 #include <array>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 
+#include "BinaryWORMBatchLookup.h"
 #include "BinaryWORMCursorRO.h"
 #include "SimpleStack.h"
 
@@ -66,6 +70,16 @@ public:
   CursorROType walkCursorRO() const { return CursorROType{buffer().data()}; }
   LookupCursorROType lookupCursorRO() const { return LookupCursorROType{buffer().data()}; }
 
+  /**
+   * \brief Covering values of paths[0..count), lookups interleaved to overlap cache misses.
+   *
+   * See lookupBinaryWORMBatch().
+   */
+  template <std::size_t BatchWidth = 8,typename LookupPathT>
+  void lookupBatch(const LookupPathT* paths,std::size_t count,BinaryWORMLookupResult<typename LookupCursorROType::ValueType>* results) const {
+    lookupBinaryWORMBatch<BatchWidth>(lookupCursorRO(),paths,count,results);
+  }
+
 private:
   Buffer buffer_{};
 };
@@ -76,6 +90,74 @@ private:
 template <typename PathT,typename BinaryWORMNodeHeaderT>
 using BinaryWORMTreeVector = BinaryWORMTree<std::vector<uint8_t>,PathT,BinaryWORMNodeHeaderT>;
 
+/**
+ * \brief BinaryWORMTree whose buffer starts with a jump table section, see BinaryWORMJumpTable.h.
+ *
+ * Lookup cursors start from the jump table, walk cursors from the root. Build the buffer
+ * with addBinaryWORMJumpTable().
+ */
+template <typename BufferT,typename PathT,typename BinaryWORMNodeHeaderT>
+class BinaryWORMJumpTree {
+public:
+  using PathType = PathT;
+  using CursorROType = BinaryWORMCursorRO<PathT,BinaryWORMNodeHeaderT,SimpleFixedDepthStack>;
+  using CursorType = CursorROType;
+  using LookupCursorROType = BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeHeaderT>;
+  using ValueTypeRO = typename CursorROType::ValueType;
+  using ValueType = ValueTypeRO;
+  using Buffer = BufferT;
+
+  BinaryWORMJumpTree() = default;
+  BinaryWORMJumpTree(const Buffer& b) : buffer_(b) { readJumpTable(); }
+  BinaryWORMJumpTree(Buffer&& b) : buffer_(std::move(b)) { readJumpTable(); }
+  virtual ~BinaryWORMJumpTree() = default;
+
+  void setBuffer(const Buffer& b) { buffer_ = b; readJumpTable(); }
+  void setBuffer(Buffer&& b) { buffer_ = std::move(b); readJumpTable(); }
+  const Buffer& buffer() const { return buffer_; }
+  Buffer extractBuffer() { jumpTable_ = BinaryWORMJumpTable{}; return std::move(buffer_); }
+  const BinaryWORMJumpTable& jumpTable() const { return jumpTable_; }
+
+  CursorType cursor() const { return cursorRO(); }
+  CursorROType cursorRO() const { return CursorROType{root()}; }
+  CursorROType walkCursorRO() const { return CursorROType{root()}; }
+  LookupCursorROType lookupCursorRO() const { return LookupCursorROType{root(),jumpTable_}; }
+
+  /**
+   * \brief Covering values of paths[0..count), lookups interleaved to overlap cache misses.
+   *
+   * See lookupBinaryWORMBatch().
+   */
+  template <std::size_t BatchWidth = 8,typename LookupPathT>
+  void lookupBatch(const LookupPathT* paths,std::size_t count,BinaryWORMLookupResult<typename LookupCursorROType::ValueType>* results) const {
+    lookupBinaryWORMBatch<BatchWidth>(lookupCursorRO(),paths,count,results);
+  }
+
+private:
+  const uint8_t* root() const { return buffer_.data() + jumpTable_.rootOffset(); }
+  void readJumpTable() { jumpTable_ = BinaryWORMJumpTable{buffer_.data(),buffer_.size()}; }
+
+  Buffer buffer_{};
+  BinaryWORMJumpTable jumpTable_{};
+};
+
+/**
+ * \brief Pick the jump table size for a tree of treeSize bytes.
+ *
+ * The largest table (up to 16 bits) costing no more than about a quarter of the tree itself.
+ */
+inline std::size_t chooseBinaryWORMJumpBits(std::size_t treeSize,std::size_t maxDepth);
+
+/**
+ * \brief Write a jump table section for the tree in treeBytes followed by a copy of the tree into buffer.
+ *
+ * The buffer manager needs resize() and data(), as for BinaryWORMTreeBuilder. Trees have to be
+ * under 4GB as the table holds 32 bit offsets.
+ */
+template <typename PathT,typename BinaryWORMNodeT,typename BufferT>
+inline typename std::decay<BufferT>::type
+addBinaryWORMJumpTable(const uint8_t* treeBytes,std::size_t treeSize,std::size_t jumpBits,BufferT&& buffer);
+
 /**
  * \brief Wraps a uint8_t* pointer for use by a WORM tree, no ownership implied.
  */
@@ -143,6 +225,45 @@ private:
 // IMPLEMENTATIONS //
 /////////////////////
 
+std::size_t chooseBinaryWORMJumpBits(std::size_t treeSize,std::size_t maxDepth) {
+  std::size_t jumpBits = 0;
+  while ((jumpBits < 16) && (jumpBits < maxDepth) &&
+         ((BinaryWORMJumpTable::sectionSize(jumpBits + 1) - BinaryWORMJumpTable::HeaderSize) <= treeSize/4)) {
+    ++jumpBits;
+  }
+  return jumpBits;
+}
+
+// Write the entries for every path below c down to jumpBits, index being c's path so far
+template <typename LookupCursorT>
+void fillBinaryWORMJumpTable(uint8_t* section,const LookupCursorT& c,std::size_t depth,std::size_t jumpBits,std::size_t index) {
+  if (depth == jumpBits) {
+    BinaryWORMJumpTable::writeEntry(section,index,c.jumpEntry());
+    return;
+  }
+  for (std::size_t child = 0; child < 2; ++child) {
+    LookupCursorT next{c};
+    next.goChild(child);
+    fillBinaryWORMJumpTable(section,next,depth + 1,jumpBits,(index << 1) | child);
+  }
+}
+
+template <typename PathT,typename BinaryWORMNodeT,typename BufferT>
+typename std::decay<BufferT>::type
+addBinaryWORMJumpTable(const uint8_t* treeBytes,std::size_t treeSize,std::size_t jumpBits,BufferT&& buffer) {
+  using BufferType = typename std::decay<BufferT>::type;
+  if ((treeBytes == nullptr) || (treeSize == 0)) { throw std::invalid_argument("addBinaryWORMJumpTable: empty tree"); }
+  if (treeSize >= std::numeric_limits<uint32_t>::max()) { throw std::invalid_argument("addBinaryWORMJumpTable: tree too large"); }
+  if (jumpBits > PathT::MaxDepth) { throw std::invalid_argument("addBinaryWORMJumpTable: jump bits exceed path depth"); }
+  const std::size_t sectionSize = BinaryWORMJumpTable::sectionSize(jumpBits);
+  BufferType out{std::move(buffer)};
+  out.resize(sectionSize + treeSize);
+  BinaryWORMJumpTable::writeHeader(out.data(),jumpBits);
+  std::memcpy(out.data() + sectionSize,treeBytes,treeSize);
+  fillBinaryWORMJumpTable(out.data(),BinaryWORMLookupCursorRO<PathT,BinaryWORMNodeT>{out.data() + sectionSize},0,jumpBits,0);
+  return out;
+}
+
 } // namespace RadixTree
 } // namespace Mapper
 } // namespace Akamai
@@ -0,0 +1,441 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_TREE_FILE_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_TREE_FILE_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "BinaryWORMNode.h"
+#include "BinaryWORMNodeHeaderBytes.h"
+#include "BinaryWORMTreeUInt.h"
+#include "BinaryWORMTreeUIntBuilder.h"
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \file BinaryWORMTreeFile.h
+ * On-disk container for UInt binary WORM trees, opened in place through a read-only
+ * memory mapping (POSIX mmap).
+ *
+ * The file is a fixed header followed by the tree bytes exactly as the builder wrote
+ * them, so opening a file is a mapping plus a header check and the tree is never copied.
+ * All header integers are little endian.
+ * \verbatim
+   Header (BinaryWORMFileHeader::Size bytes)
+     0: uint64 magic (BinaryWORMFileHeader::Magic)
+     8: uint32 format version
+    12: uint32 header size
+    16: uint8  tree is little endian
+    17: uint8  tree offset size
+    18: uint8  tree value size
+    19: uint8  reserved, 0
+    20: uint32 reserved, 0
+    24: uint64 root offset - file position of the tree root
+    32: uint64 tree size in bytes
+    40: uint64 tree checksum, see binaryWORMChecksum()
+    48: char[32] header type ID, zero padded
+    80: char[32] value type ID, zero padded
+   \endverbatim
+ * Readers use the root offset from the file, so later versions can grow the header
+ * without moving older readers off the tree.
+ */
+
+/**
+ * \brief 64 bit checksum of a buffer, eight bytes per step.
+ *
+ * Not cryptographic, meant to catch truncated or corrupted files.
+ */
+inline uint64_t binaryWORMChecksum(const uint8_t* b,std::size_t size);
+
+/**
+ * \brief Decoded file header, see the file description for the layout.
+ */
+struct BinaryWORMFileHeader {
+  static constexpr uint64_t Magic = 0x4D524F57544B4141ULL; // "AAKTWORM"
+  static constexpr uint32_t Version = 1;
+  static constexpr std::size_t Size = 112;
+  static constexpr std::size_t TypeIDSize = 32;
+
+  uint32_t version{Version};
+  BinaryWORMTreeUIntParams treeParams{};
+  uint64_t rootOffset{Size};
+  uint64_t treeSize{0};
+  uint64_t checksum{0};
+  std::string headerTypeID{};
+  std::string valueTypeID{};
+
+  inline void write(uint8_t* b) const;
+
+  /**
+   * \brief Decode the header at the start of a fileSize byte file.
+   *
+   * Throws std::runtime_error if it isn't a WORM tree file, was written by a newer
+   * format version, or the tree doesn't fit in the file.
+   */
+  static inline BinaryWORMFileHeader read(const uint8_t* b,std::size_t fileSize);
+
+private:
+  using UInt8 = BinaryWORMNodeUIntOps<1,true>;
+  using UInt32 = BinaryWORMNodeUIntOps<4,true>;
+  using UInt64 = BinaryWORMNodeUIntOps<8,true>;
+};
+
+/**
+ * \brief Type IDs of the node header and values of UInt trees with parameters treeParams.
+ */
+inline std::string binaryWORMUIntHeaderTypeID(const BinaryWORMTreeUIntParams& treeParams);
+inline std::string binaryWORMUIntValueTypeID(const BinaryWORMTreeUIntParams& treeParams);
+
+/**
+ * \brief How MmapBufferRO maps a file.
+ *
+ * The defaults keep opening cheap regardless of file size: pages are faulted in by the
+ * first lookups that touch them, with kernel readahead started in the background.
+ */
+struct MmapBufferOptions {
+  bool populate{false};     ///< MAP_POPULATE where available, the open blocks until every page is mapped.
+  bool willNeed{true};      ///< madvise(MADV_WILLNEED), start reading the file in without blocking.
+  bool randomAccess{false}; ///< madvise(MADV_RANDOM), no readahead around lookup faults.
+  bool warmUp{false};       ///< Touch every page from a background thread.
+};
+
+/**
+ * \brief Read-only memory mapping of a whole file, usable as a WORM tree buffer manager.
+ *
+ * data()/size() are a view into the mapping, the whole file unless setView() narrowed it,
+ * so a tree can sit behind a file header. Moves keep the mapping at the same address;
+ * the optional warm-up thread is stopped and joined before the file is unmapped.
+ */
+class MmapBufferRO {
+public:
+  MmapBufferRO() = default;
+
+  /**
+   * \brief Map the file at path, throws std::system_error if it can't be opened or mapped.
+   */
+  inline explicit MmapBufferRO(const std::string& path,const MmapBufferOptions& options = MmapBufferOptions{});
+
+  MmapBufferRO(const MmapBufferRO& o) = delete;
+  MmapBufferRO& operator=(const MmapBufferRO& o) = delete;
+  MmapBufferRO(MmapBufferRO&& o) : mapping_(std::move(o.mapping_)), view_(o.view_), viewSize_(o.viewSize_) { o.view_ = nullptr; o.viewSize_ = 0; }
+  MmapBufferRO& operator=(MmapBufferRO&& o) {
+    if (this != &o) {
+      mapping_ = std::move(o.mapping_);
+      view_ = o.view_; viewSize_ = o.viewSize_;
+      o.view_ = nullptr; o.viewSize_ = 0;
+    }
+    return *this;
+  }
+  virtual ~MmapBufferRO() = default;
+
+  const uint8_t* data() const { return view_; }
+  std::size_t size() const { return viewSize_; }
+  const uint8_t* mapData() const { return (mapping_ ? mapping_->bytes : nullptr); }
+  std::size_t mapSize() const { return (mapping_ ? mapping_->size : 0); }
+
+  /**
+   * \brief Restrict data()/size() to size bytes at offset in the file, throws std::out_of_range.
+   */
+  inline void setView(std::size_t offset,std::size_t size);
+
+  /**
+   * \brief True once the warm-up thread has touched every page (always true without one).
+   */
+  bool warmedUp() const { return (!mapping_ || mapping_->warm.load()); }
+
+  /**
+   * \brief Block until the warm-up thread is done.
+   */
+  void waitForWarmUp() { if (mapping_ && mapping_->warmer.joinable()) { mapping_->warmer.join(); } }
+
+private:
+  struct Mapping {
+    const uint8_t* bytes{nullptr};
+    std::size_t size{0};
+    std::thread warmer{};
+    std::atomic<bool> stop{false};
+    std::atomic<bool> warm{true};
+    inline ~Mapping();
+  };
+
+  static inline void warmUp(Mapping* m);
+
+  std::unique_ptr<Mapping> mapping_{};
+  const uint8_t* view_{nullptr};
+  std::size_t viewSize_{0};
+};
+
+/**
+ * \brief Write a UInt WORM tree container file.
+ *
+ * The file is written next to path and renamed into place, so processes that still have
+ * the previous file mapped keep a consistent tree. Throws std::system_error on I/O errors.
+ */
+inline void writeBinaryWORMTreeUIntFile(const std::string& path,const BinaryWORMTreeUIntParams& treeParams,
+                                        const uint8_t* tree,std::size_t treeSize);
+
+template <typename PathT>
+inline void writeBinaryWORMTreeUIntFile(const std::string& path,const BinaryWORMTreeUIntGeneric<PathT>& tree) {
+  writeBinaryWORMTreeUIntFile(path,tree.treeParams(),tree.bytes(),tree.bytesSize());
+}
+
+/**
+ * \brief Map a file from writeBinaryWORMTreeUIntFile() and return the tree, without copying it.
+ *
+ * Only the header is checked unless verifyChecksum is set, which reads the whole tree.
+ * Throws std::system_error if the file can't be mapped and std::runtime_error if it isn't
+ * a valid UInt WORM tree file.
+ */
+template <typename PathT>
+inline
+BinaryWORMTreeUIntGeneric<PathT>
+openBinaryWORMTreeUIntFile(const std::string& path,const MmapBufferOptions& options = MmapBufferOptions{},
+                           bool verifyChecksum = false);
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+uint64_t binaryWORMChecksum(const uint8_t* b,std::size_t size) {
+  using UInt64 = BinaryWORMNodeUIntOps<8,true>;
+  constexpr uint64_t Prime = 0x100000001B3ULL;
+  uint64_t h = 0xCBF29CE484222325ULL ^ size;
+  std::size_t i = 0;
+  for (; (i + 8) <= size; i += 8) {
+    uint64_t w;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    std::memcpy(&w,b + i,sizeof(w));
+#else
+    w = UInt64::readUInt(b + i);
+#endif
+    h = (h ^ w)*Prime;
+    h ^= (h >> 29);
+  }
+  for (; i < size; ++i) { h = (h ^ b[i])*Prime; }
+  return (h ^ (h >> 32));
+}
+
+void BinaryWORMFileHeader::write(uint8_t* b) const {
+  std::memset(b,0,Size);
+  UInt64::writeUInt(b,Magic);
+  UInt32::writeUInt(b + 8,version);
+  UInt32::writeUInt(b + 12,static_cast<uint32_t>(Size));
+  UInt8::writeUInt(b + 16,treeParams.isLittleEndian ? 1 : 0);
+  UInt8::writeUInt(b + 17,static_cast<uint8_t>(treeParams.offsetSize));
+  UInt8::writeUInt(b + 18,static_cast<uint8_t>(treeParams.valueSize));
+  UInt64::writeUInt(b + 24,rootOffset);
+  UInt64::writeUInt(b + 32,treeSize);
+  UInt64::writeUInt(b + 40,checksum);
+  if ((headerTypeID.size() >= TypeIDSize) || (valueTypeID.size() >= TypeIDSize)) {
+    throw std::invalid_argument("BinaryWORMFileHeader: type ID too long");
+  }
+  std::memcpy(b + 48,headerTypeID.data(),headerTypeID.size());
+  std::memcpy(b + 80,valueTypeID.data(),valueTypeID.size());
+}
+
+BinaryWORMFileHeader BinaryWORMFileHeader::read(const uint8_t* b,std::size_t fileSize) {
+  if ((fileSize < Size) || (UInt64::readUInt(b) != Magic)) {
+    throw std::runtime_error("BinaryWORMFileHeader: not a WORM tree file");
+  }
+  BinaryWORMFileHeader h{};
+  h.version = UInt32::readUInt(b + 8);
+  if ((h.version == 0) || (h.version > Version)) {
+    throw std::runtime_error("BinaryWORMFileHeader: unsupported format version " + std::to_string(h.version));
+  }
+  h.treeParams.isLittleEndian = (UInt8::readUInt(b + 16) != 0);
+  h.treeParams.offsetSize = UInt8::readUInt(b + 17);
+  h.treeParams.valueSize = UInt8::readUInt(b + 18);
+  h.rootOffset = UInt64::readUInt(b + 24);
+  h.treeSize = UInt64::readUInt(b + 32);
+  h.checksum = UInt64::readUInt(b + 40);
+  h.headerTypeID.assign(reinterpret_cast<const char*>(b + 48),strnlen(reinterpret_cast<const char*>(b + 48),TypeIDSize));
+  h.valueTypeID.assign(reinterpret_cast<const char*>(b + 80),strnlen(reinterpret_cast<const char*>(b + 80),TypeIDSize));
+  if ((h.rootOffset < UInt32::readUInt(b + 12)) || (h.rootOffset > fileSize) || (h.treeSize > (fileSize - h.rootOffset))) {
+    throw std::runtime_error("BinaryWORMFileHeader: tree doesn't fit in the file");
+  }
+  return h;
+}
+
+// Runtime lookup of BinaryWORMReadWriteUInt<VALUESIZE,LITTLEENDIAN>::valueTypeID()
+template <bool LITTLEENDIAN,std::size_t VALUESIZE = sizeof(uint64_t)>
+struct BinaryWORMUIntValueTypeID {
+  static std::string get(std::size_t valueSize) {
+    return ((valueSize == VALUESIZE) ? BinaryWORMReadWriteUInt<VALUESIZE,LITTLEENDIAN>::valueTypeID()
+                                     : BinaryWORMUIntValueTypeID<LITTLEENDIAN,VALUESIZE - 1>::get(valueSize));
+  }
+};
+
+template <bool LITTLEENDIAN>
+struct BinaryWORMUIntValueTypeID<LITTLEENDIAN,0> {
+  static std::string get(std::size_t) { return std::string{}; }
+};
+
+std::string binaryWORMUIntHeaderTypeID(const BinaryWORMTreeUIntParams& treeParams) {
+  // The header type doesn't depend on the offset size
+  return (treeParams.isLittleEndian ? BinaryWORMNodeHeaderBytes<1,true>::headerTypeID()
+                                    : BinaryWORMNodeHeaderBytes<1,false>::headerTypeID());
+}
+
+std::string binaryWORMUIntValueTypeID(const BinaryWORMTreeUIntParams& treeParams) {
+  return (treeParams.isLittleEndian ? BinaryWORMUIntValueTypeID<true>::get(treeParams.valueSize)
+                                    : BinaryWORMUIntValueTypeID<false>::get(treeParams.valueSize));
+}
+
+MmapBufferRO::Mapping::~Mapping() {
+  stop.store(true);
+  if (warmer.joinable()) { warmer.join(); }
+  if (bytes != nullptr) { ::munmap(const_cast<uint8_t*>(bytes),size); }
+}
+
+void MmapBufferRO::warmUp(Mapping* m) {
+  const std::size_t pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  uint8_t sink{0};
+  for (std::size_t i = 0; (i < m->size) && !m->stop.load(std::memory_order_relaxed); i += pageSize) {
+    sink ^= *static_cast<const volatile uint8_t*>(m->bytes + i);
+  }
+  static_cast<void>(sink);
+  m->warm.store(true);
+}
+
+MmapBufferRO::MmapBufferRO(const std::string& path,const MmapBufferOptions& options)
+  : mapping_(new Mapping())
+{
+  int fd = ::open(path.c_str(),O_RDONLY);
+  if (fd < 0) { throw std::system_error(errno,std::generic_category(),"MmapBufferRO: open " + path); }
+  struct stat st;
+  if (::fstat(fd,&st) != 0) {
+    int e = errno;
+    ::close(fd);
+    throw std::system_error(e,std::generic_category(),"MmapBufferRO: stat " + path);
+  }
+  const std::size_t fileBytes = static_cast<std::size_t>(st.st_size);
+  if (fileBytes == 0) {
+    ::close(fd);
+    throw std::system_error(EINVAL,std::generic_category(),"MmapBufferRO: empty file " + path);
+  }
+  int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+  if (options.populate) { flags |= MAP_POPULATE; }
+#endif
+  void* m = ::mmap(nullptr,fileBytes,PROT_READ,flags,fd,0);
+  int e = errno;
+  ::close(fd);
+  if (m == MAP_FAILED) { throw std::system_error(e,std::generic_category(),"MmapBufferRO: mmap " + path); }
+  mapping_->bytes = static_cast<const uint8_t*>(m);
+  mapping_->size = fileBytes;
+  // Advice is only a hint, failures are ignored
+  if (options.randomAccess) { ::madvise(m,fileBytes,MADV_RANDOM); }
+  if (options.willNeed) { ::madvise(m,fileBytes,MADV_WILLNEED); }
+  if (options.warmUp) {
+    mapping_->warm.store(false);
+    mapping_->warmer = std::thread(&MmapBufferRO::warmUp,mapping_.get());
+  }
+  view_ = mapping_->bytes;
+  viewSize_ = mapping_->size;
+}
+
+void MmapBufferRO::setView(std::size_t offset,std::size_t size) {
+  if ((offset > mapSize()) || (size > (mapSize() - offset))) {
+    throw std::out_of_range("MmapBufferRO: view outside the mapping");
+  }
+  view_ = mapData() + offset;
+  viewSize_ = size;
+}
+
+void writeBinaryWORMTreeUIntFile(const std::string& path,const BinaryWORMTreeUIntParams& treeParams,
+                                 const uint8_t* tree,std::size_t treeSize) {
+  BinaryWORMFileHeader h{};
+  h.treeParams = treeParams;
+  h.treeSize = treeSize;
+  h.checksum = binaryWORMChecksum(tree,treeSize);
+  h.headerTypeID = binaryWORMUIntHeaderTypeID(treeParams);
+  h.valueTypeID = binaryWORMUIntValueTypeID(treeParams);
+  if (h.valueTypeID.empty() || (treeParams.offsetSize == 0) || (treeParams.offsetSize > sizeof(uint64_t))) {
+    throw std::invalid_argument("writeBinaryWORMTreeUIntFile: invalid tree parameters");
+  }
+  uint8_t headerBytes[BinaryWORMFileHeader::Size];
+  h.write(headerBytes);
+
+  const std::string tmpPath = path + ".tmp";
+  int fd = ::open(tmpPath.c_str(),O_WRONLY | O_CREAT | O_TRUNC,0644);
+  if (fd < 0) { throw std::system_error(errno,std::generic_category(),"writeBinaryWORMTreeUIntFile: open " + tmpPath); }
+  auto writeAll = [fd](const uint8_t* b,std::size_t n) {
+    while (n > 0) {
+      ssize_t w = ::write(fd,b,n);
+      if (w < 0) {
+        if (errno == EINTR) { continue; }
+        return false;
+      }
+      b += w;
+      n -= static_cast<std::size_t>(w);
+    }
+    return true;
+  };
+  bool ok = (writeAll(headerBytes,sizeof(headerBytes)) && writeAll(tree,treeSize) && (::fsync(fd) == 0));
+  int e = errno;
+  if ((::close(fd) != 0) && ok) { ok = false; e = errno; }
+  if (ok && (::rename(tmpPath.c_str(),path.c_str()) != 0)) { ok = false; e = errno; }
+  if (!ok) {
+    ::unlink(tmpPath.c_str());
+    throw std::system_error(e,std::generic_category(),"writeBinaryWORMTreeUIntFile: write " + path);
+  }
+}
+
+template <typename PathT>
+BinaryWORMTreeUIntGeneric<PathT>
+openBinaryWORMTreeUIntFile(const std::string& path,const MmapBufferOptions& options,bool verifyChecksum) {
+  MmapBufferRO buffer{path,options};
+  const BinaryWORMFileHeader h = BinaryWORMFileHeader::read(buffer.data(),buffer.size());
+  if ((h.headerTypeID != binaryWORMUIntHeaderTypeID(h.treeParams)) ||
+      (h.valueTypeID != binaryWORMUIntValueTypeID(h.treeParams))) {
+    throw std::runtime_error("openBinaryWORMTreeUIntFile: " + path + " is not a UInt WORM tree (" +
+                             h.headerTypeID + "," + h.valueTypeID + ")");
+  }
+  buffer.setView(h.rootOffset,h.treeSize);
+  if (verifyChecksum && (binaryWORMChecksum(buffer.data(),buffer.size()) != h.checksum)) {
+    throw std::runtime_error("openBinaryWORMTreeUIntFile: checksum mismatch in " + path);
+  }
+  return makeWORMTreeUIntGeneric<PathT>(h.treeParams,std::move(buffer));
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
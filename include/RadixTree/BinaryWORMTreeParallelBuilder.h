@@ -0,0 +1,359 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_TREE_PARALLEL_BUILDER_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_TREE_PARALLEL_BUILDER_H_
+
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <utility>
+
+#include "CursorIterator.h"
+#include "BinaryWORMTreeBuilder.h"
+
+/**
+ * \file BinaryWORMTreeParallelBuilder.h
+ *
+ * WORM child offsets are relative to the node holding them, so a subtree
+ * built on its own can be copied into a larger tree unchanged. The parallel
+ * builder splits the source tree at a fixed depth, builds every subtree found
+ * there with its own BinaryWORMTreeBuilder on a worker thread, then stitches
+ * the subtree buffers together under a small top section covering the
+ * positions above the split depth.
+ */
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \brief Default source value reader for BinaryWORMTreeParallelBuilder - plain conversion.
+ */
+struct BinaryWORMReadSourceValue {
+  template <typename CursorT,typename ValueT>
+  bool operator()(const CursorT& c,ValueT* v) const {
+    if (!c.atValue()) { return false; }
+    *v = static_cast<ValueT>(*(c.nodeValueRO().getPtrRO()));
+    return true;
+  }
+};
+
+/**
+ * \brief Builds a binary WORM tree from a walk cursor using several threads.
+ *
+ * Every position SplitBits steps below the root that exists in the source becomes
+ * a separate build job, the resulting subtree buffers are laid out in pre-order
+ * behind the top section nodes for the positions above them. Top section nodes
+ * have no edges, and the subtree roots are always written even when they'd be
+ * scaffolding in a sequential build, so the result can be a few nodes larger than
+ * what BinaryWORMTreeBuilder produces for the same source. With SplitBits of 0 the
+ * whole tree is one job.
+ *
+ * Each subtree is held in its own buffer until the stitch, so peak memory is
+ * roughly twice the final tree size. As with BinaryWORMTreeBuilder a dry run
+ * (statsOnly) allocates no tree memory and produces the stats used to pick the
+ * offset size.
+ */
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+class BinaryWORMTreeParallelBuilder {
+public:
+  using PathType = PathT;
+  using BinaryWORMNodeType = BinaryWORMNodeT;
+  using Builder = BinaryWORMTreeBuilder<BufferT,PathT,BinaryWORMNodeT>;
+  using WriteValueType = typename Builder::WriteValueType;
+  using OffsetType = typename Builder::OffsetType;
+  using ValueType = typename Builder::ValueType;
+  using Buffer = BufferT;
+  using TreeStats = typename Builder::TreeStats;
+  using NodeStatsTotal = BinaryWORMNodeStatsTotal<BinaryWORMNodeT>;
+
+  /**
+   * \brief Split at splitBits, use up to threadCount workers (0 for the hardware concurrency).
+   */
+  BinaryWORMTreeParallelBuilder(std::size_t splitBits,std::size_t threadCount = 0,const WriteValueType& wv = WriteValueType{})
+    : splitBits_(splitBits), threadCount_(threadCount), writeValue_(wv)
+  {
+    if (splitBits_ > PathType::MaxDepth) {
+      throw std::invalid_argument("BinaryWORMTreeParallelBuilder: split depth exceeds path depth");
+    }
+    if (threadCount_ == 0) { threadCount_ = std::max<std::size_t>(std::thread::hardware_concurrency(),1); }
+  }
+
+  /**
+   * \brief Build the tree below cursor c into buffer, or just gather stats.
+   *
+   * readValue(cursor,ValueType*) returns true and fills in the value if the cursor
+   * is at a value. It is called concurrently from the worker threads. Any exception
+   * thrown by a job is rethrown here once all of the workers are done.
+   */
+  template <typename CursorT,typename ReadSourceValueT = BinaryWORMReadSourceValue>
+  inline void build(const CursorT& c,Buffer&& buffer,bool statsOnly = false,const ReadSourceValueT& readValue = ReadSourceValueT{});
+  template <typename CursorT,typename ReadSourceValueT = BinaryWORMReadSourceValue>
+  void build(const CursorT& c,bool statsOnly = false,const ReadSourceValueT& readValue = ReadSourceValueT{}) {
+    build(c,Buffer{},statsOnly,readValue);
+  }
+
+  std::size_t splitBits() const { return splitBits_; }
+  std::size_t threadCount() const { return threadCount_; }
+  /**
+   * \brief Number of subtrees built by the last build.
+   */
+  std::size_t subtreeCount() const { return subtreeCount_; }
+  /**
+   * \brief Size of the last tree built.
+   */
+  std::size_t sizeofBuffer() const { return treeStats_.allNodeStats.bytes(); }
+  /**
+   * \brief Stats for the stitched tree, same meaning as BinaryWORMTreeBuilder::treeStats().
+   */
+  const TreeStats& treeStats() const { return treeStats_; }
+  /**
+   * \brief Moves the finished tree out.
+   */
+  Buffer extractBuffer() { return std::move(buffer_); }
+
+private:
+  std::size_t splitBits_{0};
+  std::size_t threadCount_{1};
+  WriteValueType writeValue_{};
+  std::size_t subtreeCount_{0};
+  Buffer buffer_{};
+  TreeStats treeStats_{};
+
+  // The tree in pre-order as top section nodes and whole subtrees.
+  struct Part {
+    bool isSubtree{false};
+    std::size_t subtree{0};
+    BinaryWORMNodeType node{};
+    // This part and everything below it.
+    NodeStatsTotal region{};
+    // The node and its left child region, i.e. the right child offset.
+    NodeStatsTotal leftRegion{};
+    // Index of the first part after this region.
+    std::size_t end{0};
+  };
+  std::vector<Part> parts_{};
+  std::vector<std::unique_ptr<Builder>> subtrees_{};
+
+  template <typename CursorT,typename ReadSourceValueT>
+  inline void addTopParts(const CursorT& c,std::size_t depth,std::vector<CursorT>* jobs,const ReadSourceValueT& readValue);
+
+  template <typename CursorT,typename ReadSourceValueT>
+  inline void buildSubtree(const CursorT& c,Builder* builder,bool statsOnly,const ReadSourceValueT& readValue) const;
+
+  inline std::size_t sizeParts(std::size_t i);
+  inline std::size_t writeParts(std::size_t i,uint8_t* at) const;
+};
+
+/**
+ * \brief Convenience typedef - a std::vector may be used directly as a buffer manager.
+ */
+template <typename PathT,typename BinaryWORMNodeT>
+using BinaryWORMTreeParallelBuilderVector = BinaryWORMTreeParallelBuilder<std::vector<uint8_t>,PathT,BinaryWORMNodeT>;
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+template <typename CursorT,typename ReadSourceValueT>
+void
+BinaryWORMTreeParallelBuilder<BufferT,PathT,BinaryWORMNodeT>::build(const CursorT& c,Buffer&& buffer,bool statsOnly,const ReadSourceValueT& readValue) {
+  parts_.clear();
+  subtrees_.clear();
+  treeStats_ = TreeStats{};
+  std::vector<CursorT> jobs{};
+  addTopParts(c,0,&jobs,readValue);
+  subtreeCount_ = jobs.size();
+  for (std::size_t i = 0; i < jobs.size(); ++i) {
+    subtrees_.emplace_back(new Builder{writeValue_});
+  }
+
+  std::vector<std::exception_ptr> errors(jobs.size());
+  std::atomic<std::size_t> nextJob{0};
+  auto worker = [&]() {
+    for (std::size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+      try {
+        buildSubtree(jobs[j],subtrees_[j].get(),statsOnly,readValue);
+      } catch (...) {
+        errors[j] = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> threads{};
+  const std::size_t threadCount = std::min(threadCount_,jobs.size());
+  for (std::size_t t = 1; t < threadCount; ++t) { threads.emplace_back(worker); }
+  // The calling thread takes jobs too.
+  worker();
+  for (std::thread& t : threads) { t.join(); }
+  for (const std::exception_ptr& e : errors) {
+    if (e) { std::rethrow_exception(e); }
+  }
+
+  sizeParts(0);
+  treeStats_.allNodeStats = parts_.front().region;
+  for (const auto& subtree : subtrees_) {
+    const TreeStats& s = subtree->treeStats();
+    for (std::size_t i = 0; i < treeStats_.longestOffsetGap.size(); ++i) {
+      treeStats_.longestOffsetGap.at(i) = std::max(treeStats_.longestOffsetGap.at(i),s.longestOffsetGap.at(i));
+    }
+  }
+  for (const Part& p : parts_) {
+    if (p.isSubtree || !(p.node.hasChild(0) && p.node.hasChild(1))) { continue; }
+    for (std::size_t i = 0; i < treeStats_.longestOffsetGap.size(); ++i) {
+      treeStats_.longestOffsetGap.at(i) = std::max(treeStats_.longestOffsetGap.at(i),p.leftRegion.bytes(i));
+    }
+  }
+
+  buffer_ = std::move(buffer);
+  if (!statsOnly) {
+    buffer_.resize(sizeofBuffer());
+    if (writeParts(0,buffer_.data()) != sizeofBuffer()) {
+      throw std::runtime_error("BinaryWORMTreeParallelBuilder: actual write size different from expected");
+    }
+  }
+  parts_.clear();
+  subtrees_.clear();
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+template <typename CursorT,typename ReadSourceValueT>
+void
+BinaryWORMTreeParallelBuilder<BufferT,PathT,BinaryWORMNodeT>::addTopParts(const CursorT& c,std::size_t depth,
+                                                                         std::vector<CursorT>* jobs,
+                                                                         const ReadSourceValueT& readValue)
+{
+  Part part{};
+  if (depth == splitBits_) {
+    part.isSubtree = true;
+    part.subtree = jobs->size();
+    jobs->push_back(c);
+    parts_.push_back(std::move(part));
+    return;
+  }
+  part.node = BinaryWORMNodeType{writeValue_};
+  ValueType v{};
+  const bool hasValue = readValue(c,&v);
+  part.node.setHasValue(hasValue);
+  if (hasValue) { part.node.setValue(&v); }
+  part.node.setHasChild({c.canGoChildNode(0),c.canGoChildNode(1)});
+  parts_.push_back(std::move(part));
+  for (std::size_t child = 0; child < 2; ++child) {
+    if (!c.canGoChildNode(child)) { continue; }
+    CursorT childCursor{c};
+    childCursor.goChild(child);
+    addTopParts(childCursor,depth + 1,jobs,readValue);
+  }
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+template <typename CursorT,typename ReadSourceValueT>
+void
+BinaryWORMTreeParallelBuilder<BufferT,PathT,BinaryWORMNodeT>::buildSubtree(const CursorT& c,Builder* builder,bool statsOnly,
+                                                                          const ReadSourceValueT& readValue) const
+{
+  if (!builder->start(statsOnly)) {
+    throw std::runtime_error("BinaryWORMTreeParallelBuilder: unable to start subtree");
+  }
+  auto treeIter = make_preorder_iterator<false,true>(c);
+  while (!treeIter.finished()) {
+    // Paths are relative to the subtree root.
+    const PathType& fullPath = treeIter->getPath();
+    PathType path{};
+    for (std::size_t s = splitBits_; s < fullPath.size(); ++s) { path.push_back(fullPath.at(s)); }
+    ValueType v{};
+    const bool hasValue = readValue(*treeIter,&v);
+    builder->addNode(path,hasValue,hasValue ? &v : nullptr,{treeIter->canGoChildNode(0),treeIter->canGoChildNode(1)});
+    treeIter++;
+  }
+  if (!builder->finish()) {
+    throw std::runtime_error("BinaryWORMTreeParallelBuilder: unable to finish subtree");
+  }
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+std::size_t
+BinaryWORMTreeParallelBuilder<BufferT,PathT,BinaryWORMNodeT>::sizeParts(std::size_t i) {
+  Part& part = parts_.at(i);
+  if (part.isSubtree) {
+    part.region = subtrees_.at(part.subtree)->treeStats().allNodeStats;
+    part.end = i + 1;
+    return part.end;
+  }
+  part.region = NodeStatsTotal{};
+  part.region.addNode(part.node);
+  std::size_t next = i + 1;
+  for (std::size_t child = 0; child < 2; ++child) {
+    if (!part.node.hasChild(child)) { continue; }
+    if (child == 1) { part.leftRegion = part.region; }
+    const std::size_t childAt = next;
+    next = sizeParts(childAt);
+    part.region += parts_.at(childAt).region;
+  }
+  part.end = next;
+  return next;
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+std::size_t
+BinaryWORMTreeParallelBuilder<BufferT,PathT,BinaryWORMNodeT>::writeParts(std::size_t i,uint8_t* at) const {
+  const Part& part = parts_.at(i);
+  if (part.isSubtree) {
+    const Builder& subtree = *(subtrees_.at(part.subtree));
+    std::memcpy(at,subtree.buffer().data(),subtree.sizeofBuffer());
+    return subtree.sizeofBuffer();
+  }
+  std::size_t written{0};
+  if (part.node.hasChild(0) && part.node.hasChild(1)) {
+    BinaryWORMNodeType node{part.node};
+    const std::size_t offsetToUse = part.leftRegion.bytes();
+    const OffsetType rightNodeOffset = static_cast<OffsetType>(offsetToUse);
+    if (static_cast<std::size_t>(rightNodeOffset) != offsetToUse) {
+      throw std::runtime_error("BinaryWORMTreeParallelBuilder: exceeded offset capacity");
+    }
+    node.setRightChildOffset(rightNodeOffset);
+    written = node.write(at);
+  } else {
+    written = part.node.write(at);
+  }
+  std::size_t next = i + 1;
+  for (std::size_t child = 0; child < 2; ++child) {
+    if (!part.node.hasChild(child)) { continue; }
+    written += writeParts(next,at + written);
+    next = parts_.at(next).end;
+  }
+  return written;
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -0,0 +1,351 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_TREE_STREAM_BUILDER_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_TREE_STREAM_BUILDER_H_
+
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <list>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+
+#include "BinaryWORMTreeBuilder.h"
+
+/**
+ * \file BinaryWORMTreeStreamBuilder.h
+ *
+ * BinaryWORMTreeBuilder wants every node along with its children, which is
+ * why trees are normally frozen by walking a complete mutable tree. The
+ * stream builder takes just the (path,value) pairs, already sorted in
+ * pre-order (a path before any path it prefixes, 0 children before 1
+ * children), works out the branching nodes and child flags itself, and
+ * feeds the result straight into a BinaryWORMTreeBuilder. No mutable tree
+ * is ever built.
+ */
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \brief Builds a binary WORM tree from (path,value) pairs sorted in pre-order.
+ *
+ * A node can only be handed to the underlying builder once its children are known,
+ * and a node with a 0 child only learns whether it has a 1 child when the input
+ * leaves its 0 subtree. The same goes for positions along an edge: a 0 step may
+ * still turn into a branch node that has to be written first. Pairs are therefore
+ * held in a lookahead list until everything before them in pre-order is settled.
+ * The stack of open nodes is bounded by the path depth, and the lookahead list
+ * only holds pairs below the shallowest 0 step of the current path. Memory stays
+ * proportional to the output rather than to a mutable copy of the tree.
+ *
+ * The result is byte for byte what BinaryWORMTreeBuilder produces when walking a
+ * tree holding the same pairs. The input can only be read once per build, so
+ * picking the offset size means running the input through a dry run (statsOnly)
+ * first, just like the regular builder.
+ */
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+class BinaryWORMTreeStreamBuilder {
+public:
+  using PathType = PathT;
+  using BinaryWORMNodeType = BinaryWORMNodeT;
+  using Builder = BinaryWORMTreeBuilder<BufferT,PathT,BinaryWORMNodeT>;
+  using WriteValueType = typename Builder::WriteValueType;
+  using ValueType = typename Builder::ValueType;
+  using Buffer = BufferT;
+  using TreeStats = typename Builder::TreeStats;
+
+  BinaryWORMTreeStreamBuilder() = default;
+  BinaryWORMTreeStreamBuilder(const WriteValueType& wv) : builder_(wv) {}
+  BinaryWORMTreeStreamBuilder(Buffer&& mb,const WriteValueType& wv = WriteValueType{}) : builder_(std::move(mb),false,wv) {}
+
+  /**
+   * \brief Begin construction of a tree, use buffer, optionally stats only.
+   */
+  bool start(Buffer&& buffer,bool statsOnly = false) {
+    if (!builder_.start(std::move(buffer),statsOnly)) { return false; }
+    resetPending();
+    return true;
+  }
+  /**
+   * \brief Begin construction of a tree, optionally stats only.
+   */
+  bool start(bool statsOnly = false) {
+    if (!builder_.start(statsOnly)) { return false; }
+    resetPending();
+    return true;
+  }
+
+  /**
+   * \brief Add the next value in pre-order.
+   *
+   * Throws if path doesn't follow the previous path in pre-order (including repeats).
+   */
+  inline void add(const PathType& path,const ValueType& value);
+
+  /**
+   * \brief Settle everything still pending and finish the tree.
+   */
+  inline bool finish();
+  bool finished() const { return builder_.finished(); }
+
+  /**
+   * \brief Number of pairs/branch nodes currently held back, and the most held back so far.
+   */
+  std::size_t pendingCount() const { return pendingCount_; }
+  std::size_t maxPendingCount() const { return maxPendingCount_; }
+
+  std::size_t sizeofBuffer() const { return builder_.sizeofBuffer(); }
+  Buffer extractBuffer() { return builder_.extractBuffer(); }
+  const TreeStats& treeStats() const { return builder_.treeStats(); }
+
+private:
+  struct Pending {
+    PathType path{};
+    bool hasValue{false};
+    ValueType value{};
+    std::array<bool,2> hasChild{{false,false}};
+    // Children can't change any more.
+    bool settled{false};
+    // No branch node can appear between this node and the node above it.
+    bool gapClosed{false};
+    // Still on the open path, at open_[openIndex].
+    bool open{false};
+    std::size_t openIndex{0};
+  };
+  using PendingList = std::list<Pending>;
+  using PendingIter = typename PendingList::iterator;
+  // Nodes stay open after they are written (once settled), node is then pending_.end().
+  struct OpenNode {
+    PathType path{};
+    PendingIter node{};
+  };
+
+  Builder builder_{};
+  // Nodes in pre-order that haven't been handed to builder_ yet.
+  PendingList pending_{};
+  // The nodes along the path of the most recent add, root first.
+  std::vector<OpenNode> open_{};
+  std::size_t pendingCount_{0};
+  std::size_t maxPendingCount_{0};
+  bool haveAdded_{false};
+
+  // Start over with just the root, which is always written.
+  void resetPending() {
+    pending_.clear();
+    open_.clear();
+    pendingCount_ = 0;
+    maxPendingCount_ = 0;
+    haveAdded_ = false;
+    Pending root{};
+    root.gapClosed = true;
+    pushOpen(insertPending(pending_.end(),std::move(root)));
+  }
+  void pushOpen(PendingIter p) {
+    p->open = true;
+    p->openIndex = open_.size();
+    open_.push_back(OpenNode{p->path,p});
+  }
+  static inline bool isPrefix(const PathType& prefix,const PathType& path);
+  // A path step of 0 between the node above and path means a 1 sibling may still turn up there.
+  static inline bool noBranchAbove(const PathType& path,std::size_t aboveDepth);
+  static inline PathType commonPrefix(const PathType& a,const PathType& b);
+  inline PendingIter insertPending(PendingIter before,Pending&& p);
+  inline void flushSettled();
+};
+
+/**
+ * \brief Convenience typedef - a std::vector may be used directly as a buffer manager.
+ */
+template <typename PathT,typename BinaryWORMNodeT>
+using BinaryWORMTreeStreamBuilderVector = BinaryWORMTreeStreamBuilder<std::vector<uint8_t>,PathT,BinaryWORMNodeT>;
+
+/**
+ * \brief Build a WORM tree from a range of (path,value) pairs sorted in pre-order.
+ */
+template <typename BinaryWORMNodeT,typename PathT,typename BufferT,typename InputIterT>
+inline typename std::decay<BufferT>::type
+buildBinaryWORMTreeFromSorted(InputIterT first,InputIterT last,BufferT&& buffer);
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+void
+BinaryWORMTreeStreamBuilder<BufferT,PathT,BinaryWORMNodeT>::add(const PathType& path,const ValueType& value) {
+  if (!builder_.started() || open_.empty()) {
+    throw std::runtime_error("BinaryWORMTreeStreamBuilder: add before start");
+  }
+  if (path.empty()) {
+    if (haveAdded_) { throw std::runtime_error("BinaryWORMTreeStreamBuilder: paths out of pre-order"); }
+    open_.front().node->hasValue = true;
+    open_.front().node->value = value;
+    haveAdded_ = true;
+    return;
+  }
+  // Everything on the open path that isn't above the new path is complete.
+  bool closedAny{false};
+  OpenNode lastClosed{};
+  while (!isPrefix(open_.back().path,path)) {
+    closedAny = true;
+    lastClosed = open_.back();
+    if (lastClosed.node != pending_.end()) {
+      lastClosed.node->settled = true;
+      lastClosed.node->gapClosed = true;
+      lastClosed.node->open = false;
+    }
+    open_.pop_back();
+  }
+  const std::size_t aboveDepth = open_.back().path.size();
+  if (aboveDepth == path.size()) {
+    throw std::runtime_error("BinaryWORMTreeStreamBuilder: repeated path");
+  }
+  if (closedAny) {
+    // The new path leaves the subtree of lastClosed, they must split at a 0/1 branch.
+    const PathType branchPath = commonPrefix(lastClosed.path,path);
+    if ((branchPath.size() == path.size()) ||
+        (lastClosed.path.at(branchPath.size()) != 0) ||
+        (path.at(branchPath.size()) != 1))
+    {
+      throw std::runtime_error("BinaryWORMTreeStreamBuilder: paths out of pre-order");
+    }
+    if (branchPath.size() > aboveDepth) {
+      // Nothing is at the split yet, a branch node goes ahead of the 0 subtree. The 0 step
+      // in the gap above lastClosed kept it from being written.
+      if (lastClosed.node == pending_.end()) {
+        throw std::runtime_error("BinaryWORMTreeStreamBuilder: node written before branch above it");
+      }
+      Pending branch{};
+      branch.path = branchPath;
+      branch.hasChild = {{true,true}};
+      branch.settled = true;
+      branch.gapClosed = noBranchAbove(branch.path,aboveDepth);
+      pushOpen(insertPending(lastClosed.node,std::move(branch)));
+    }
+  }
+  OpenNode& above = open_.back();
+  const std::size_t child = path.at(above.path.size());
+  // Written nodes are settled, i.e. already have their 1 child.
+  if (above.node != pending_.end()) {
+    above.node->hasChild.at(child) = true;
+    // Once a 1 child shows up there can't be any more 0 children.
+    if (child == 1) { above.node->settled = true; }
+  }
+
+  Pending node{};
+  node.path = path;
+  node.hasValue = true;
+  node.value = value;
+  node.gapClosed = noBranchAbove(path,above.path.size());
+  pushOpen(insertPending(pending_.end(),std::move(node)));
+  haveAdded_ = true;
+  flushSettled();
+  maxPendingCount_ = std::max(maxPendingCount_,pendingCount_);
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+bool
+BinaryWORMTreeStreamBuilder<BufferT,PathT,BinaryWORMNodeT>::finish() {
+  if (!builder_.started()) { return builder_.finished(); }
+  for (OpenNode& o : open_) {
+    if (o.node == pending_.end()) { continue; }
+    o.node->settled = true;
+    o.node->gapClosed = true;
+    o.node->open = false;
+  }
+  open_.clear();
+  flushSettled();
+  return builder_.finish();
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+bool
+BinaryWORMTreeStreamBuilder<BufferT,PathT,BinaryWORMNodeT>::noBranchAbove(const PathType& path,std::size_t aboveDepth) {
+  for (std::size_t i = aboveDepth + 1; i < path.size(); ++i) {
+    if (path.at(i) == 0) { return false; }
+  }
+  return true;
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+bool
+BinaryWORMTreeStreamBuilder<BufferT,PathT,BinaryWORMNodeT>::isPrefix(const PathType& prefix,const PathType& path) {
+  if (prefix.size() > path.size()) { return false; }
+  for (std::size_t i = 0; i < prefix.size(); ++i) {
+    if (prefix.at(i) != path.at(i)) { return false; }
+  }
+  return true;
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+PathT
+BinaryWORMTreeStreamBuilder<BufferT,PathT,BinaryWORMNodeT>::commonPrefix(const PathType& a,const PathType& b) {
+  PathType prefix{};
+  const std::size_t maxLength = std::min(a.size(),b.size());
+  for (std::size_t i = 0; (i < maxLength) && (a.at(i) == b.at(i)); ++i) { prefix.push_back(a.at(i)); }
+  return prefix;
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+typename BinaryWORMTreeStreamBuilder<BufferT,PathT,BinaryWORMNodeT>::PendingIter
+BinaryWORMTreeStreamBuilder<BufferT,PathT,BinaryWORMNodeT>::insertPending(PendingIter before,Pending&& p) {
+  ++pendingCount_;
+  return pending_.insert(before,std::move(p));
+}
+
+template <typename BufferT,typename PathT,typename BinaryWORMNodeT>
+void
+BinaryWORMTreeStreamBuilder<BufferT,PathT,BinaryWORMNodeT>::flushSettled() {
+  while (!pending_.empty() && pending_.front().settled && pending_.front().gapClosed) {
+    const Pending& p = pending_.front();
+    builder_.addNode(p.path,p.hasValue,p.hasValue ? &p.value : nullptr,p.hasChild);
+    if (p.open) { open_.at(p.openIndex).node = pending_.end(); }
+    pending_.pop_front();
+    --pendingCount_;
+  }
+}
+
+template <typename BinaryWORMNodeT,typename PathT,typename BufferT,typename InputIterT>
+typename std::decay<BufferT>::type
+buildBinaryWORMTreeFromSorted(InputIterT first,InputIterT last,BufferT&& buffer) {
+  using BufferType = typename std::decay<BufferT>::type;
+  BinaryWORMTreeStreamBuilder<BufferType,PathT,BinaryWORMNodeT> builder{};
+  if (!builder.start(std::move(buffer))) {
+    throw std::runtime_error("Unable to start building WORM tree!");
+  }
+  for (; first != last; ++first) { builder.add(first->first,first->second); }
+  if (!builder.finish()) {
+    throw std::runtime_error("Unable to finish building WORM tree!");
+  }
+  return builder.extractBuffer();
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
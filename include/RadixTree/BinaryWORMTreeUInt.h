@@ -25,6 +25,9 @@ SOFTWARE.
 
 #include <stdint.h>
 #include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 #include "BinaryWORMTree.h"
 #include "BinaryWORMTreeGeneric.h"
@@ -55,6 +58,39 @@ struct BinaryWORMTreeUIntParams {
   BinaryWORMTreeUIntParams(bool end,std::size_t os,std::size_t vs) : isLittleEndian(end), offsetSize(os), valueSize(vs) {}
 };
 
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
+using BinaryWORMNodeUIntWO = BinaryWORMNodeWO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteUInt<VALUESIZE,LITTLEENDIAN>>;
+
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
+using BinaryWORMNodeUIntRO = BinaryWORMNodeRO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteUInt<VALUESIZE,LITTLEENDIAN>>;
+
+template <typename BufferT,typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
+using BinaryWORMTreeUInt = BinaryWORMTree<BufferT,PathT,BinaryWORMNodeUIntRO<LITTLEENDIAN,OFFSETSIZE,VALUESIZE>>;
+
+/**
+ * \brief Result type of visiting a UInt WORM tree with visitor, see visitBinaryWORMTreeUInt().
+ *
+ * Every instantiation of the visitor has to return this same type.
+ */
+template <typename PathT,typename VisitorT>
+using BinaryWORMTreeUIntVisitResult =
+  decltype(std::declval<VisitorT>()(std::declval<const BinaryWORMTreeUInt<UnownedBufferRO,PathT,false,sizeof(uint64_t),sizeof(uint64_t)>&>()));
+
+/**
+ * \brief Call visitor with the concrete UInt WORM tree over the treeSize bytes at tree.
+ *
+ * The tree parameters are only known at run time, so visitor is instantiated for every
+ * endian/offset size/value size combination and called with a
+ * const BinaryWORMTreeUInt<UnownedBufferRO,PathT,...>&. Cursors taken from that tree are
+ * the plain templated ones: no heap allocation and no virtual calls, so a lookup loop
+ * inside the visitor is compiled for the actual layout. Throws std::runtime_error for
+ * unsupported parameters.
+ */
+template <typename PathT,typename VisitorT>
+inline
+BinaryWORMTreeUIntVisitResult<PathT,VisitorT>
+visitBinaryWORMTreeUInt(const BinaryWORMTreeUIntParams& treeParams,const uint8_t* tree,std::size_t treeSize,VisitorT&& visitor);
+
 /**
  * \brief Tree wrapper specialized for UInt value WORM trees.
  * 
@@ -75,18 +111,38 @@ public:
   virtual ~BinaryWORMTreeUIntGeneric() = default;
   const BinaryWORMTreeUIntParams& treeParams() const { return treeParams_; }
 
+  /**
+   * \brief Call visitor with the concrete tree behind this wrapper, see visitBinaryWORMTreeUInt().
+   *
+   * The generic cursors allocate and go through virtual calls on every step; hot lookup
+   * loops should run inside a visitor instead.
+   */
+  template <typename VisitorT>
+  BinaryWORMTreeUIntVisitResult<PathT,VisitorT> visit(VisitorT&& visitor) const {
+    return visitBinaryWORMTreeUInt<PathT>(treeParams_,this->bytes(),this->bytesSize(),std::forward<VisitorT>(visitor));
+  }
+
 private:
   BinaryWORMTreeUIntParams treeParams_{};
 };
 
+/**
+ * \brief BinaryWORMTreeUInt with a jump table section in front, see addBinaryWORMJumpTable().
+ */
+template <typename BufferT,typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
+using BinaryWORMJumpTreeUInt = BinaryWORMJumpTree<BufferT,PathT,BinaryWORMNodeUIntRO<LITTLEENDIAN,OFFSETSIZE,VALUESIZE>>;
+
+/**
+ * \brief UInt nodes using the long edge header, see BinaryWORMNodeHeaderLongEdgeBytes.
+ */
 template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
-using BinaryWORMNodeUIntWO = BinaryWORMNodeWO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteUInt<VALUESIZE,LITTLEENDIAN>>;
+using BinaryWORMNodeUIntLongEdgeWO = BinaryWORMNodeWO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteUInt<VALUESIZE,LITTLEENDIAN>,BinaryWORMNodeHeaderLongEdgeBytes>;
 
 template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
-using BinaryWORMNodeUIntRO = BinaryWORMNodeRO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteUInt<VALUESIZE,LITTLEENDIAN>>;
+using BinaryWORMNodeUIntLongEdgeRO = BinaryWORMNodeRO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteUInt<VALUESIZE,LITTLEENDIAN>,BinaryWORMNodeHeaderLongEdgeBytes>;
 
 template <typename BufferT,typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
-using BinaryWORMTreeUInt = BinaryWORMTree<BufferT,PathT,BinaryWORMNodeUIntRO<LITTLEENDIAN,OFFSETSIZE,VALUESIZE>>;
+using BinaryWORMTreeUIntLongEdge = BinaryWORMTree<BufferT,PathT,BinaryWORMNodeUIntLongEdgeRO<LITTLEENDIAN,OFFSETSIZE,VALUESIZE>>;
 
 /**
  * \brief Generic UINT cursor type, uses uint64_t as value so that up to 8 bytes per value integer may be used.
@@ -183,6 +239,53 @@ private:
   ActualImpl actualTree_{};
 };
 
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+// Walks the offset/value sizes down from 8 bytes, in the same order as MakeBinaryWORMTreeUInt
+template <typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE = sizeof(uint64_t),std::size_t VALUESIZE = sizeof(uint64_t)>
+struct VisitBinaryWORMTreeUInt {
+  template <typename VisitorT>
+  static BinaryWORMTreeUIntVisitResult<PathT,VisitorT>
+  apply(const BinaryWORMTreeUIntParams& treeParams,const uint8_t* tree,std::size_t treeSize,VisitorT&& visitor) {
+    if ((OFFSETSIZE == treeParams.offsetSize) && (VALUESIZE == treeParams.valueSize)) {
+      const BinaryWORMTreeUInt<UnownedBufferRO,PathT,LITTLEENDIAN,OFFSETSIZE,VALUESIZE> actualTree{UnownedBufferRO{tree,treeSize}};
+      return std::forward<VisitorT>(visitor)(actualTree);
+    }
+    return VisitBinaryWORMTreeUInt<PathT,LITTLEENDIAN,OFFSETSIZE,VALUESIZE - 1>::apply(treeParams,tree,treeSize,std::forward<VisitorT>(visitor));
+  }
+};
+
+template <typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE>
+struct VisitBinaryWORMTreeUInt<PathT,LITTLEENDIAN,OFFSETSIZE,0> {
+  template <typename VisitorT>
+  static BinaryWORMTreeUIntVisitResult<PathT,VisitorT>
+  apply(const BinaryWORMTreeUIntParams& treeParams,const uint8_t* tree,std::size_t treeSize,VisitorT&& visitor) {
+    return VisitBinaryWORMTreeUInt<PathT,LITTLEENDIAN,OFFSETSIZE - 1>::apply(treeParams,tree,treeSize,std::forward<VisitorT>(visitor));
+  }
+};
+
+template <typename PathT,bool LITTLEENDIAN>
+struct VisitBinaryWORMTreeUInt<PathT,LITTLEENDIAN,0,sizeof(uint64_t)> {
+  template <typename VisitorT>
+  static BinaryWORMTreeUIntVisitResult<PathT,VisitorT>
+  apply(const BinaryWORMTreeUIntParams& treeParams,const uint8_t*,std::size_t,VisitorT&&) {
+    throw std::runtime_error("Invalid UInt binary WORM tree params: offsetsize " + std::to_string(treeParams.offsetSize) +
+                             " valuesize " + std::to_string(treeParams.valueSize));
+  }
+};
+
+template <typename PathT,typename VisitorT>
+BinaryWORMTreeUIntVisitResult<PathT,VisitorT>
+visitBinaryWORMTreeUInt(const BinaryWORMTreeUIntParams& treeParams,const uint8_t* tree,std::size_t treeSize,VisitorT&& visitor) {
+  if (treeParams.isLittleEndian) {
+    return VisitBinaryWORMTreeUInt<PathT,true>::apply(treeParams,tree,treeSize,std::forward<VisitorT>(visitor));
+  } else {
+    return VisitBinaryWORMTreeUInt<PathT,false>::apply(treeParams,tree,treeSize,std::forward<VisitorT>(visitor));
+  }
+}
+
 } // namespace RadixTree
 } // namespace Mapper
 } // namespace Akamai
@@ -24,9 +24,13 @@ SOFTWARE.
 */
 
 #include <stdint.h>
+#include <atomic>
 #include <cstddef>
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include "CursorIterator.h"
 #include "MetaUtils.h"
@@ -34,6 +38,7 @@ SOFTWARE.
 #include "BinaryWORMTree.h"
 #include "BinaryWORMTreeBuilder.h"
 #include "BinaryWORMTreeGeneric.h"
+#include "BinaryWORMTreeParallelBuilder.h"
 #include "BinaryWORMTreeUInt.h"
 
 /**
@@ -56,20 +61,52 @@ namespace RadixTree {
  *
  * The cursor should cover a tree that contains unsinged integers, uint64_t or smaller.
  * The tree parameters derived here can be fed directly into buildWORMTreeUIntGeneric
- * to create a treee.
+ * to create a treee. A non-zero splitBits runs the dry run with BinaryWORMTreeParallelBuilder,
+ * splitting the tree splitBits steps below the root across threadCount threads.
  */
 template <typename CursorT>
 inline
 BinaryWORMTreeUIntParams
-findMinimumWORMTreeUIntParameters(const CursorT& c);
+findMinimumWORMTreeUIntParameters(const CursorT& c,std::size_t splitBits = 0,std::size_t threadCount = 0);
 
 /**
  * \brief Pre-order traverse cursor, build a WORM tree using endian/value/offset sizes in treeParams.
+ *
+ * splitBits and threadCount as for findMinimumWORMTreeUIntParameters, the parameters
+ * for a parallel build should come from a parallel dry run with the same splitBits.
+ */
+template <typename CursorT,typename BufferT = std::vector<uint8_t>>
+inline
+BinaryWORMTreeUIntGeneric<typename std::decay<CursorT>::type::PathType>
+buildWORMTreeUIntGeneric(const BinaryWORMTreeUIntParams& treeParams,const CursorT& sourceCursor,
+                         std::size_t splitBits = 0,std::size_t threadCount = 0);
+
+/**
+ * \brief Build a generic WORM tree with a single pre-order traversal of the source.
+ *
+ * The tree is written once with 8 byte offsets and values while the stats and the
+ * largest value are gathered, then shrunk in place by repackBinaryWORMTreeUInt().
+ * The value size comes out the same as with findMinimumWORMTreeUIntParameters. The
+ * offset gaps are measured with 8 byte values, so on rare occasions the offset size
+ * can come out a byte larger than the two pass build would pick.
  */
 template <typename CursorT,typename BufferT = std::vector<uint8_t>>
 inline
 BinaryWORMTreeUIntGeneric<typename std::decay<CursorT>::type::PathType>
-buildWORMTreeUIntGeneric(const BinaryWORMTreeUIntParams& treeParams,const CursorT& sourceCursor);
+buildWORMTreeUIntGenericSinglePass(const CursorT& sourceCursor,bool isLittleEndian = false);
+
+/**
+ * \brief Shrink a UInt WORM tree written with 8 byte offsets and values in place, return the new size.
+ *
+ * A single linear pass over the buffer: nodes are laid out in pre-order and never grow,
+ * so every node can be rewritten at or before where it was read from. Right child
+ * offsets are patched once the pass reaches the right child. Throws if a value or an
+ * offset doesn't fit in the new size.
+ */
+template <bool LITTLEENDIAN,template <std::size_t,bool> class HeaderBytesT = BinaryWORMNodeHeaderBytes>
+inline
+std::size_t
+repackBinaryWORMTreeUInt(uint8_t* tree,std::size_t treeSize,std::size_t offsetSize,std::size_t valueSize);
 
 /**
  * \brief Take buffer, create a generic WORM tree using parameters in treeParams.
@@ -85,21 +122,52 @@ makeWORMTreeUIntGeneric(const BinaryWORMTreeUIntParams& treeParams,BufferT&& buf
 template <typename BufferT,typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
 using BinaryWORMTreeUIntBuilder = BinaryWORMTreeBuilder<BufferT,PathT,BinaryWORMNodeUIntWO<LITTLEENDIAN,OFFSETSIZE,VALUESIZE>>;
 
+/**
+ * \brief Builder for BinaryWORMTreeUIntLongEdge trees - single child runs of up to 32 steps become one node.
+ */
+template <typename BufferT,typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE>
+using BinaryWORMTreeUIntLongEdgeBuilder = BinaryWORMTreeBuilder<BufferT,PathT,BinaryWORMNodeUIntLongEdgeWO<LITTLEENDIAN,OFFSETSIZE,VALUESIZE>>;
+
+/**
+ * \brief Source value reader for parallel UInt builds, checks values fit and tracks the largest.
+ */
+template <typename WormValueT>
+struct BinaryWORMReadSourceUInt {
+  std::atomic<uint64_t>* maxValue{nullptr};
+
+  template <typename CursorT>
+  bool operator()(const CursorT& c,WormValueT* v) const {
+    if (!c.atValue()) { return false; }
+    uint64_t value = *(c.nodeValueRO().getPtrRO());
+    *v = static_cast<WormValueT>(value);
+    if (static_cast<uint64_t>(*v) != value) {
+      throw std::runtime_error("Value exceeded capacity of WORM tree value");
+    }
+    if (maxValue != nullptr) {
+      uint64_t curMax = maxValue->load();
+      while ((value > curMax) && !maxValue->compare_exchange_weak(curMax,value)) {}
+    }
+    return true;
+  }
+};
+
 /////////////////////
 // IMPLEMENTATIONS //
 /////////////////////
 
-template <typename CursorT>
-BinaryWORMTreeUIntParams findMinimumWORMTreeUIntParameters(const CursorT& c) {
-  static_assert(std::is_unsigned<typename CursorT::ValueType>::value,
-                "findMinimumWORMTreeUIntParameters: source tree must be of unsigned integer type");
-  static_assert(sizeof(typename CursorT::ValueType) <= 8,
-                "findMinimumWORMTreeUIntParameters: source tree value too large for uint64_t");
+// Bytes needed to hold values up to maxVal, at least 1.
+inline std::size_t wormUIntBytesRequired(uint64_t maxVal) {
+  std::size_t valueBitsRequired = 0;
+  while (maxVal > 0) { ++valueBitsRequired; maxVal = (maxVal >> 1); }
+  std::size_t valueBytesRequired = (valueBitsRequired + 7)/8;
+  if (valueBytesRequired == 0) { valueBytesRequired = 1; }
+  return valueBytesRequired;
+}
 
-  using PathType = typename CursorT::PathType;
-  BinaryWORMTreeUIntParams treeParams{};
-  // do a dry run with 8 and 8 for the byte count, lttle/big endian doesn't matter
-  BinaryWORMTreeUIntBuilder<std::vector<uint8_t>,PathType,false,sizeof(uint64_t),sizeof(uint64_t)> dryRunBuilder;
+// Sequential dry run, returns the tree stats and the largest value seen.
+template <typename DryRunBuilderT,typename CursorT>
+typename DryRunBuilderT::TreeStats findMinimumWORMTreeUIntStats(const CursorT& c,uint64_t* maxValOut) {
+  DryRunBuilderT dryRunBuilder;
   auto treeIter = make_preorder_iterator<false,true>(c);
   if (!dryRunBuilder.start(true)) {
     throw std::runtime_error("Unable to start dry-run build of WORM tree!");
@@ -120,12 +188,34 @@ BinaryWORMTreeUIntParams findMinimumWORMTreeUIntParameters(const CursorT& c) {
   if (!dryRunBuilder.finish()) {
     throw std::runtime_error("Unable to finish dry-run WORM tree!");
   }
-  std::size_t valueBitsRequired = 0;
-  while (maxVal > 0) { ++valueBitsRequired; maxVal = (maxVal >> 1); }
-  std::size_t valueBytesRequired = (valueBitsRequired + 7)/8;
-  if (valueBytesRequired == 0) { valueBytesRequired = 1; }
-  treeParams.valueSize = valueBytesRequired;
-  auto treeStats = dryRunBuilder.treeStats();
+  *maxValOut = maxVal;
+  return dryRunBuilder.treeStats();
+}
+
+template <typename CursorT>
+BinaryWORMTreeUIntParams findMinimumWORMTreeUIntParameters(const CursorT& c,std::size_t splitBits,std::size_t threadCount) {
+  static_assert(std::is_unsigned<typename CursorT::ValueType>::value,
+                "findMinimumWORMTreeUIntParameters: source tree must be of unsigned integer type");
+  static_assert(sizeof(typename CursorT::ValueType) <= 8,
+                "findMinimumWORMTreeUIntParameters: source tree value too large for uint64_t");
+
+  using PathType = typename CursorT::PathType;
+  BinaryWORMTreeUIntParams treeParams{};
+  // do a dry run with 8 and 8 for the byte count, lttle/big endian doesn't matter
+  using DryRunBuilder = BinaryWORMTreeUIntBuilder<std::vector<uint8_t>,PathType,false,sizeof(uint64_t),sizeof(uint64_t)>;
+  using DryRunNode = typename DryRunBuilder::BinaryWORMNodeType;
+  typename DryRunBuilder::TreeStats treeStats{};
+  uint64_t maxVal = 0;
+  if (splitBits > 0) {
+    std::atomic<uint64_t> parallelMaxVal{0};
+    BinaryWORMTreeParallelBuilderVector<PathType,DryRunNode> parallelBuilder{splitBits,threadCount};
+    parallelBuilder.build(c,true,BinaryWORMReadSourceUInt<typename DryRunNode::ValueType>{&parallelMaxVal});
+    treeStats = parallelBuilder.treeStats();
+    maxVal = parallelMaxVal.load();
+  } else {
+    treeStats = findMinimumWORMTreeUIntStats<DryRunBuilder>(c,&maxVal);
+  }
+  treeParams.valueSize = wormUIntBytesRequired(maxVal);
   treeParams.offsetSize = treeStats.minBytesForOffset();
   return treeParams;
 }
@@ -133,12 +223,17 @@ BinaryWORMTreeUIntParams findMinimumWORMTreeUIntParameters(const CursorT& c) {
 
 template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t VALUESIZE,typename CursorT, typename BufferT>
 typename std::decay<BufferT>::type
-buildBinaryWORMTreeUIntBuffer(const CursorT& cursor,BufferT&& buffer) {
+buildBinaryWORMTreeUIntBuffer(const CursorT& cursor,BufferT&& buffer,std::size_t splitBits = 0,std::size_t threadCount = 0) {
   using CursorType =  CursorT;
   using PathType = typename CursorType::PathType;
   using BufferType = typename std::decay<BufferT>::type;
   using BuilderType = BinaryWORMTreeUIntBuilder<BufferType,PathType,LITTLEENDIAN,OFFSETSIZE,VALUESIZE>;
   using WormValueType = typename BuilderType::ValueType;
+  if (splitBits > 0) {
+    BinaryWORMTreeParallelBuilder<BufferType,PathType,typename BuilderType::BinaryWORMNodeType> parallelBuilder{splitBits,threadCount};
+    parallelBuilder.build(cursor,std::move(buffer),false,BinaryWORMReadSourceUInt<WormValueType>{});
+    return parallelBuilder.extractBuffer();
+  }
   BuilderType wormBuilder(std::move(buffer));
   auto treeIter = make_preorder_iterator<false,true>(cursor);
   if (!wormBuilder.start(false)) {
@@ -182,17 +277,18 @@ struct BuildBinaryWORMTreeUInt
 
   template <typename CursorType, typename BufferT>
   static BinaryWORMTreeUIntGeneric<PathT>
-  from(const BinaryWORMTreeUIntParams& treeParams,const CursorType& cursor,BufferT&& buffer) {
+  from(const BinaryWORMTreeUIntParams& treeParams,const CursorType& cursor,BufferT&& buffer,
+       std::size_t splitBits,std::size_t threadCount) {
     using BufferType = typename std::decay<BufferT>::type;
     if ((OFFSETSIZE == treeParams.offsetSize) &&
         (VALUESIZE == treeParams.valueSize) &&
         (LITTLEENDIAN == treeParams.isLittleEndian))
     {
-      BufferType newBuffer = buildBinaryWORMTreeUIntBuffer<LITTLEENDIAN,OFFSETSIZE,VALUESIZE>(cursor,std::move(buffer));
+      BufferType newBuffer = buildBinaryWORMTreeUIntBuffer<LITTLEENDIAN,OFFSETSIZE,VALUESIZE>(cursor,std::move(buffer),splitBits,threadCount);
       std::unique_ptr<TreeImpl<BufferType>> treeImpl{new TreeImpl<BufferType>{std::move(newBuffer)}};
       return BinaryWORMTreeUIntGeneric<PathT>{treeParams,std::move(treeImpl)};
     } else {
-      return ParentClass::from(treeParams,cursor,std::move(buffer));
+      return ParentClass::from(treeParams,cursor,std::move(buffer),splitBits,threadCount);
     }
   }
 };
@@ -204,7 +300,7 @@ struct BuildBinaryWORMTreeUInt<PathT,LITTLEENDIAN,0,sizeof(uint64_t)> {
   using TreeImpl = BinaryWORMTreeUIntGenericImpl<BufferT,PathT,LITTLEENDIAN,0,sizeof(uint64_t)>;
   template <typename CursorType, typename BufferT>
   static BinaryWORMTreeUIntGeneric<PathT>
-  from(const BinaryWORMTreeUIntParams& treeParams,const CursorType&,BufferT&&) {
+  from(const BinaryWORMTreeUIntParams& treeParams,const CursorType&,BufferT&&,std::size_t,std::size_t) {
     throw std::runtime_error("Invalid UInt binary WORM tree params: offsetsize " + std::to_string(treeParams.offsetSize) +
                              " valuesize " + std::to_string(treeParams.valueSize));
     return BinaryWORMTreeUIntGeneric<PathT>();
@@ -219,14 +315,16 @@ struct BuildBinaryWORMTreeUInt<PathT,LITTLEENDIAN,OFFSETSIZE,0>
   // this restarts the inheritance chain at OFFSETSIZE - 1
   template <typename CursorType, typename BufferType>
   static BinaryWORMTreeUIntGeneric<PathT>
-  from(const BinaryWORMTreeUIntParams& treeParams,const CursorType& cursor,BufferType&& buffer) {
-    return ParentClass::from(treeParams,cursor,std::move(buffer));
+  from(const BinaryWORMTreeUIntParams& treeParams,const CursorType& cursor,BufferType&& buffer,
+       std::size_t splitBits,std::size_t threadCount) {
+    return ParentClass::from(treeParams,cursor,std::move(buffer),splitBits,threadCount);
   }
 };
 
 template <typename CursorT,typename BufferType>
 BinaryWORMTreeUIntGeneric<typename std::decay<CursorT>::type::PathType>
-buildWORMTreeUIntGeneric(const BinaryWORMTreeUIntParams& treeParams,const CursorT& treeCursor)
+buildWORMTreeUIntGeneric(const BinaryWORMTreeUIntParams& treeParams,const CursorT& treeCursor,
+                         std::size_t splitBits,std::size_t threadCount)
 {
   static_assert(std::is_unsigned<typename CursorT::ValueType>::value,
                 "buildWORMTreeUIntBuffer: source tree must be of unsigned integer type");
@@ -236,9 +334,9 @@ buildWORMTreeUIntGeneric(const BinaryWORMTreeUIntParams& treeParams,const Cursor
   BufferType buffer{};
   
   if (treeParams.isLittleEndian) {
-    return BuildBinaryWORMTreeUInt<PathType,true>::from(treeParams,treeCursor,std::move(buffer));
+    return BuildBinaryWORMTreeUInt<PathType,true>::from(treeParams,treeCursor,std::move(buffer),splitBits,threadCount);
   } else {
-    return BuildBinaryWORMTreeUInt<PathType,false>::from(treeParams,treeCursor,std::move(buffer));
+    return BuildBinaryWORMTreeUInt<PathType,false>::from(treeParams,treeCursor,std::move(buffer),splitBits,threadCount);
   }
   return BinaryWORMTreeUIntGeneric<PathType>{};
 }
@@ -309,6 +407,116 @@ makeWORMTreeUIntGeneric(const BinaryWORMTreeUIntParams& treeParams,BufferT&& buf
   }
 }
 
+template <bool LITTLEENDIAN,template <std::size_t,bool> class HeaderBytesT>
+std::size_t
+repackBinaryWORMTreeUInt(uint8_t* tree,std::size_t treeSize,std::size_t offsetSize,std::size_t valueSize) {
+  using WideHeader = HeaderBytesT<sizeof(uint64_t),LITTLEENDIAN>;
+  using WideUInt = BinaryWORMNodeUIntOps<sizeof(uint64_t),LITTLEENDIAN>;
+  if ((offsetSize == 0) || (offsetSize > sizeof(uint64_t)) || (valueSize == 0) || (valueSize > sizeof(uint64_t))) {
+    throw std::invalid_argument("repackBinaryWORMTreeUInt: offset and value sizes must be 1 - 8 bytes");
+  }
+  auto fits = [](uint64_t v,std::size_t byteCount) { return ((byteCount >= sizeof(uint64_t)) || ((v >> (8*byteCount)) == 0)); };
+  auto writeUInt = [](uint8_t* p,uint64_t v,std::size_t byteCount) {
+    for (std::size_t b = 0; b < byteCount; ++b) {
+      p[LITTLEENDIAN ? b : (byteCount - b - 1)] = static_cast<uint8_t>(v & 0xFF);
+      v = (v >> 8);
+    }
+  };
+  // Two child nodes waiting for the pass to reach their right child, innermost last.
+  struct RightChild {
+    std::size_t readAt;
+    std::size_t nodeWrittenAt;
+    std::size_t offsetWrittenAt;
+  };
+  std::vector<RightChild> rightChildren{};
+  std::size_t readAt{0};
+  std::size_t writeAt{0};
+  while (readAt < treeSize) {
+    if (!rightChildren.empty() && (rightChildren.back().readAt <= readAt)) {
+      const RightChild& rc = rightChildren.back();
+      const uint64_t offset = (writeAt - rc.nodeWrittenAt);
+      if ((rc.readAt != readAt) || !fits(offset,offsetSize)) {
+        throw std::runtime_error("repackBinaryWORMTreeUInt: right child offset doesn't fit");
+      }
+      writeUInt(tree + rc.offsetWrittenAt,offset,offsetSize);
+      rightChildren.pop_back();
+    }
+    const uint8_t* node = tree + readAt;
+    const bool bothChildren = (WideHeader::hasChild(node,0) && WideHeader::hasChild(node,1));
+    const bool hasValue = WideHeader::hasValue(node);
+    const std::size_t headerSize = WideHeader::headerSize(node);
+    const std::size_t prefixSize = headerSize - (bothChildren ? sizeof(uint64_t) : 0);
+    const std::size_t nodeSize = headerSize + (hasValue ? sizeof(uint64_t) : 0);
+    if (readAt + nodeSize > treeSize) {
+      throw std::runtime_error("repackBinaryWORMTreeUInt: truncated tree");
+    }
+    const uint64_t value = (hasValue ? static_cast<uint64_t>(WideUInt::readUInt(node + headerSize)) : 0);
+    if (!fits(value,valueSize)) {
+      throw std::runtime_error("repackBinaryWORMTreeUInt: value doesn't fit");
+    }
+    if (bothChildren) {
+      rightChildren.push_back(RightChild{readAt + WideHeader::getRightChildOffset(node),writeAt,writeAt + prefixSize});
+    }
+    std::memmove(tree + writeAt,node,prefixSize);
+    readAt += nodeSize;
+    writeAt += prefixSize + (bothChildren ? offsetSize : 0);
+    if (hasValue) {
+      writeUInt(tree + writeAt,value,valueSize);
+      writeAt += valueSize;
+    }
+  }
+  if (!rightChildren.empty()) {
+    throw std::runtime_error("repackBinaryWORMTreeUInt: right child offset outside of tree");
+  }
+  return writeAt;
+}
+
+template <bool LITTLEENDIAN,typename BufferT,typename CursorT>
+BinaryWORMTreeUIntGeneric<typename std::decay<CursorT>::type::PathType>
+buildWORMTreeUIntGenericSinglePassImpl(const CursorT& cursor) {
+  using PathType = typename std::decay<CursorT>::type::PathType;
+  using BuilderType = BinaryWORMTreeUIntBuilder<BufferT,PathType,LITTLEENDIAN,sizeof(uint64_t),sizeof(uint64_t)>;
+  BuilderType wormBuilder{BufferT{}};
+  if (!wormBuilder.start(false)) {
+    throw std::runtime_error("Unable to start building WORM tree!");
+  }
+  uint64_t maxVal = 0;
+  auto treeIter = make_preorder_iterator<false,true>(cursor);
+  while (!treeIter.finished()) {
+    uint64_t value{};
+    bool atValue = treeIter->atValue();
+    if (atValue) {
+      value = *(treeIter->nodeValueRO().getPtrRO());
+      if (value > maxVal) { maxVal = value; }
+    }
+    wormBuilder.addNode(treeIter->getPath(),atValue,atValue ? &value : nullptr,
+                        {treeIter->canGoChildNode(0),treeIter->canGoChildNode(1)});
+    treeIter++;
+  }
+  if (!wormBuilder.finish()) {
+    throw std::runtime_error("Unable to finish building WORM tree!");
+  }
+  const BinaryWORMTreeUIntParams treeParams{LITTLEENDIAN,wormBuilder.treeStats().minBytesForOffset(),wormUIntBytesRequired(maxVal)};
+  const std::size_t wideSize = wormBuilder.sizeofBuffer();
+  BufferT buffer = wormBuilder.extractBuffer();
+  buffer.resize(repackBinaryWORMTreeUInt<LITTLEENDIAN>(buffer.data(),wideSize,treeParams.offsetSize,treeParams.valueSize));
+  return makeWORMTreeUIntGeneric<PathType>(treeParams,std::move(buffer));
+}
+
+template <typename CursorT,typename BufferT>
+BinaryWORMTreeUIntGeneric<typename std::decay<CursorT>::type::PathType>
+buildWORMTreeUIntGenericSinglePass(const CursorT& sourceCursor,bool isLittleEndian) {
+  static_assert(std::is_unsigned<typename CursorT::ValueType>::value,
+                "buildWORMTreeUIntGenericSinglePass: source tree must be of unsigned integer type");
+  static_assert(sizeof(typename CursorT::ValueType) <= 8,
+                "buildWORMTreeUIntGenericSinglePass: source tree value too large for uint64_t");
+  if (isLittleEndian) {
+    return buildWORMTreeUIntGenericSinglePassImpl<true,BufferT>(sourceCursor);
+  } else {
+    return buildWORMTreeUIntGenericSinglePassImpl<false,BufferT>(sourceCursor);
+  }
+}
+
 } // namespace RadixTree
 } // namespace Mapper
 } // namespace Akamai
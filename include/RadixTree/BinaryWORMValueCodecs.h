@@ -0,0 +1,359 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_VALUE_CODECS_H_
+#define AKAMAI_MAPPER_RADIX_TREE_BINARY_WORM_VALUE_CODECS_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "CursorIterator.h"
+
+#include "BinaryWORMNode.h"
+#include "BinaryWORMNodeHeaderBytes.h"
+#include "BinaryWORMTree.h"
+#include "BinaryWORMTreeBuilder.h"
+#include "ValueDictionary.h"
+
+/**
+ * \file BinaryWORMValueCodecs.h
+ * Variable length value codecs for binary WORM trees, to go with the fixed size
+ * BinaryWORMReadWriteUInt, and a generic builder for trees of any value type.
+ *
+ * - BinaryWORMReadWriteVarUInt: unsigned integers as LEB128 varints, 1-10 bytes each.
+ * - BinaryWORMReadWriteBytes: byte strings, a varint length followed by the bytes.
+ * - BinaryWORMReadWriteStringRef: fixed size reference into a deduplicated string section
+ *   appended after the tree, so every distinct string is stored once. Build these trees
+ *   with buildBinaryWORMTreeStringRefBuffer().
+ *
+ * Cursors construct value readers on the fly, so readers can't carry state. The string
+ * references are therefore stored relative to the reference itself: a forward byte offset
+ * from the value to its entry in the string section.
+ */
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \brief LEB128 unsigned varint encoding: 7 bits per byte, low bits first, top bit set on all but the last byte.
+ */
+struct BinaryWORMVarUInt {
+  static constexpr std::size_t MaxSize = 10;
+  static std::size_t size(uint64_t v) {
+    std::size_t s = 1;
+    while (v >= 0x80) { v >>= 7; ++s; }
+    return s;
+  }
+  static std::size_t write(uint64_t v,uint8_t* b) {
+    std::size_t s = 0;
+    while (v >= 0x80) {
+      b[s++] = static_cast<uint8_t>(v | 0x80);
+      v >>= 7;
+    }
+    b[s++] = static_cast<uint8_t>(v);
+    return s;
+  }
+  static std::size_t read(const uint8_t* b,uint64_t* v) {
+    uint64_t r{0};
+    std::size_t s = 0;
+    do {
+      r |= (static_cast<uint64_t>(b[s] & 0x7F) << (7*s));
+    } while ((b[s++] & 0x80) && (s < MaxSize));
+    *v = r;
+    return s;
+  }
+  static std::size_t readSize(const uint8_t* b) {
+    std::size_t s = 1;
+    while ((b[s - 1] & 0x80) && (s < MaxSize)) { ++s; }
+    return s;
+  }
+};
+
+/**
+ * \brief Value codec for uint64_t values stored as varints, small values take a single byte.
+ */
+struct BinaryWORMReadWriteVarUInt {
+  using ValueType = uint64_t;
+
+  static std::string valueTypeID() { static std::string vt = "AKAMAI-VARUINT"; return vt; }
+
+  static std::size_t readSize(const uint8_t* valBuf) { return BinaryWORMVarUInt::readSize(valBuf); }
+  static std::size_t read(const uint8_t* valBuf,ValueType* valPtr) { return BinaryWORMVarUInt::read(valBuf,valPtr); }
+  static std::size_t writeSize(const ValueType* valPtr) { return BinaryWORMVarUInt::size(*valPtr); }
+  static std::size_t write(const ValueType* valPtr,uint8_t* valBuf) { return BinaryWORMVarUInt::write(*valPtr,valBuf); }
+};
+
+/**
+ * \brief Value codec for byte strings held in std::string, stored inline as varint length + bytes.
+ */
+struct BinaryWORMReadWriteBytes {
+  using ValueType = std::string;
+
+  static std::string valueTypeID() { static std::string vt = "AKAMAI-BYTES"; return vt; }
+
+  static std::size_t readSize(const uint8_t* valBuf) {
+    uint64_t length{0};
+    std::size_t s = BinaryWORMVarUInt::read(valBuf,&length);
+    return (s + static_cast<std::size_t>(length));
+  }
+  static std::size_t read(const uint8_t* valBuf,ValueType* valPtr) {
+    uint64_t length{0};
+    std::size_t s = BinaryWORMVarUInt::read(valBuf,&length);
+    valPtr->assign(reinterpret_cast<const char*>(valBuf + s),static_cast<std::size_t>(length));
+    return (s + static_cast<std::size_t>(length));
+  }
+  static std::size_t writeSize(const ValueType* valPtr) { return (BinaryWORMVarUInt::size(valPtr->size()) + valPtr->size()); }
+  static std::size_t write(const ValueType* valPtr,uint8_t* valBuf) {
+    std::size_t s = BinaryWORMVarUInt::write(valPtr->size(),valBuf);
+    std::memcpy(valBuf + s,valPtr->data(),valPtr->size());
+    return (s + valPtr->size());
+  }
+};
+
+/**
+ * \brief Deduplicated strings collected while building a string reference tree.
+ *
+ * A ValueDictionary plus the size of the section it writes out. Strings are numbered in the order they are first added. The section written out is
+ * every string in that order, each as varint length + bytes (BinaryWORMReadWriteBytes).
+ */
+class BinaryWORMStringTable {
+public:
+  /**
+   * \brief Add s if it isn't there yet, return its ID.
+   */
+  inline std::size_t add(const std::string& s);
+  std::size_t size() const { return strings_.size(); }
+  const std::string& string(std::size_t id) const { return strings_.at(id); }
+  std::size_t sectionSize() const { return sectionSize_; }
+
+  /**
+   * \brief Write the section to b (sectionSize() bytes), return each string's offset from b.
+   */
+  inline std::vector<std::size_t> writeSection(uint8_t* b) const;
+
+private:
+  ValueDictionary<std::string,std::size_t> strings_{};
+  std::size_t sectionSize_{0};
+};
+
+/**
+ * \brief Value codec storing std::string values as REFSIZE byte references into a string section.
+ *
+ * Writing records the string in the table it was given and stores its ID; reading
+ * expects the IDs to have been replaced by offsets by resolveBinaryWORMStringRefs().
+ */
+template <std::size_t REFSIZE,bool LITTLEENDIAN>
+struct BinaryWORMReadWriteStringRef {
+  using RefOps = BinaryWORMNodeUIntOps<REFSIZE,LITTLEENDIAN>;
+  using ValueType = std::string;
+  static constexpr std::size_t RefSize = REFSIZE;
+  static constexpr bool LittleEndian = LITTLEENDIAN;
+
+  BinaryWORMReadWriteStringRef() = default;
+  BinaryWORMReadWriteStringRef(BinaryWORMStringTable* t) : table(t) {}
+
+  static std::string valueTypeID() {
+    static std::string vt = std::string("AKAMAI-STRINGREF-") +
+                            (LittleEndian ? "LITTLEENDIAN-" : "BIGENDIAN-") +
+                            std::to_string(RefSize);
+    return vt;
+  }
+
+  static std::size_t readSize(const uint8_t*) { return RefSize; }
+  static std::size_t read(const uint8_t* valBuf,ValueType* valPtr) {
+    BinaryWORMReadWriteBytes::read(valBuf + RefOps::readUInt(valBuf),valPtr);
+    return RefSize;
+  }
+
+  static std::size_t writeSize(const ValueType*) { return RefSize; }
+  std::size_t write(const ValueType* valPtr,uint8_t* valBuf) const {
+    if (table == nullptr) { throw std::runtime_error("BinaryWORMReadWriteStringRef: no string table to write to"); }
+    RefOps::writeUInt(valBuf,static_cast<typename RefOps::UIntType>(table->add(*valPtr)));
+    return RefSize;
+  }
+
+  BinaryWORMStringTable* table{nullptr};
+};
+
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE>
+using BinaryWORMNodeVarUIntWO = BinaryWORMNodeWO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteVarUInt>;
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE>
+using BinaryWORMNodeVarUIntRO = BinaryWORMNodeRO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteVarUInt>;
+template <typename BufferT,typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE>
+using BinaryWORMTreeVarUInt = BinaryWORMTree<BufferT,PathT,BinaryWORMNodeVarUIntRO<LITTLEENDIAN,OFFSETSIZE>>;
+
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE>
+using BinaryWORMNodeBytesWO = BinaryWORMNodeWO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteBytes>;
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE>
+using BinaryWORMNodeBytesRO = BinaryWORMNodeRO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteBytes>;
+template <typename BufferT,typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE>
+using BinaryWORMTreeBytes = BinaryWORMTree<BufferT,PathT,BinaryWORMNodeBytesRO<LITTLEENDIAN,OFFSETSIZE>>;
+
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t REFSIZE>
+using BinaryWORMNodeStringRefWO = BinaryWORMNodeWO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteStringRef<REFSIZE,LITTLEENDIAN>>;
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t REFSIZE>
+using BinaryWORMNodeStringRefRO = BinaryWORMNodeRO<OFFSETSIZE,LITTLEENDIAN,BinaryWORMReadWriteStringRef<REFSIZE,LITTLEENDIAN>>;
+template <typename BufferT,typename PathT,bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t REFSIZE>
+using BinaryWORMTreeStringRef = BinaryWORMTree<BufferT,PathT,BinaryWORMNodeStringRefRO<LITTLEENDIAN,OFFSETSIZE,REFSIZE>>;
+
+/**
+ * \brief Default source value conversion for buildBinaryWORMTreeBuffer(), a plain conversion to ToT.
+ */
+template <typename ToT>
+struct BinaryWORMConvertValue {
+  template <typename FromT>
+  ToT operator()(const FromT& v) const { return ToT(v); }
+};
+
+/**
+ * \brief Build a WORM tree of NodeWOT nodes into buffer from a pre-order walk of any tree cursor.
+ *
+ * Source values are turned into NodeWOT values with convert, the node values are written
+ * with wv. Throws std::runtime_error if the tree needs larger offsets than NodeWOT has.
+ */
+template <typename NodeWOT,typename CursorT,typename BufferT,typename ConvertT = BinaryWORMConvertValue<typename NodeWOT::ValueType>>
+inline
+typename std::decay<BufferT>::type
+buildBinaryWORMTreeBuffer(const CursorT& cursor,BufferT&& buffer,
+                          const typename NodeWOT::WriteValueType& wv = typename NodeWOT::WriteValueType{},
+                          const ConvertT& convert = ConvertT{});
+
+/**
+ * \brief Replace the string IDs in a string reference tree by offsets to their entries.
+ *
+ * entryAt[id] is the position of string id's entry relative to the tree start. Walks the
+ * treeSize bytes of nodes in a single pass. Throws std::runtime_error if an ID is unknown
+ * or an offset doesn't fit in REFSIZE bytes.
+ */
+template <typename HeaderBytesT,std::size_t REFSIZE,bool LITTLEENDIAN>
+inline void
+resolveBinaryWORMStringRefs(uint8_t* tree,std::size_t treeSize,const std::vector<std::size_t>& entryAt);
+
+/**
+ * \brief Build a BinaryWORMTreeStringRef buffer: the tree followed by its string section.
+ *
+ * Source values must convert to std::string. Repeated strings are stored once, which is
+ * where most of the saving over a pointer based string tree comes from.
+ */
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t REFSIZE,typename CursorT,typename BufferT>
+inline
+typename std::decay<BufferT>::type
+buildBinaryWORMTreeStringRefBuffer(const CursorT& cursor,BufferT&& buffer);
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+std::size_t BinaryWORMStringTable::add(const std::string& s) {
+  const std::size_t count = strings_.size();
+  const std::size_t id = strings_.intern(s);
+  if (strings_.size() != count) { sectionSize_ += BinaryWORMReadWriteBytes::writeSize(&s); }
+  return id;
+}
+
+std::vector<std::size_t> BinaryWORMStringTable::writeSection(uint8_t* b) const {
+  std::vector<std::size_t> entryAt;
+  entryAt.reserve(strings_.size());
+  std::size_t at = 0;
+  for (std::size_t id = 0; id < strings_.size(); ++id) {
+    entryAt.push_back(at);
+    at += BinaryWORMReadWriteBytes::write(&(strings_[id]),b + at);
+  }
+  return entryAt;
+}
+
+template <typename NodeWOT,typename CursorT,typename BufferT,typename ConvertT>
+typename std::decay<BufferT>::type
+buildBinaryWORMTreeBuffer(const CursorT& cursor,BufferT&& buffer,const typename NodeWOT::WriteValueType& wv,const ConvertT& convert) {
+  using PathType = typename CursorT::PathType;
+  using BufferType = typename std::decay<BufferT>::type;
+  using WormValueType = typename NodeWOT::ValueType;
+  BinaryWORMTreeBuilder<BufferType,PathType,NodeWOT> wormBuilder{std::move(buffer),false,wv};
+  if (!wormBuilder.start(false)) {
+    throw std::runtime_error("Unable to start building WORM tree!");
+  }
+  auto treeIter = make_preorder_iterator<false,true>(cursor);
+  while (!treeIter.finished()) {
+    const bool atValue = treeIter->atValue();
+    WormValueType wormValue{};
+    if (atValue) { wormValue = convert(*(treeIter->nodeValueRO().getPtrRO())); }
+    wormBuilder.addNode(treeIter->getPath(),atValue,atValue ? &wormValue : nullptr,
+                        {treeIter->canGoChildNode(0),treeIter->canGoChildNode(1)});
+    treeIter++;
+  }
+  wormBuilder.finish();
+  if (wormBuilder.treeStats().minBytesForOffset() > NodeWOT::OffsetSize) {
+    throw std::runtime_error("WORM tree offsets exceed " + std::to_string(NodeWOT::OffsetSize) + " bytes");
+  }
+  return wormBuilder.extractBuffer();
+}
+
+template <typename HeaderBytesT,std::size_t REFSIZE,bool LITTLEENDIAN>
+void
+resolveBinaryWORMStringRefs(uint8_t* tree,std::size_t treeSize,const std::vector<std::size_t>& entryAt) {
+  using RefOps = BinaryWORMNodeUIntOps<REFSIZE,LITTLEENDIAN>;
+  // Nodes are laid out back to back in pre-order, no need to follow child offsets
+  std::size_t at = 0;
+  while (at < treeSize) {
+    const uint8_t* node = tree + at;
+    at += HeaderBytesT::headerSize(node);
+    if (!HeaderBytesT::hasValue(node)) { continue; }
+    if ((at + REFSIZE) > treeSize) { throw std::runtime_error("resolveBinaryWORMStringRefs: truncated tree"); }
+    const std::size_t id = static_cast<std::size_t>(RefOps::readUInt(tree + at));
+    if (id >= entryAt.size()) { throw std::runtime_error("resolveBinaryWORMStringRefs: unknown string ID"); }
+    const uint64_t offset = static_cast<uint64_t>(entryAt[id] - at);
+    if (offset > static_cast<uint64_t>(RefOps::UINT_MASK)) {
+      throw std::runtime_error("resolveBinaryWORMStringRefs: string section beyond " + std::to_string(REFSIZE) + " byte references");
+    }
+    RefOps::writeUInt(tree + at,static_cast<typename RefOps::UIntType>(offset));
+    at += REFSIZE;
+  }
+}
+
+template <bool LITTLEENDIAN,std::size_t OFFSETSIZE,std::size_t REFSIZE,typename CursorT,typename BufferT>
+typename std::decay<BufferT>::type
+buildBinaryWORMTreeStringRefBuffer(const CursorT& cursor,BufferT&& buffer) {
+  using NodeWO = BinaryWORMNodeStringRefWO<LITTLEENDIAN,OFFSETSIZE,REFSIZE>;
+  using HeaderBytes = typename BinaryWORMNodeStringRefRO<LITTLEENDIAN,OFFSETSIZE,REFSIZE>::HeaderBytes;
+  BinaryWORMStringTable table{};
+  typename std::decay<BufferT>::type out =
+    buildBinaryWORMTreeBuffer<NodeWO>(cursor,std::move(buffer),typename NodeWO::WriteValueType{&table});
+  const std::size_t treeSize = out.size();
+  out.resize(treeSize + table.sectionSize());
+  std::vector<std::size_t> entryAt = table.writeSection(out.data() + treeSize);
+  for (std::size_t& e : entryAt) { e += treeSize; }
+  resolveBinaryWORMStringRefs<HeaderBytes,REFSIZE,LITTLEENDIAN>(out.data(),treeSize,entryAt);
+  return out;
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
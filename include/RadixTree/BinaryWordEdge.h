@@ -25,8 +25,11 @@ SOFTWARE.
 
 #include <cstddef>
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <exception>
 #include <stdexcept>
+#include <type_traits>
 
 namespace Akamai {
 namespace Mapper {
@@ -161,6 +164,26 @@ struct WordEdgeBitTraits<uint32_t,17>
   static constexpr std::size_t pathBits = 11; 
 };
 
+/**
+ * \brief 32 bit integers, 2 bit left child mode, 1 bit for presence of value, 8 bit value.
+ */
+template <>
+struct WordEdgeBitTraits<uint32_t,11>
+{
+  static constexpr std::size_t sizeBits = 5;
+  static constexpr std::size_t pathBits = 16;
+};
+
+/**
+ * \brief 32 bit integers, 2 bit left child mode, 1 bit for presence of value, 16 bit value.
+ */
+template <>
+struct WordEdgeBitTraits<uint32_t,19>
+{
+  static constexpr std::size_t sizeBits = 4;
+  static constexpr std::size_t pathBits = 9;
+};
+
 /**
  * \brief 64 bit integers, nothing reserved.
  */
@@ -222,6 +245,36 @@ struct WordEdgeBitTraits<uint64_t,33>
 };
 
 
+/**
+ * \brief 64 bit integers, 2 bit left child mode, 1 bit for presence of value, 8 bit value.
+ */
+template <>
+struct WordEdgeBitTraits<uint64_t,11>
+{
+  static constexpr std::size_t sizeBits = 6;
+  static constexpr std::size_t pathBits = 47;
+};
+
+/**
+ * \brief 64 bit integers, 2 bit left child mode, 1 bit for presence of value, 16 bit value.
+ */
+template <>
+struct WordEdgeBitTraits<uint64_t,19>
+{
+  static constexpr std::size_t sizeBits = 6;
+  static constexpr std::size_t pathBits = 39;
+};
+
+/**
+ * \brief 64 bit integers, 2 bit left child mode, 1 bit for presence of value, 32 bit value.
+ */
+template <>
+struct WordEdgeBitTraits<uint64_t,35>
+{
+  static constexpr std::size_t sizeBits = 5;
+  static constexpr std::size_t pathBits = 24;
+};
+
 
 /**
  * \brief Simple in-place, word-sized edge.
@@ -328,6 +381,122 @@ private:
 template <typename WordType,typename AllocatorType>
 using SimpleBinaryWordEdgeRef = BinaryWordEdgeRef<AllocatorType,WordType,WordEdgeBitTraits<WordType>::sizeBits,WordEdgeBitTraits<WordType>::pathBits>;
 
+/**
+ * \brief Bit split for an edge that starts in the spare bits of an info word and continues into ExtraWords full words.
+ */
+template <typename WordType,std::size_t ExtraWords,std::size_t LeadingBits>
+struct MultiWordEdgeBitTraits
+{
+  static constexpr std::size_t bitsFor(std::size_t n) { return ((n == 0) ? 0 : (1 + bitsFor(n >> 1))); }
+  static constexpr std::size_t wordBits = 8*sizeof(WordType);
+  static constexpr std::size_t sizeBits = bitsFor(wordBits*(ExtraWords + 1));
+  static constexpr std::size_t headBits = (wordBits - (LeadingBits + sizeBits));
+  static constexpr std::size_t pathBits = (headBits + ExtraWords*wordBits);
+};
+
+/**
+ * \brief Reference edge spread over several words of a node, for edges longer than a single word can hold.
+ *
+ * The first part of the edge lives in the info word (word 0 of the node) exactly like
+ * BinaryWordEdgeRef - LeadingBits reserved for the node, then the edge size, then path
+ * bits - and the path carries on MSB first through ExtraWords whole words starting at
+ * word ExtraWordAt of the node. Copy/move semantics match BinaryWordEdgeRef: copy
+ * construction makes a standalone edge, assignment copies edge bits into wherever this
+ * edge lives and leaves the reserved bits alone.
+ */
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits = 1>
+class BinaryMultiWordEdgeRef
+{
+public:
+  using MyType = BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>;
+  using BitTraits = MultiWordEdgeBitTraits<WordType,ExtraWords,LeadingBits>;
+  using RefType = typename AllocatorType::RefType;
+  static_assert(std::is_integral<WordType>::value && !std::is_signed<WordType>::value,"WordType must be unsigned");
+  static_assert(ExtraWords > 0,"use BinaryWordEdgeRef for single word edges");
+  static_assert(BitTraits::headBits > 0,"no room left in the info word for edge bits");
+
+  static constexpr std::size_t Radix = 2;
+  static constexpr std::size_t MaxDepth = BitTraits::pathBits;
+  static constexpr std::size_t WordBits = BitTraits::wordBits;
+  static constexpr std::size_t SizeBits = BitTraits::sizeBits;
+  static constexpr std::size_t HeadBits = BitTraits::headBits;
+
+  static constexpr WordType maskBits(uint32_t bitCount,uint32_t offset) {
+    return ((bitCount >= WordBits) ? static_cast<WordType>(~static_cast<WordType>(0)) : static_cast<WordType>(((static_cast<WordType>(0x1) << bitCount) - 1) << offset));
+  }
+  static constexpr WordType maskSize = maskBits(SizeBits,HeadBits);
+  static constexpr WordType maskHeadBits = maskBits(HeadBits,0);
+  static constexpr WordType maskEdge = (maskSize | maskHeadBits);
+
+  BinaryMultiWordEdgeRef() = default;
+  BinaryMultiWordEdgeRef(const AllocatorType* a,RefType r) : alloc_(a), ref_(r) {}
+  BinaryMultiWordEdgeRef(const BinaryMultiWordEdgeRef& other) { copyEdgeFrom(other); }
+  BinaryMultiWordEdgeRef(BinaryMultiWordEdgeRef&& other)
+    : alloc_(other.alloc_)
+    , ref_(other.ref_)
+    , words_(other.words_)
+  {
+    other.alloc_ = nullptr;
+    other.ref_ = AllocatorType::nullRef;
+  }
+  BinaryMultiWordEdgeRef& operator=(const BinaryMultiWordEdgeRef& other) {
+    if (this != &other) { copyEdgeFrom(other); }
+    return *this;
+  }
+  BinaryMultiWordEdgeRef& operator=(BinaryMultiWordEdgeRef&& other) {
+    if (this == &other) { return *this; }
+    alloc_ = other.alloc_;
+    ref_ = other.ref_;
+    words_[0] = ((words_[0] & ~maskEdge) | (other.words_[0] & maskEdge));
+    for (std::size_t i = 1; i <= ExtraWords; ++i) { words_[i] = other.words_[i]; }
+    other.alloc_ = nullptr;
+    other.ref_ = AllocatorType::nullRef;
+    return *this;
+  }
+
+  std::size_t size() const { return ((word(0) & maskSize) >> HeadBits); }
+  bool full() const { return (size() == MaxDepth); }
+  bool empty() const { return (size() == 0); }
+  std::size_t capacity() const { return MaxDepth; }
+  void clear() { setSize(0); }
+  inline void push_back(std::size_t c);
+  inline void pop_back();
+  std::size_t at(std::size_t p) const { return pathBit(p); }
+  std::size_t operator[](std::size_t p) const { return pathBit(p); }
+  bool operator==(const MyType& other) const { return ((size() == other.size()) && (matching(other) == size())); }
+  bool operator!=(const MyType& other) const { return !(*this == other); }
+  inline std::size_t matching(const MyType& other) const;
+  inline void trim_back(std::size_t n);
+  inline void trim_front(std::size_t n);
+  bool coveredby(const MyType& other) const { return ((size() <= other.size()) && (matching(other) == size())); }
+
+  bool isRef() const { return (ref_ != AllocatorType::nullRef); }
+
+private:
+  const AllocatorType* alloc_{nullptr};
+  RefType ref_{AllocatorType::nullRef};
+  std::array<WordType,ExtraWords + 1> words_{};
+
+  // Word 0 is the info word, 1..ExtraWords the overflow words.
+  const WordType& word(std::size_t i) const {
+    if (!isRef()) { return words_[i]; }
+    return alloc_->getPtr(ref_)[(i == 0) ? 0 : (ExtraWordAt + i - 1)];
+  }
+  WordType& word(std::size_t i) {
+    if (!isRef()) { return words_[i]; }
+    return alloc_->getPtr(ref_)[(i == 0) ? 0 : (ExtraWordAt + i - 1)];
+  }
+  void setSize(std::size_t s) { word(0) = ((word(0) & ~maskSize) | ((static_cast<WordType>(s) << HeadBits) & maskSize)); }
+  inline void copyEdgeFrom(const MyType& other);
+  inline std::size_t pathBit(std::size_t n) const;
+  inline std::size_t rawBit(std::size_t n) const;
+  inline void setRawBit(std::size_t n,std::size_t b);
+  // Path bits of word i shifted up so the first step is the MSB, and the step count it holds.
+  WordType chunk(std::size_t i) const { return ((i == 0) ? static_cast<WordType>(word(0) << (LeadingBits + SizeBits)) : word(i)); }
+  static constexpr std::size_t chunkStart(std::size_t i) { return ((i == 0) ? 0 : (HeadBits + (i - 1)*WordBits)); }
+  static constexpr std::size_t chunkBits(std::size_t i) { return ((i == 0) ? HeadBits : WordBits); }
+};
+
 
 /////////////////////
 // IMPLEMENTATIONS //
@@ -502,6 +671,84 @@ BinaryWordEdgeBase<ImplClass,WordType,SizeBits,PathBits,LeadingBits,TrailingBits
 }
 
 
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+void BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::push_back(std::size_t c) {
+  std::size_t oldSize = size();
+  if (oldSize == MaxDepth) { throw std::length_error("[BinaryMultiWordEdgeRef] push_back: edge full"); }
+  setRawBit(oldSize,c);
+  setSize(oldSize + 1);
+}
+
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+void BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::pop_back() {
+  if (empty()) { throw std::length_error("[BinaryMultiWordEdgeRef] pop_back: edge empty"); }
+  setSize(size() - 1);
+}
+
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+std::size_t
+BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::matching(const MyType& other) const {
+  const std::size_t longestMatch = std::min(size(),other.size());
+  // Compare a word at a time, the first differing bit inside the compared range ends the match.
+  for (std::size_t i = 0; (i <= ExtraWords) && (chunkStart(i) < longestMatch); ++i) {
+    const std::size_t bits = std::min(chunkBits(i),longestMatch - chunkStart(i));
+    const WordType cmp = ((chunk(i) ^ other.chunk(i)) & static_cast<WordType>(~maskBits(WordBits - bits,0)));
+    if (cmp != 0) {
+      return chunkStart(i) + (__builtin_clzll(static_cast<unsigned long long>(cmp)) - (64 - WordBits));
+    }
+  }
+  return longestMatch;
+}
+
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+void BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::trim_back(std::size_t n) {
+  std::size_t mySize = size();
+  if (mySize < n) { throw std::length_error("[BinaryMultiWordEdgeRef] trim_back: attempting to trim more bits than in edge"); }
+  setSize(mySize - n);
+}
+
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+void BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::trim_front(std::size_t n) {
+  std::size_t mySize = size();
+  if (mySize < n) { throw std::length_error("[BinaryMultiWordEdgeRef] trim_front: attempting to trim more bits than in edge"); }
+  // Only happens when a node gets split, a bit at a time is plenty.
+  for (std::size_t i = n; i < mySize; ++i) { setRawBit(i - n,rawBit(i)); }
+  setSize(mySize - n);
+}
+
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+void BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::copyEdgeFrom(const MyType& other) {
+  word(0) = ((word(0) & ~maskEdge) | (other.word(0) & maskEdge));
+  for (std::size_t i = 1; i <= ExtraWords; ++i) { word(i) = other.word(i); }
+}
+
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+std::size_t BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::pathBit(std::size_t n) const {
+  if (n >= size()) { throw std::length_error("[BinaryMultiWordEdgeRef] path bit out of range"); }
+  return rawBit(n);
+}
+
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+std::size_t BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::rawBit(std::size_t n) const {
+  if (n < HeadBits) { return ((word(0) >> (HeadBits - n - 1)) & 0x1); }
+  n -= HeadBits;
+  return ((word(1 + n/WordBits) >> (WordBits - (n % WordBits) - 1)) & 0x1);
+}
+
+template <typename AllocatorType,typename WordType,std::size_t ExtraWords,std::size_t ExtraWordAt,std::size_t LeadingBits>
+void BinaryMultiWordEdgeRef<AllocatorType,WordType,ExtraWords,ExtraWordAt,LeadingBits>::setRawBit(std::size_t n,std::size_t b) {
+  std::size_t w = 0;
+  std::size_t shift = (HeadBits - n - 1);
+  if (n >= HeadBits) {
+    n -= HeadBits;
+    w = 1 + n/WordBits;
+    shift = (WordBits - (n % WordBits) - 1);
+  }
+  const WordType bit = static_cast<WordType>(static_cast<WordType>(0x1) << shift);
+  if (b > 0) { word(w) |= bit; }
+  else { word(w) &= static_cast<WordType>(~bit); }
+}
+
 } // namespace RadixTree
 } // namespace Mapper
 } // namespace Akamai
@@ -27,8 +27,11 @@ SOFTWARE.
 #include <limits>
 #include <stdint.h>
 #include <array>
+#include <stdexcept>
+#include <vector>
 
 #include "BinaryWordEdge.h"
+#include "WordArrayView.h"
 #include "WordBlockAllocator.h"
 
 namespace Akamai {
@@ -39,17 +42,15 @@ namespace RadixTree {
  * \brief Utility base class for multi-word binary tree nodes.
  * 
  * Implements the node interface abstraction except for the parts about
- * manipulating node values - those are implemented by subclasses.
+ * manipulating node values - those are implemented by subclasses. EdgeT
+ * is a reference edge constructed from (allocator,node ref).
  */
-template <typename WordType,std::size_t WordCount,std::size_t ExtLead,std::size_t ExtTrail,template <typename,std::size_t> class WordAlloc>
-class BinaryWordNodeBase
+template <typename WordType,std::size_t WordCount,typename EdgeT,template <typename,std::size_t> class WordAlloc>
+class BinaryWordNodeEdgeBase
 {
 public:
   using AllocatorType = WordAlloc<WordType,WordCount>;
-  static constexpr std::size_t InfoBitsReserved = (ExtLead + ExtTrail);
-  using ExtTraits = WordEdgeBitTraits<WordType,InfoBitsReserved>;
-  // Ref edge, but we steal some bits for metadata
-  using Edge = BinaryWordEdgeRef<AllocatorType,WordType,ExtTraits::sizeBits,ExtTraits::pathBits,ExtLead,ExtTrail>;
+  using Edge = EdgeT;
   using NodeImplRefType = WordType;
   using NodeImplType = WordType*;
   // Order of binary tree is always 2
@@ -64,11 +65,11 @@ public:
   static_assert(std::is_integral<WordType>::value && !std::numeric_limits<WordType>::is_signed,
                 "node word base unit must be an unsigned integer");
 
-  BinaryWordNodeBase() = default;
-  virtual ~BinaryWordNodeBase() = default;
-  explicit BinaryWordNodeBase(const AllocatorType* a,NodeImplRefType n) : alloc_(a), nodeRef_(n), ext_(a,n) {}
-  BinaryWordNodeBase(const BinaryWordNodeBase& other) : alloc_(other.alloc_), nodeRef_(other.nodeRef_), ext_(other.alloc_,other.nodeRef_) {}
-  BinaryWordNodeBase(BinaryWordNodeBase&& other)
+  BinaryWordNodeEdgeBase() = default;
+  virtual ~BinaryWordNodeEdgeBase() = default;
+  explicit BinaryWordNodeEdgeBase(const AllocatorType* a,NodeImplRefType n) : alloc_(a), nodeRef_(n), ext_(a,n) {}
+  BinaryWordNodeEdgeBase(const BinaryWordNodeEdgeBase& other) : alloc_(other.alloc_), nodeRef_(other.nodeRef_), ext_(other.alloc_,other.nodeRef_) {}
+  BinaryWordNodeEdgeBase(BinaryWordNodeEdgeBase&& other)
     : alloc_(other.alloc_)
     , nodeRef_(other.nodeRef_)
     , ext_(std::move(other.ext_))
@@ -78,7 +79,7 @@ public:
     other.ext_ = Edge{};
   }
 
-  BinaryWordNodeBase& operator=(const BinaryWordNodeBase& other) {
+  BinaryWordNodeEdgeBase& operator=(const BinaryWordNodeEdgeBase& other) {
     if (this == &other) { return *this; }
     alloc_ = other.alloc_;
     nodeRef_ = other.nodeRef_;
@@ -86,7 +87,7 @@ public:
     return *this;
   }
 
-  BinaryWordNodeBase& operator=(BinaryWordNodeBase&& other) {
+  BinaryWordNodeEdgeBase& operator=(BinaryWordNodeEdgeBase&& other) {
     if (this == &other) { return *this; }
     alloc_ = other.alloc_;
     nodeRef_ = other.nodeRef_;
@@ -126,8 +127,21 @@ public:
 
   bool isLeaf() const { return !(hasChild(0) || hasChild(1)); }
 
+  /**
+   * \brief Relayout every node under root contiguously in pre-order, see RadixTree::compact().
+   */
+  static NodeImplRefType compact(AllocatorType& a,NodeImplRefType root) { return a.compact(root,LeftChildWord,Radix); }
+
 protected:
   WordType* chunk() const { return alloc_->getPtr(nodeRef_); }
+  const AllocatorType* allocator() const { return alloc_; }
+  NodeImplRefType nodeRef() const { return nodeRef_; }
+  // Keep the allocator's value count current, call before changing the has-value bit
+  void noteValueChange(bool hadValue,bool hasValue) const {
+    if (hadValue == hasValue) { return; }
+    if (hasValue) { alloc_->noteValueSet(); }
+    else { alloc_->noteValueCleared(); }
+  }
 
 private:
   const AllocatorType* alloc_{nullptr};
@@ -136,6 +150,17 @@ private:
 };
 
 
+/**
+ * \brief Node base whose edge lives in the spare bits of the info word.
+ */
+template <typename WordType,std::size_t WordCount,std::size_t ExtLead,std::size_t ExtTrail,template <typename,std::size_t> class WordAlloc>
+using BinaryWordNodeBase =
+  BinaryWordNodeEdgeBase<WordType,WordCount,
+                         BinaryWordEdgeRef<WordAlloc<WordType,WordCount>,WordType,
+                                           WordEdgeBitTraits<WordType,ExtLead + ExtTrail>::sizeBits,
+                                           WordEdgeBitTraits<WordType,ExtLead + ExtTrail>::pathBits,ExtLead,ExtTrail>,
+                         WordAlloc>;
+
 /**
  * \brief Binary radix tree node/edge implemented on top of 4 integer words.
  *
@@ -176,8 +201,79 @@ public:
   }
   
   bool hasValue() const { return (this->exists() && ((this->chunk()[Base::InfoWord] & HasValueSet) != 0)); }
-  void clearValue() { if (this->exists()) { this->chunk()[Base::InfoWord] &= ~HasValueSet; } }
+  void clearValue() {
+    if (this->exists()) {
+      this->noteValueChange(hasValue(),false);
+      this->chunk()[Base::InfoWord] &= ~HasValueSet;
+    }
+  }
+  void setValue(WordType v) {
+    this->noteValueChange(hasValue(),true);
+    this->chunk()[ValueWord] = v;
+    this->chunk()[Base::InfoWord] |= HasValueSet;
+  }
+
+  const ValueType& value() const { return this->chunk()[ValueWord]; }
+  ValueType& value() { return this->chunk()[ValueWord]; }
+
+private:
+  static constexpr std::size_t ValueWord = 3;
+  static constexpr WordType HasValueSet = (static_cast<WordType>(0x1) << (8*sizeof(WordType) - 1));
+};
+
+/**
+ * \brief BinaryWordNode with an edge that continues into EdgeWords extra words.
+ *
+ * Sparse deep trees (IPv6 being the usual suspect) otherwise need a chain of value-less
+ * single child nodes wherever a gap is longer than the edge bits left in word 0, each one
+ * another dependent load on lookup. Here a single node spans the whole gap, at the cost of
+ * EdgeWords more words per node.
+ * \verbatim
+ * Word 0: metadata
+ *   bit 0 (MSB) - has value
+ *   next bits - edge size
+ *   remaining bits - first edge steps
+ *
+ * Word 1: left child ref
+ * Word 2: right child ref
+ * Word 3: value
+ * Words 4 - (4 + EdgeWords): rest of the edge steps
+ * \endverbatim
+*/
+template <typename WordType,std::size_t EdgeWords,template <typename,std::size_t> class WordAlloc>
+class BinaryWordLongEdgeNode
+  : public BinaryWordNodeEdgeBase<WordType,4 + EdgeWords,BinaryMultiWordEdgeRef<WordAlloc<WordType,4 + EdgeWords>,WordType,EdgeWords,4,1>,WordAlloc>
+{
+public:
+  using Base = BinaryWordNodeEdgeBase<WordType,4 + EdgeWords,BinaryMultiWordEdgeRef<WordAlloc<WordType,4 + EdgeWords>,WordType,EdgeWords,4,1>,WordAlloc>;
+  using AllocatorType = typename Base::AllocatorType;
+  using NodeImplRefType = typename Base::NodeImplRefType;
+  using ValueType = WordType;
+  static constexpr bool ValueIsCopy = false;
+
+  BinaryWordLongEdgeNode() = default;
+  virtual ~BinaryWordLongEdgeNode() = default;
+  explicit BinaryWordLongEdgeNode(const AllocatorType* a,NodeImplRefType n) : Base(a,n) {}
+  BinaryWordLongEdgeNode(const BinaryWordLongEdgeNode& other) : Base(other) {}
+  BinaryWordLongEdgeNode(BinaryWordLongEdgeNode&& other) : Base(std::move(other)) {}
+  BinaryWordLongEdgeNode& operator=(const BinaryWordLongEdgeNode& other) {
+    static_cast<Base&>(*this) = static_cast<const Base&>(other);
+    return *this;
+  }
+  BinaryWordLongEdgeNode& operator=(BinaryWordLongEdgeNode&& other) {
+    static_cast<Base&>(*this) = std::move(static_cast<const Base&>(other));
+    return *this;
+  }
+
+  bool hasValue() const { return (this->exists() && ((this->chunk()[Base::InfoWord] & HasValueSet) != 0)); }
+  void clearValue() {
+    if (this->exists()) {
+      this->noteValueChange(hasValue(),false);
+      this->chunk()[Base::InfoWord] &= ~HasValueSet;
+    }
+  }
   void setValue(WordType v) {
+    this->noteValueChange(hasValue(),true);
     this->chunk()[ValueWord] = v;
     this->chunk()[Base::InfoWord] |= HasValueSet;
   }
@@ -203,6 +299,10 @@ private:
  * Word 2: right child ref
  * Words 3 - (3 + DataWordCount): value array
  * \endverbatim
+ *
+ * Values are WordArrayView objects looking straight at the value words, so
+ * reading a multi-word value doesn't copy it. Setting accepts a view or (via
+ * the view's conversion) a std::array.
 */
 template <typename WordType,std::size_t DataWordCount,template <typename,std::size_t> class WordAlloc>
 class BinaryWordArrayNode
@@ -212,69 +312,59 @@ public:
   using Base = BinaryWordNodeBase<WordType,3 + DataWordCount,1,0,WordAlloc>;
   using AllocatorType = typename Base::AllocatorType;
   using NodeImplRefType = typename Base::NodeImplRefType;
-  // Even though the underlying array of words is technically
-  // addressable, we're going to make a copy into a C++
-  // std::array to keep things more type-safe. This does
-  // mean extra copying. If this becomes an issue we could
-  // put together a class that provides an STL-type interface
-  // on top of a WordType pointer.
-  using ValueType = std::array<WordType,DataWordCount>;
-  static constexpr bool ValueIsCopy = true;
+  using ValueType = WordArrayView<WordType,DataWordCount>;
+  static constexpr bool ValueIsCopy = false;
 
   BinaryWordArrayNode() = default;
   virtual ~BinaryWordArrayNode() = default;
-  explicit BinaryWordArrayNode(const AllocatorType* a,NodeImplRefType n) : Base(a,n) {}
-  BinaryWordArrayNode(const BinaryWordArrayNode& other) : Base(other) {}
-  BinaryWordArrayNode(BinaryWordArrayNode&& other) : Base(std::move(other)) {}
+  explicit BinaryWordArrayNode(const AllocatorType* a,NodeImplRefType n) : Base(a,n), view_(valueWords()) {}
+  BinaryWordArrayNode(const BinaryWordArrayNode& other) : Base(other), view_(valueWords()) {}
+  BinaryWordArrayNode(BinaryWordArrayNode&& other) : Base(std::move(other)), view_(valueWords()) {}
   BinaryWordArrayNode& operator=(const BinaryWordArrayNode& other) {
     static_cast<Base&>(*this) = static_cast<const Base&>(other);
+    view_ = ValueType{valueWords()};
     return *this;
   }
   BinaryWordArrayNode& operator=(BinaryWordArrayNode&& other) {
     static_cast<Base&>(*this) = std::move(static_cast<const Base&>(other));
+    view_ = ValueType{valueWords()};
     return *this;
   }
 
   bool hasValue() const { return (this->exists() && ((this->chunk()[Base::InfoWord] & HasValueSet) != 0)); }
-  void clearValue() { if (this->exists()) { this->chunk()[Base::InfoWord] &= ~HasValueSet; } }
+  void clearValue() {
+    if (this->exists()) {
+      this->noteValueChange(hasValue(),false);
+      this->chunk()[Base::InfoWord] &= ~HasValueSet;
+    }
+  }
   void setValue(const ValueType& v) {
-    for (std::size_t i = 0; i < DataWordCount; ++i) { this->chunk()[ValueWord + i] = v[i]; }
-    value_ = v;
+    this->noteValueChange(hasValue(),true);
+    // v may be a view of these very words, which a word by word copy handles
+    WordType* words = this->chunk() + ValueWord;
+    for (std::size_t i = 0; i < DataWordCount; ++i) { words[i] = v[i]; }
+    view_ = ValueType{valueWords()};
     this->chunk()[Base::InfoWord] |= HasValueSet;
   }
 
-  ValueType valueCopy() const {
-    // Could use compile-time sequence to generate an array initializer, but
-    // this is simple and does the job.
-    ValueType newValue;
-    for (std::size_t i = 0; i < DataWordCount; ++i) { newValue[i] = this->chunk()[ValueWord + i]; }
-    return newValue;
-  }
+  std::array<WordType,DataWordCount> valueCopy() const { return view_.toArray(); }
 
-  // When getting values we *always* copy - this is a bit wasteful, but
-  // guarantees consistency.
-  const ValueType& value() const {
-    value_ = valueCopy();
-    return value_;
-  }
-  ValueType& value() {
-    value_ = valueCopy();
-    return value_;
-  }
+  // The view is bound to the node's words when the node is, so reading
+  // a value neither copies nor writes anything.
+  const ValueType& value() const { return view_; }
+  ValueType& value() { return view_; }
 
 private:
   static constexpr std::size_t ValueWord = 3;
   static constexpr WordType HasValueSet = (static_cast<WordType>(0x1) << (8*sizeof(WordType) - 1));
+  const WordType* valueWords() const { return (this->exists() ? (this->chunk() + ValueWord) : nullptr); }
   /**
-   * \brief The value is technically addressable, but we store a copy anyhow.
+   * \brief View of the value words in the allocator chunk.
    *
-   * It'd be nice to avoid the copy here, but the interactions between C arrays
-   * and C++ types gets awkward. One alternative would be to implement a wrapper
-   * class that does the equivalent of std::array - provides an STL-compatible
-   * interface - based on an underlying pointer.
-   * Needs to be mutable so we can update a const object with an RO pointer.
+   * Like any pointer into the allocator, it goes stale if the allocator moves its
+   * storage; node copies rebind it.
    */
-  mutable ValueType value_{};
+  ValueType view_{};
 };
 
 
@@ -328,12 +418,16 @@ public:
   }
 
   bool hasValue() const { return ((this->chunk()[Base::InfoWord] & HasValueSet) != 0); }
-  void clearValue() { this->chunk()[Base::InfoWord] &= ~HasValueSet; }
+  void clearValue() {
+    this->noteValueChange(hasValue(),false);
+    this->chunk()[Base::InfoWord] &= ~HasValueSet;
+  }
   DataWordType valueCopy() const { return static_cast<DataWordType>(this->chunk()[Base::InfoWord] & DataWordBitMask); }
   void setValue(DataWordType v) {
+    this->noteValueChange(hasValue(),true);
     WordType newiw = this->chunk()[Base::InfoWord];
     newiw |= HasValueSet;
-    newiw |= ((newiw & ~DataWordBitMask) | static_cast<WordType>(v));
+    newiw = ((newiw & ~DataWordBitMask) | static_cast<WordType>(v));
     this->chunk()[Base::InfoWord] = newiw;
     value_ = valueCopy();
   }
@@ -390,12 +484,18 @@ public:
   }
 
   bool hasValue() const { return (this->exists() && ((this->chunk()[Base::InfoWord] & HasValueSet) != 0)); }
-  void clearValue() { if (this->exists()) { this->chunk()[Base::InfoWord] &= ~HasValueSet; } }
+  void clearValue() {
+    if (this->exists()) {
+      this->noteValueChange(hasValue(),false);
+      this->chunk()[Base::InfoWord] &= ~HasValueSet;
+    }
+  }
   bool valueCopy() const { return ((this->chunk()[Base::InfoWord] & DataWordBitMask) != 0); }
   void setValue(bool v) {
+    this->noteValueChange(hasValue(),true);
     WordType newiw = this->chunk()[Base::InfoWord];
     newiw |= HasValueSet;
-    newiw |= ((newiw & ~DataWordBitMask) | (v ? DataWordBitMask : 0));
+    newiw = ((newiw & ~DataWordBitMask) | (v ? DataWordBitMask : 0));
     this->chunk()[Base::InfoWord] = newiw;
     value_ = valueCopy();
   }
@@ -450,10 +550,16 @@ public:
   }
 
   bool hasValue() const { return (this->exists() && ((this->chunk()[Base::InfoWord] & HasValueSet) != 0)); }
-  void clearValue() { if (this->exists()) { this->chunk()[Base::InfoWord] &= ~HasValueSet; } }
+  void clearValue() {
+    if (this->exists()) {
+      this->noteValueChange(hasValue(),false);
+      this->chunk()[Base::InfoWord] &= ~HasValueSet;
+    }
+  }
   bool valueCopy() const { return hasValue(); }
   void setValue(bool v) {
     if (this->exists()) {
+      this->noteValueChange(hasValue(),v);
       if (v) { this->chunk()[Base::InfoWord] |= HasValueSet; } 
       else { this->chunk()[Base::InfoWord] &= ~HasValueSet; }
     }
@@ -474,6 +580,261 @@ private:
   mutable bool value_{false};
 };
 
+/**
+ * \brief Three word binary node whose value lives in the allocator's parallel value array.
+ *
+ * \verbatim
+ * Word 0: metadata
+ *   bit 0 (MSB) - has value
+ *   bits 1 - N: edge size/bits, 0 means no edge
+ *
+ * Word 1: left child ref
+ * Word 2: right child ref
+ * \endverbatim
+ *
+ * BinaryWordNode keeps the value in word 3, so every node passed on the way down brings
+ * its value into cache too. Here the value sits at the same ref in a separate array
+ * (WordBlockSplitValueAllocator), so the walk only reads topology and the value is read
+ * once at the end. The value can be any default constructible type rather than a word.
+ */
+template <typename WordType,typename ValueT>
+class BinaryWordSplitValueNode
+  : public BinaryWordNodeBase<WordType,3,1,0,WordBlockSplitValue<ValueT>::template Allocator>
+{
+public:
+  using Base = BinaryWordNodeBase<WordType,3,1,0,WordBlockSplitValue<ValueT>::template Allocator>;
+  using AllocatorType = typename Base::AllocatorType;
+  using NodeImplRefType = typename Base::NodeImplRefType;
+  using ValueType = ValueT;
+  static constexpr bool ValueIsCopy = false;
+
+  BinaryWordSplitValueNode() = default;
+  virtual ~BinaryWordSplitValueNode() = default;
+  explicit BinaryWordSplitValueNode(const AllocatorType* a,NodeImplRefType n) : Base(a,n) {}
+  BinaryWordSplitValueNode(const BinaryWordSplitValueNode& other) : Base(other) {}
+  BinaryWordSplitValueNode(BinaryWordSplitValueNode&& other) : Base(std::move(other)) {}
+  BinaryWordSplitValueNode& operator=(const BinaryWordSplitValueNode& other) {
+    static_cast<Base&>(*this) = static_cast<const Base&>(other);
+    return *this;
+  }
+  BinaryWordSplitValueNode& operator=(BinaryWordSplitValueNode&& other) {
+    static_cast<Base&>(*this) = std::move(static_cast<const Base&>(other));
+    return *this;
+  }
+
+  bool hasValue() const { return (this->exists() && ((this->chunk()[Base::InfoWord] & HasValueSet) != 0)); }
+  void clearValue() {
+    if (this->exists()) {
+      this->noteValueChange(hasValue(),false);
+      this->chunk()[Base::InfoWord] &= ~HasValueSet;
+    }
+  }
+  void setValue(const ValueType& v) {
+    this->noteValueChange(hasValue(),true);
+    *valuePtr() = v;
+    this->chunk()[Base::InfoWord] |= HasValueSet;
+  }
+  void setValue(ValueType&& v) {
+    this->noteValueChange(hasValue(),true);
+    *valuePtr() = std::move(v);
+    this->chunk()[Base::InfoWord] |= HasValueSet;
+  }
+
+  const ValueType& value() const { return *valuePtr(); }
+  ValueType& value() { return *valuePtr(); }
+
+private:
+  static constexpr WordType HasValueSet = (static_cast<WordType>(0x1) << (8*sizeof(WordType) - 1));
+  ValueType* valuePtr() const { return this->allocator()->valuePtr(this->nodeRef()); }
+};
+
+/**
+ * \brief Two word binary node, the left child is always the chunk right after its parent.
+ *
+ * \verbatim
+ * Word 0: metadata and data
+ *   bits 0 - 1 (MSB) - left child: none, next chunk, spilled
+ *   middle bits - edge size/bits
+ *   next bit - has value
+ *   low bits - value
+ * Word 1: right child ref
+ * \endverbatim
+ *
+ * Meant for trees that are bulk loaded and then mostly read. compact() lays the nodes out
+ * in pre-order, which puts every left child in the chunk after its parent, so the left ref
+ * isn't stored at all and a left descent reads the next chunk. Half the size of a
+ * BinaryWordNode (the value is packed into word 0 like CompactBinaryWordNode).
+ *
+ * Inserts still go through the regular cursors: a new left child that doesn't happen to
+ * land next to its parent has its ref "spilled" into a side table in the allocator (see
+ * WordBlockImplicitLeftAllocator). The next compact() relocates those subtrees and
+ * empties the table.
+ */
+template <typename DataWordType,typename WordType,template <typename,std::size_t> class WordAlloc = WordBlockImplicitLeftAllocator>
+class ImplicitLeftBinaryWordNode
+  : public BinaryWordNodeBase<WordType,2,2,8*sizeof(DataWordType) + 1,WordAlloc>
+{
+public:
+  using Base = BinaryWordNodeBase<WordType,2,2,8*sizeof(DataWordType) + 1,WordAlloc>;
+  using AllocatorType = typename Base::AllocatorType;
+  using NodeImplRefType = typename Base::NodeImplRefType;
+  using ValueType = DataWordType;
+  static constexpr bool ValueIsCopy = true;
+  static constexpr std::size_t RightChildWord = 1;
+  static constexpr NodeImplRefType nullRef = Base::nullRef;
+
+  static_assert(std::is_integral<DataWordType>::value,"data word must be an integer");
+  static_assert(sizeof(DataWordType) <= (sizeof(WordType)/2),"data word size too large");
+
+  ImplicitLeftBinaryWordNode() = default;
+  virtual ~ImplicitLeftBinaryWordNode() = default;
+  explicit ImplicitLeftBinaryWordNode(const AllocatorType* a,NodeImplRefType n) : Base(a,n) {}
+  ImplicitLeftBinaryWordNode(const ImplicitLeftBinaryWordNode& other) : Base(other), value_(other.value_) {}
+  ImplicitLeftBinaryWordNode(ImplicitLeftBinaryWordNode&& other) : Base(std::move(other)), value_(std::move(other.value_)) {}
+  ImplicitLeftBinaryWordNode& operator=(const ImplicitLeftBinaryWordNode& other) {
+    if (this == &other) { return *this; }
+    static_cast<Base&>(*this) = static_cast<const Base&>(other);
+    value_ = other.value_;
+    return *this;
+  }
+  ImplicitLeftBinaryWordNode& operator=(ImplicitLeftBinaryWordNode&& other) {
+    if (this == &other) { return *this; }
+    static_cast<Base&>(*this) = std::move(static_cast<const Base&>(other));
+    value_ = std::move(other.value_);
+    return *this;
+  }
+
+  bool hasChild(unsigned c) const { return (getChild(c) != nullRef); }
+  inline WordType getChild(unsigned c) const;
+  WordType detachChild(unsigned c) { return setChild(c,nullRef); }
+  inline WordType setChild(unsigned c,WordType childRef);
+  bool isLeaf() const { return !(hasChild(0) || hasChild(1)); }
+
+  /**
+   * \brief True if the left child is in the next chunk rather than spilled.
+   */
+  bool leftChildIsNext() const { return (leftMode() == LeftNext); }
+
+  /**
+   * \brief Relayout every node under root in pre-order, all left children end up next to their parents.
+   */
+  static inline NodeImplRefType compact(AllocatorType& a,NodeImplRefType root);
+
+  bool hasValue() const { return (this->exists() && ((this->chunk()[Base::InfoWord] & HasValueSet) != 0)); }
+  void clearValue() {
+    if (this->exists()) {
+      this->noteValueChange(hasValue(),false);
+      this->chunk()[Base::InfoWord] &= ~HasValueSet;
+    }
+  }
+  DataWordType valueCopy() const { return static_cast<DataWordType>(this->chunk()[Base::InfoWord] & DataWordBitMask); }
+  void setValue(DataWordType v) {
+    this->noteValueChange(hasValue(),true);
+    WordType newiw = this->chunk()[Base::InfoWord];
+    newiw = ((newiw & ~DataWordBitMask) | HasValueSet | static_cast<WordType>(v));
+    this->chunk()[Base::InfoWord] = newiw;
+    value_ = valueCopy();
+  }
+  const ValueType& value() const {
+    value_ = valueCopy();
+    return value_;
+  }
+  ValueType& value() {
+    value_ = valueCopy();
+    return value_;
+  }
+
+private:
+  static constexpr std::size_t DataBits = 8*sizeof(DataWordType);
+  static constexpr WordType HasValueSet = (static_cast<WordType>(0x1) << DataBits);
+  static constexpr WordType DataWordBitMask = ((static_cast<WordType>(0x1) << DataBits) - 1);
+  static constexpr std::size_t LeftModeShift = (8*sizeof(WordType) - 2);
+  static constexpr WordType LeftModeMask = (static_cast<WordType>(0x3) << LeftModeShift);
+  static constexpr WordType LeftNone = 0x0;
+  static constexpr WordType LeftNext = 0x1;
+  static constexpr WordType LeftSpilled = 0x2;
+
+  WordType leftMode() const { return ((this->chunk()[Base::InfoWord] & LeftModeMask) >> LeftModeShift); }
+  void setLeftMode(WordType m) {
+    WordType& iw = this->chunk()[Base::InfoWord];
+    iw = ((iw & ~LeftModeMask) | (m << LeftModeShift));
+  }
+  /**
+   * \brief Since the value isn't directly addressable we store a copy here.
+   * Needs to be mutable so we can update a const object with an RO pointer.
+   */
+  mutable ValueType value_{};
+};
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename DataWordType,typename WordType,template <typename,std::size_t> class WordAlloc>
+WordType ImplicitLeftBinaryWordNode<DataWordType,WordType,WordAlloc>::getChild(unsigned c) const {
+  if (c == 0) {
+    switch (leftMode()) {
+    case LeftNext: return (this->nodeRef() + 1);
+    case LeftSpilled: return this->allocator()->spilledLeftChild(this->nodeRef());
+    default: return nullRef;
+    }
+  }
+  if (c == 1) { return this->chunk()[RightChildWord]; }
+  throw std::range_error("getChild() - child out of bounds");
+}
+
+template <typename DataWordType,typename WordType,template <typename,std::size_t> class WordAlloc>
+WordType ImplicitLeftBinaryWordNode<DataWordType,WordType,WordAlloc>::setChild(unsigned c,WordType childRef) {
+  WordType prevChild = getChild(c);
+  if (c == 0) {
+    if (leftMode() == LeftSpilled) { this->allocator()->setSpilledLeftChild(this->nodeRef(),nullRef); }
+    if (childRef == nullRef) {
+      setLeftMode(LeftNone);
+    } else if (childRef == (this->nodeRef() + 1)) {
+      setLeftMode(LeftNext);
+    } else {
+      this->allocator()->setSpilledLeftChild(this->nodeRef(),childRef);
+      setLeftMode(LeftSpilled);
+    }
+  } else if (c == 1) {
+    this->chunk()[RightChildWord] = childRef;
+  } else {
+    throw std::range_error("setChild() - child out of bounds");
+  }
+  return prevChild;
+}
+
+template <typename DataWordType,typename WordType,template <typename,std::size_t> class WordAlloc>
+typename ImplicitLeftBinaryWordNode<DataWordType,WordType,WordAlloc>::NodeImplRefType
+ImplicitLeftBinaryWordNode<DataWordType,WordType,WordAlloc>::compact(AllocatorType& a,NodeImplRefType root) {
+  struct PendingNode {
+    NodeImplRefType fromRef;
+    NodeImplRefType toParentRef;
+    unsigned child;
+  };
+  return a.relayout([&a,root](AllocatorType& to) {
+    if (root == nullRef) { return nullRef; }
+    NodeImplRefType newRoot = nullRef;
+    std::vector<PendingNode> pending{{root,nullRef,0}};
+    while (!pending.empty()) {
+      PendingNode cur = pending.back();
+      pending.pop_back();
+      // Fresh allocator, refs come out in sequence: a left child popped right
+      // after its parent lands in the next chunk.
+      NodeImplRefType toRef = to.newRef();
+      ImplicitLeftBinaryWordNode from{&a,cur.fromRef};
+      to.getPtr(toRef)[Base::InfoWord] = (a.getPtr(cur.fromRef)[Base::InfoWord] & ~LeftModeMask);
+      if (cur.toParentRef == nullRef) { newRoot = toRef; }
+      else { ImplicitLeftBinaryWordNode{&to,cur.toParentRef}.setChild(cur.child,toRef); }
+      for (unsigned c = 2; c > 0; --c) {
+        NodeImplRefType childRef = from.getChild(c - 1);
+        if (childRef != nullRef) { pending.push_back({childRef,toRef,c - 1}); }
+      }
+    }
+    return newRoot;
+  });
+}
+
 }
 }
 }
@@ -0,0 +1,137 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_CHILD_KEY_SEARCH_H_
+#define AKAMAI_MAPPER_RADIX_TREE_CHILD_KEY_SEARCH_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \file ChildKeySearch.h
+ * Kernels for searching the small sorted byte key arrays of sparse nodes.
+ *
+ * The 16 key search is a single SSE2 compare and movemask where SSE2 is available
+ * (always the case on x86-64, so it is selected at compile time), the 4 key search
+ * compares all keys at once inside a 32 bit word. Everything falls back to the
+ * scalar loops elsewhere.
+ */
+namespace ChildKeySearch {
+
+/**
+ * \brief Index of key k in keys[0..count), count if not present.
+ */
+inline std::size_t findKeyScalar(const uint8_t* keys,std::size_t count,uint8_t k);
+
+/**
+ * \brief Number of keys in sorted keys[0..count) that are less than k, i.e. the insert position for k.
+ */
+inline std::size_t lowerBoundScalar(const uint8_t* keys,std::size_t count,uint8_t k);
+
+/**
+ * \brief findKeyScalar() for arrays of 4 keys, count <= 4 and all 4 bytes readable.
+ */
+inline std::size_t findKey4(const uint8_t* keys,std::size_t count,uint8_t k);
+
+/**
+ * \brief findKeyScalar() for arrays of 16 keys, count <= 16 and all 16 bytes readable.
+ */
+inline std::size_t findKey16(const uint8_t* keys,std::size_t count,uint8_t k);
+
+/**
+ * \brief lowerBoundScalar() for arrays of 16 keys, count <= 16 and all 16 bytes readable.
+ */
+inline std::size_t lowerBound16(const uint8_t* keys,std::size_t count,uint8_t k);
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+std::size_t findKeyScalar(const uint8_t* keys,std::size_t count,uint8_t k) {
+  for (std::size_t i = 0; i < count; ++i) {
+    if (keys[i] == k) { return i; }
+  }
+  return count;
+}
+
+std::size_t lowerBoundScalar(const uint8_t* keys,std::size_t count,uint8_t k) {
+  std::size_t i = 0;
+  while ((i < count) && (keys[i] < k)) { ++i; }
+  return i;
+}
+
+std::size_t findKey4(const uint8_t* keys,std::size_t count,uint8_t k) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  uint32_t word;
+  std::memcpy(&word,keys,sizeof(word));
+  // Bytes equal to k become zero; the lowest byte flagged by the zero byte
+  // test is always a real match (false flags only appear above a real zero).
+  const uint32_t x = word ^ (0x01010101u * k);
+  const uint32_t zeros = (x - 0x01010101u) & ~x & 0x80808080u;
+  if (zeros == 0) { return count; }
+  const std::size_t i = (__builtin_ctz(zeros) / 8);
+  return ((i < count) ? i : count);
+#else
+  return findKeyScalar(keys,count,k);
+#endif
+}
+
+std::size_t findKey16(const uint8_t* keys,std::size_t count,uint8_t k) {
+#if defined(__SSE2__)
+  const __m128i all = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+  const __m128i eq = _mm_cmpeq_epi8(all,_mm_set1_epi8(static_cast<char>(k)));
+  const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq)) & ((0x1u << count) - 1);
+  return ((mask != 0) ? static_cast<std::size_t>(__builtin_ctz(mask)) : count);
+#else
+  return findKeyScalar(keys,count,k);
+#endif
+}
+
+std::size_t lowerBound16(const uint8_t* keys,std::size_t count,uint8_t k) {
+#if defined(__SSE2__)
+  // SSE2 only has signed byte compares, flip the top bit to compare unsigned.
+  const __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+  const __m128i all = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys)),flip);
+  const __m128i key = _mm_xor_si128(_mm_set1_epi8(static_cast<char>(k)),flip);
+  const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmplt_epi8(all,key))) & ((0x1u << count) - 1);
+  return static_cast<std::size_t>(__builtin_popcount(mask));
+#else
+  return lowerBoundScalar(keys,count,k);
+#endif
+}
+
+} // namespace ChildKeySearch
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -0,0 +1,301 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_INLINE_LEAF_NODE_H_
+#define AKAMAI_MAPPER_RADIX_TREE_INLINE_LEAF_NODE_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \file InlineLeafNode.h
+ * Node interface for simple binary node implementations that packs small leaves
+ * directly into their parent's child slot.
+ */
+
+/**
+ * \brief NodeInterface variant whose leaves may live inline in the parent's child pointer.
+ *
+ * A child slot either holds a regular node pointer (always at least 4 byte aligned) or,
+ * with the low bit set, a packed leaf:
+ * \verbatim
+ * bit 0       - 1, inline leaf tag
+ * bit 1       - has value
+ * bits 2-5    - edge size (0 - InlineEdgeSteps)
+ * bits 6-13   - edge steps
+ * bits 16-63  - value
+ * \endverbatim
+ *
+ * getChild() hands out an inline leaf as the address of its slot, tagged with bit 1.
+ * Node wrappers built from such a ref read (and write) the slot, so cursors see an ordinary
+ * leaf, and reading it doesn't touch any memory beyond the parent. When a write no longer
+ * fits (a child is added, the value grows, the leaf is detached) the leaf is turned back
+ * into a regular node in place; the slot ref then keeps working, resolving to that node.
+ *
+ * Leaves are packed by compact(), i.e. RadixTree::compact(). Inline leaf values are
+ * decoded copies, hence ValueIsCopy.
+ */
+template <typename AllocT,typename NodeImplT>
+class InlineLeafNodeInterface
+{
+public:
+  using NodeImplType = NodeImplT;
+  using Edge = typename NodeImplType::EdgeType;
+  using ValueType = typename NodeImplType::ValueType;
+  using NodeImplRefType = typename NodeImplType::NodeImplRefType;
+  using AllocatorType = AllocT;
+  static constexpr std::size_t Radix = NodeImplType::Radix;
+  static constexpr bool ValueIsCopy = true;
+  static constexpr std::size_t NoChild = std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t InlineEdgeSteps = 8;
+  static constexpr std::size_t InlineValueBits = 48;
+
+  static_assert(Radix == 2,"InlineLeafNodeInterface: binary nodes only");
+  static_assert(std::is_same<NodeImplRefType,void*>::value && (sizeof(void*) == sizeof(uint64_t)),
+                "InlineLeafNodeInterface: node refs must be 64 bit pointers");
+  static_assert(std::is_integral<ValueType>::value,"InlineLeafNodeInterface: integer values only");
+
+  InlineLeafNodeInterface() = default;
+  explicit InlineLeafNodeInterface(const AllocatorType* a,NodeImplRefType n) : alloc_(a), nodeImplRef_(n) {}
+
+  bool exists() const { return ((alloc_ != nullptr) && (nodeImplRef_ != AllocatorType::nullRef) && (slotWord() != 0)); }
+
+  const Edge& edge() const {
+    if (isInline()) { return (edge_ = unpackEdge(slotWord())); }
+    return nodeImplPtr()->edge();
+  }
+  Edge& edge() {
+    if (isInline()) { return (edge_ = unpackEdge(slotWord())); }
+    return nodeImplPtr()->edge();
+  }
+
+  bool hasValue() const {
+    if (!exists()) { return false; }
+    if (isInline()) { return ((slotWord() & HasValueBit) != 0); }
+    return nodeImplPtr()->hasValue();
+  }
+
+  const ValueType& value() const {
+    if (isInline()) { return (value_ = unpackValue(slotWord())); }
+    return nodeImplPtr()->value();
+  }
+  ValueType& value() {
+    if (isInline()) { return (value_ = unpackValue(slotWord())); }
+    return nodeImplPtr()->value();
+  }
+
+  inline void setValue(const ValueType& v);
+  inline void clearValue();
+
+  NodeImplRefType nodeImplRef() const { return nodeImplRef_; }
+
+  inline NodeImplRefType getChild(std::size_t c) const;
+  inline NodeImplRefType setChild(std::size_t c,NodeImplRefType newChild);
+  inline NodeImplRefType detachChild(std::size_t c);
+  bool hasChild(std::size_t c) const { return (!isInline() && nodeImplPtr()->hasChild(c)); }
+  bool isLeaf() const { return (isInline() || nodeImplPtr()->isLeaf()); }
+
+  /**
+   * \brief Pack every leaf under root that fits into its parent's child slot.
+   * Invalidates existing cursors, see RadixTree::compact().
+   */
+  static inline NodeImplRefType compact(AllocatorType& a,NodeImplRefType root);
+
+private:
+  static constexpr uintptr_t InlineBit = 0x1;
+  static constexpr uintptr_t SlotRefBit = 0x2;
+  static constexpr uintptr_t HasValueBit = 0x2;
+  static constexpr std::size_t EdgeSizeShift = 2;
+  static constexpr std::size_t EdgeShift = 6;
+  static constexpr std::size_t ValueShift = 16;
+
+  static bool isSlotRef(NodeImplRefType r) { return ((reinterpret_cast<uintptr_t>(r) & SlotRefBit) != 0); }
+  static NodeImplRefType* slotOf(NodeImplRefType r) { return reinterpret_cast<NodeImplRefType*>(reinterpret_cast<uintptr_t>(r) & ~SlotRefBit); }
+  static bool isPacked(uintptr_t w) { return ((w & InlineBit) != 0); }
+
+  // The word our ref currently resolves to - a node pointer or a packed leaf
+  uintptr_t slotWord() const {
+    return reinterpret_cast<uintptr_t>(isSlotRef(nodeImplRef_) ? *slotOf(nodeImplRef_) : nodeImplRef_);
+  }
+  bool isInline() const { return isSlotRef(nodeImplRef_) && isPacked(slotWord()); }
+  NodeImplType* nodeImplPtr() const { return alloc_->getPtr(reinterpret_cast<NodeImplRefType>(slotWord())); }
+
+  static inline bool fits(const NodeImplType& n);
+  static inline uintptr_t pack(const Edge& e,bool hasValue,ValueType v);
+  static inline Edge unpackEdge(uintptr_t w);
+  static ValueType unpackValue(uintptr_t w) { return static_cast<ValueType>(w >> ValueShift); }
+  static bool valueFits(const ValueType& v) {
+    const uint64_t u = static_cast<uint64_t>(v);
+    return (((u >> InlineValueBits) == 0) && (static_cast<ValueType>(u) == v));
+  }
+
+  /**
+   * \brief Turn the packed leaf in slot into a regular node, returns the new node.
+   */
+  static inline NodeImplRefType unpackSlot(const AllocatorType* a,NodeImplRefType* slot);
+  static inline void packChildren(AllocatorType& a,NodeImplRefType n);
+
+  const AllocatorType* alloc_{nullptr};
+  NodeImplRefType nodeImplRef_{AllocatorType::nullRef};
+  mutable Edge edge_{};
+  mutable ValueType value_{};
+};
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename AllocT,typename NodeImplT>
+void InlineLeafNodeInterface<AllocT,NodeImplT>::setValue(const ValueType& v) {
+  if (isInline()) {
+    const uintptr_t w = slotWord();
+    if (valueFits(v)) {
+      if ((w & HasValueBit) == 0) { alloc_->noteValueSet(); }
+      *slotOf(nodeImplRef_) = reinterpret_cast<NodeImplRefType>(pack(unpackEdge(w),true,v));
+      return;
+    }
+    unpackSlot(alloc_,slotOf(nodeImplRef_));
+  }
+  if (!nodeImplPtr()->hasValue()) { alloc_->noteValueSet(); }
+  nodeImplPtr()->setValue(v);
+}
+
+template <typename AllocT,typename NodeImplT>
+void InlineLeafNodeInterface<AllocT,NodeImplT>::clearValue() {
+  if (isInline()) {
+    const uintptr_t w = slotWord();
+    if ((w & HasValueBit) != 0) { alloc_->noteValueCleared(); }
+    *slotOf(nodeImplRef_) = reinterpret_cast<NodeImplRefType>(pack(unpackEdge(w),false,ValueType{}));
+    return;
+  }
+  if (nodeImplPtr()->hasValue()) { alloc_->noteValueCleared(); }
+  nodeImplPtr()->clearValue();
+}
+
+template <typename AllocT,typename NodeImplT>
+typename InlineLeafNodeInterface<AllocT,NodeImplT>::NodeImplRefType
+InlineLeafNodeInterface<AllocT,NodeImplT>::getChild(std::size_t c) const {
+  if (isInline()) { return AllocatorType::nullRef; }
+  NodeImplRefType* slot = nodeImplPtr()->childSlot(c);
+  if (isPacked(reinterpret_cast<uintptr_t>(*slot))) {
+    return reinterpret_cast<NodeImplRefType>(reinterpret_cast<uintptr_t>(slot) | SlotRefBit);
+  }
+  return *slot;
+}
+
+template <typename AllocT,typename NodeImplT>
+typename InlineLeafNodeInterface<AllocT,NodeImplT>::NodeImplRefType
+InlineLeafNodeInterface<AllocT,NodeImplT>::setChild(std::size_t c,NodeImplRefType newChild) {
+  if (isInline()) { unpackSlot(alloc_,slotOf(nodeImplRef_)); }
+  // Only ever link regular nodes, a slot ref would point at some other parent's slot
+  if (isSlotRef(newChild)) {
+    NodeImplRefType* from = slotOf(newChild);
+    newChild = (isPacked(reinterpret_cast<uintptr_t>(*from)) ? unpackSlot(alloc_,from) : *from);
+  }
+  NodeImplRefType* slot = nodeImplPtr()->childSlot(c);
+  NodeImplRefType prevChild = (isPacked(reinterpret_cast<uintptr_t>(*slot)) ? unpackSlot(alloc_,slot) : *slot);
+  *slot = newChild;
+  return prevChild;
+}
+
+template <typename AllocT,typename NodeImplT>
+typename InlineLeafNodeInterface<AllocT,NodeImplT>::NodeImplRefType
+InlineLeafNodeInterface<AllocT,NodeImplT>::detachChild(std::size_t c) {
+  if (isInline()) { return AllocatorType::nullRef; }
+  return setChild(c,AllocatorType::nullRef);
+}
+
+template <typename AllocT,typename NodeImplT>
+bool InlineLeafNodeInterface<AllocT,NodeImplT>::fits(const NodeImplType& n) {
+  if (!n.isLeaf() || (n.edge().size() > InlineEdgeSteps)) { return false; }
+  return (!n.hasValue() || valueFits(n.value()));
+}
+
+template <typename AllocT,typename NodeImplT>
+uintptr_t InlineLeafNodeInterface<AllocT,NodeImplT>::pack(const Edge& e,bool hasValue,ValueType v) {
+  uintptr_t w = InlineBit;
+  if (hasValue) { w |= (HasValueBit | (static_cast<uintptr_t>(v) << ValueShift)); }
+  w |= (static_cast<uintptr_t>(e.size()) << EdgeSizeShift);
+  for (std::size_t i = 0; i < e.size(); ++i) {
+    w |= (static_cast<uintptr_t>(e[i]) << (EdgeShift + i));
+  }
+  return w;
+}
+
+template <typename AllocT,typename NodeImplT>
+typename InlineLeafNodeInterface<AllocT,NodeImplT>::Edge
+InlineLeafNodeInterface<AllocT,NodeImplT>::unpackEdge(uintptr_t w) {
+  Edge e{};
+  const std::size_t size = ((w >> EdgeSizeShift) & 0xf);
+  for (std::size_t i = 0; i < size; ++i) { e.push_back((w >> (EdgeShift + i)) & 0x1); }
+  return e;
+}
+
+template <typename AllocT,typename NodeImplT>
+typename InlineLeafNodeInterface<AllocT,NodeImplT>::NodeImplRefType
+InlineLeafNodeInterface<AllocT,NodeImplT>::unpackSlot(const AllocatorType* a,NodeImplRefType* slot) {
+  const uintptr_t w = reinterpret_cast<uintptr_t>(*slot);
+  // Nodes only hold a const allocator, same as the value counts we're moving here
+  AllocatorType* alloc = const_cast<AllocatorType*>(a);
+  NodeImplRefType n = alloc->newRef();
+  NodeImplType* impl = alloc->getPtr(n);
+  impl->edge() = unpackEdge(w);
+  if ((w & HasValueBit) != 0) { impl->setValue(unpackValue(w)); }
+  *slot = n;
+  return n;
+}
+
+template <typename AllocT,typename NodeImplT>
+void InlineLeafNodeInterface<AllocT,NodeImplT>::packChildren(AllocatorType& a,NodeImplRefType n) {
+  NodeImplType* impl = a.getPtr(n);
+  for (std::size_t c = 0; c < Radix; ++c) {
+    NodeImplRefType* slot = impl->childSlot(c);
+    if ((*slot == AllocatorType::nullRef) || isPacked(reinterpret_cast<uintptr_t>(*slot))) { continue; }
+    const NodeImplType& child = *a.getPtr(*slot);
+    if (fits(child)) {
+      NodeImplRefType childRef = *slot;
+      *slot = reinterpret_cast<NodeImplRefType>(pack(child.edge(),child.hasValue(),(child.hasValue() ? child.value() : ValueType{})));
+      a.deleteRef(childRef);
+    } else {
+      packChildren(a,*slot);
+    }
+  }
+}
+
+template <typename AllocT,typename NodeImplT>
+typename InlineLeafNodeInterface<AllocT,NodeImplT>::NodeImplRefType
+InlineLeafNodeInterface<AllocT,NodeImplT>::compact(AllocatorType& a,NodeImplRefType root) {
+  if (root != AllocatorType::nullRef) { packChildren(a,root); }
+  return root;
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -331,15 +331,18 @@ LookupCursorWO<R,MD,AllocatorT,NodeT,PathT>::addNode() {
   NodeImplRef newNodeRef = alloc_->newRef();
   Node newNode{alloc_,newNodeRef};
   newNode.edge() = edgeFromAbove_;
-  nodeAbove.setChild(childFromAbove_,newNodeRef);
+  // Use the ref handed back rather than nodeRefBelow_, node types that
+  // don't store refs directly (InlineLeafNodeInterface) may hand back a
+  // different ref for the same node.
+  NodeImplRef prevRef = nodeAbove.setChild(childFromAbove_,newNodeRef);
   // If we're on a path down to a node beneath us then
   // we need to split the edge to create the new node.
   if (nodeRefBelow_ != Allocator::nullRef) {
-    Node nodeBelow{alloc_,nodeRefBelow_};
+    Node nodeBelow{alloc_,prevRef};
     // Absorb the first step of the edge below into the child of
     // the node we're about to create, trim the child's edge
     // to account for how far down the edge we are.
-    newNode.setChild(edgeToBelow_.at(0),nodeRefBelow_);
+    newNode.setChild(edgeToBelow_.at(0),prevRef);
     nodeBelow.edge().trim_front(depthBelow_);
   }
   nodeRefAtAbove_ = newNodeRef;
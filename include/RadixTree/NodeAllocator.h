@@ -23,10 +23,14 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <stdint.h>
 #include <stdexcept>
 #include <vector>
 #include <cstring>
 #include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
 
 /**
  * \file Custom allocator types for radix tree nodes.
@@ -50,21 +54,82 @@ namespace RadixTree {
 template <template <typename> class Alloc>
 struct AllocatorTraits {};
 
+/**
+ * \brief Memory usage snapshot for a tree, as reported by its allocator.
+ *
+ * All counts are maintained incrementally by the allocator, so taking a snapshot
+ * is cheap enough to do routinely for monitoring.
+ */
+struct MemoryStats {
+  std::size_t nodeCount{0};          ///< Live nodes, including the root
+  std::size_t valueNodeCount{0};     ///< Live nodes holding a value
+  std::size_t scaffoldNodeCount{0};  ///< Live nodes without a value (branching/structure only)
+  std::size_t freeNodeCount{0};      ///< Freed node slots held for reuse
+  std::size_t nodeBytes{0};          ///< Bytes occupied by a single node
+  std::size_t bytesInUse{0};         ///< Bytes occupied by live nodes
+  std::size_t bytesReserved{0};      ///< Bytes held by the allocator, including free and unused space
+};
+
+/**
+ * \brief Count of nodes holding values, kept up to date by the nodes themselves.
+ *
+ * Nodes only hold a const pointer to their allocator, and the count is bookkeeping rather
+ * than allocator state, so it can be updated through a const allocator.
+ */
+class AllocatorValueCounter {
+public:
+  void noteValueSet() const { ++valueCount_; }
+  void noteValueCleared() const { --valueCount_; }
+  std::size_t valueCount() const { return valueCount_; }
+
+protected:
+  /**
+   * \brief Fill in the node based fields of a stats snapshot.
+   */
+  MemoryStats makeStats(std::size_t nodeCount,std::size_t freeNodeCount,std::size_t nodeBytes,std::size_t bytesReserved) const {
+    MemoryStats ms;
+    ms.nodeCount = nodeCount;
+    ms.valueNodeCount = valueCount_;
+    ms.scaffoldNodeCount = (nodeCount > valueCount_) ? (nodeCount - valueCount_) : 0;
+    ms.freeNodeCount = freeNodeCount;
+    ms.nodeBytes = nodeBytes;
+    ms.bytesInUse = nodeCount*nodeBytes;
+    ms.bytesReserved = bytesReserved;
+    return ms;
+  }
+
+  mutable std::size_t valueCount_{0};
+};
+
 /**
  * \brief Baseline allocator that wraps new/delete.
  */
 template <typename ObjType>
 class AllocatorNew
+  : public AllocatorValueCounter
 {
 public:
   typedef void* RefType;
   static constexpr RefType nullRef = nullptr;
 
   template <typename... Args>
-  RefType newRef(Args&&... a) { return new ObjType{std::forward<Args>(a)...}; }
-  void deleteRef(RefType ref) { delete static_cast<ObjType*>(ref); }
+  RefType newRef(Args&&... a) {
+    RefType ref = new ObjType{std::forward<Args>(a)...};
+    ++liveCount_;
+    return ref;
+  }
+  void deleteRef(RefType ref) {
+    if (ref == nullRef) { return; }
+    delete static_cast<ObjType*>(ref);
+    --liveCount_;
+  }
   static ObjType* getPtr(RefType ref) { return static_cast<ObjType*>(ref); }
 
+  std::size_t liveCount() const { return liveCount_; }
+  MemoryStats memoryStats() const { return makeStats(liveCount_,0,sizeof(ObjType),liveCount_*sizeof(ObjType)); }
+
+private:
+  std::size_t liveCount_{0};
 };
 
 template <>
@@ -73,6 +138,353 @@ struct AllocatorTraits<AllocatorNew> {
   static constexpr RefType nullRef = nullptr;
 };
 
+/**
+ * \brief Allocator that carves objects out of large contiguous slabs.
+ *
+ * Objects are placed in slabs of a fixed number of objects (set at construction),
+ * and deleted objects are kept on a free list for reuse. Compared to AllocatorNew this
+ * makes far fewer heap allocations and keeps nodes close together in memory.
+ *
+ * When the object type is trivially destructible the whole allocation can be dropped in
+ * one step via releaseAll(), without visiting each object. RadixTree uses this to tear
+ * down trees without walking them. Objects still live when the allocator itself is
+ * destroyed are not destructed, so owners of non-trivial objects must delete them first.
+ */
+template <typename ObjType>
+class AllocatorSlab
+  : public AllocatorValueCounter
+{
+public:
+  typedef void* RefType;
+  static constexpr RefType nullRef = nullptr;
+  static constexpr std::size_t DefaultSlabObjCount = 4096;
+  static constexpr bool CanReleaseAll = std::is_trivially_destructible<ObjType>::value;
+
+  inline explicit AllocatorSlab(std::size_t slabObjCount = DefaultSlabObjCount);
+
+  AllocatorSlab(const AllocatorSlab& o) = delete;
+  AllocatorSlab& operator=(const AllocatorSlab& o) = delete;
+
+  inline AllocatorSlab(AllocatorSlab&& o) noexcept;
+  inline AllocatorSlab& operator=(AllocatorSlab&& o) noexcept;
+
+  template <typename... Args>
+  inline RefType newRef(Args&&... a);
+  inline void deleteRef(RefType ref);
+  static ObjType* getPtr(RefType ref) { return static_cast<ObjType*>(ref); }
+
+  /**
+   * \brief Drop every slab at once without running any destructors.
+   *
+   * Only available for trivially destructible object types; all outstanding
+   * references become invalid.
+   */
+  inline void releaseAll();
+
+  std::size_t slabObjCount() const { return slabObjCount_; }
+  std::size_t slabCount() const { return slabs_.size(); }
+  std::size_t liveCount() const { return liveCount_; }
+  inline MemoryStats memoryStats() const;
+
+private:
+  union Slot {
+    Slot* next;
+    typename std::aligned_storage<sizeof(ObjType),alignof(ObjType)>::type obj;
+  };
+
+  std::vector<std::unique_ptr<Slot[]>> slabs_{};
+  std::size_t slabObjCount_;
+  std::size_t nextInSlab_;
+  Slot* freeList_{nullptr};
+  std::size_t liveCount_{0};
+};
+
+template <>
+struct AllocatorTraits<AllocatorSlab> {
+  using RefType = void*;
+  static constexpr RefType nullRef = nullptr;
+};
+
+/**
+ * \brief AllocatorSlab variant handing out 32 bit slot indices rather than pointers.
+ *
+ * Halves the size of every child reference in the pointer based node types on 64 bit
+ * hosts, for trees of up to 2^32 - 1 nodes. Slabs hold a power of two number of
+ * objects, so getPtr() is a slab table lookup plus an offset. Index 0 is never handed
+ * out and serves as the null ref. Slots are never moved, so pointers from getPtr()
+ * stay valid until the object is deleted.
+ */
+template <typename ObjType>
+class AllocatorSlabIndex
+  : public AllocatorValueCounter
+{
+public:
+  typedef uint32_t RefType;
+  static constexpr RefType nullRef = 0;
+  static constexpr std::size_t DefaultSlabBits = 12;
+  static constexpr bool CanReleaseAll = std::is_trivially_destructible<ObjType>::value;
+
+  /**
+   * \brief Slabs of 2^slabBits objects.
+   */
+  inline explicit AllocatorSlabIndex(std::size_t slabBits = DefaultSlabBits);
+
+  AllocatorSlabIndex(const AllocatorSlabIndex& o) = delete;
+  AllocatorSlabIndex& operator=(const AllocatorSlabIndex& o) = delete;
+
+  inline AllocatorSlabIndex(AllocatorSlabIndex&& o) noexcept;
+  inline AllocatorSlabIndex& operator=(AllocatorSlabIndex&& o) noexcept;
+
+  template <typename... Args>
+  inline RefType newRef(Args&&... a);
+  inline void deleteRef(RefType ref);
+  ObjType* getPtr(RefType ref) const {
+    return reinterpret_cast<ObjType*>(&slabs_[ref >> slabBits_][ref & slabMask_].obj);
+  }
+
+  /**
+   * \brief Drop every slab at once without running any destructors, see AllocatorSlab::releaseAll().
+   */
+  inline void releaseAll();
+
+  std::size_t slabObjCount() const { return (slabMask_ + 1); }
+  std::size_t slabCount() const { return slabs_.size(); }
+  std::size_t liveCount() const { return liveCount_; }
+  inline MemoryStats memoryStats() const;
+
+private:
+  union Slot {
+    RefType next;
+    typename std::aligned_storage<sizeof(ObjType),alignof(ObjType)>::type obj;
+  };
+
+  inline void reset();
+
+  std::vector<std::unique_ptr<Slot[]>> slabs_{};
+  std::size_t slabBits_;
+  RefType slabMask_;
+  uint64_t nextRef_{1};
+  RefType freeList_{nullRef};
+  std::size_t liveCount_{0};
+};
+
+template <>
+struct AllocatorTraits<AllocatorSlabIndex> {
+  using RefType = uint32_t;
+  static constexpr RefType nullRef = 0;
+};
+
+/**
+ * \brief Detect allocators able to discard all their objects in one step (see AllocatorSlab::releaseAll).
+ */
+template <typename AllocT,typename = void>
+struct AllocatorCanReleaseAll : public std::false_type {};
+
+template <typename AllocT>
+struct AllocatorCanReleaseAll<AllocT,typename std::enable_if<AllocT::CanReleaseAll>::type> : public std::true_type {};
+
+/**
+ * \brief Detect allocators that keep the tree root themselves (see WordBlockMmapAllocator).
+ *
+ * RadixTree picks up an existing root from such an allocator instead of making a new one,
+ * and leaves the nodes in place when it is destroyed.
+ */
+template <typename AllocT,typename = void>
+struct AllocatorHasPersistentRoot : public std::false_type {};
+
+template <typename AllocT>
+struct AllocatorHasPersistentRoot<AllocT,typename std::enable_if<AllocT::PersistentRoot>::type> : public std::true_type {};
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename ObjType>
+AllocatorSlab<ObjType>::AllocatorSlab(std::size_t slabObjCount)
+  : slabObjCount_(slabObjCount)
+  , nextInSlab_(slabObjCount)
+{
+  if (slabObjCount_ == 0) { throw std::invalid_argument("AllocatorSlab: slab object count must be positive"); }
+}
+
+template <typename ObjType>
+AllocatorSlab<ObjType>::AllocatorSlab(AllocatorSlab<ObjType>&& o) noexcept
+  : slabs_(std::move(o.slabs_))
+  , slabObjCount_(o.slabObjCount_)
+  , nextInSlab_(o.nextInSlab_)
+  , freeList_(o.freeList_)
+  , liveCount_(o.liveCount_)
+{
+  valueCount_ = o.valueCount_;
+  o.valueCount_ = 0;
+  o.slabs_.clear();
+  o.nextInSlab_ = o.slabObjCount_;
+  o.freeList_ = nullptr;
+  o.liveCount_ = 0;
+}
+
+template <typename ObjType>
+AllocatorSlab<ObjType>& AllocatorSlab<ObjType>::operator=(AllocatorSlab<ObjType>&& o) noexcept {
+  if (this == &o) { return *this; }
+  slabs_ = std::move(o.slabs_);
+  slabObjCount_ = o.slabObjCount_;
+  nextInSlab_ = o.nextInSlab_;
+  freeList_ = o.freeList_;
+  liveCount_ = o.liveCount_;
+  valueCount_ = o.valueCount_;
+  o.valueCount_ = 0;
+  o.slabs_.clear();
+  o.nextInSlab_ = o.slabObjCount_;
+  o.freeList_ = nullptr;
+  o.liveCount_ = 0;
+  return *this;
+}
+
+template <typename ObjType>
+template <typename... Args>
+typename AllocatorSlab<ObjType>::RefType AllocatorSlab<ObjType>::newRef(Args&&... a) {
+  Slot* slot;
+  if (freeList_ != nullptr) {
+    slot = freeList_;
+    freeList_ = slot->next;
+  } else {
+    if (nextInSlab_ == slabObjCount_) {
+      slabs_.emplace_back(new Slot[slabObjCount_]);
+      nextInSlab_ = 0;
+    }
+    slot = &slabs_.back()[nextInSlab_++];
+  }
+
+  ObjType* obj;
+  try {
+    obj = new (static_cast<void*>(slot)) ObjType{std::forward<Args>(a)...};
+  } catch (...) {
+    slot->next = freeList_;
+    freeList_ = slot;
+    throw;
+  }
+  ++liveCount_;
+  return obj;
+}
+
+template <typename ObjType>
+void AllocatorSlab<ObjType>::deleteRef(RefType ref) {
+  if (ref == nullRef) { return; }
+  getPtr(ref)->~ObjType();
+  Slot* slot = static_cast<Slot*>(ref);
+  slot->next = freeList_;
+  freeList_ = slot;
+  --liveCount_;
+}
+
+template <typename ObjType>
+void AllocatorSlab<ObjType>::releaseAll() {
+  static_assert(CanReleaseAll,"AllocatorSlab::releaseAll requires a trivially destructible object type");
+  slabs_.clear();
+  nextInSlab_ = slabObjCount_;
+  freeList_ = nullptr;
+  liveCount_ = 0;
+  valueCount_ = 0;
+}
+
+template <typename ObjType>
+MemoryStats AllocatorSlab<ObjType>::memoryStats() const {
+  std::size_t carved = slabs_.empty() ? 0 : ((slabs_.size() - 1)*slabObjCount_ + nextInSlab_);
+  return makeStats(liveCount_,carved - liveCount_,sizeof(ObjType),slabs_.size()*slabObjCount_*sizeof(Slot));
+}
+
+template <typename ObjType>
+AllocatorSlabIndex<ObjType>::AllocatorSlabIndex(std::size_t slabBits)
+  : slabBits_(slabBits)
+  , slabMask_(static_cast<RefType>((static_cast<uint64_t>(0x1) << slabBits) - 1))
+{
+  if ((slabBits_ == 0) || (slabBits_ > 24)) { throw std::invalid_argument("AllocatorSlabIndex: slab bits must be 1..24"); }
+}
+
+template <typename ObjType>
+AllocatorSlabIndex<ObjType>::AllocatorSlabIndex(AllocatorSlabIndex<ObjType>&& o) noexcept
+  : slabs_(std::move(o.slabs_))
+  , slabBits_(o.slabBits_)
+  , slabMask_(o.slabMask_)
+  , nextRef_(o.nextRef_)
+  , freeList_(o.freeList_)
+  , liveCount_(o.liveCount_)
+{
+  valueCount_ = o.valueCount_;
+  o.reset();
+}
+
+template <typename ObjType>
+AllocatorSlabIndex<ObjType>& AllocatorSlabIndex<ObjType>::operator=(AllocatorSlabIndex<ObjType>&& o) noexcept {
+  if (this == &o) { return *this; }
+  slabs_ = std::move(o.slabs_);
+  slabBits_ = o.slabBits_;
+  slabMask_ = o.slabMask_;
+  nextRef_ = o.nextRef_;
+  freeList_ = o.freeList_;
+  liveCount_ = o.liveCount_;
+  valueCount_ = o.valueCount_;
+  o.reset();
+  return *this;
+}
+
+template <typename ObjType>
+void AllocatorSlabIndex<ObjType>::reset() {
+  slabs_.clear();
+  nextRef_ = 1;
+  freeList_ = nullRef;
+  liveCount_ = 0;
+  valueCount_ = 0;
+}
+
+template <typename ObjType>
+template <typename... Args>
+typename AllocatorSlabIndex<ObjType>::RefType AllocatorSlabIndex<ObjType>::newRef(Args&&... a) {
+  RefType ref;
+  if (freeList_ != nullRef) {
+    ref = freeList_;
+    freeList_ = slabs_[ref >> slabBits_][ref & slabMask_].next;
+  } else {
+    if (nextRef_ > std::numeric_limits<RefType>::max()) { throw std::length_error("AllocatorSlabIndex: out of 32 bit refs"); }
+    ref = static_cast<RefType>(nextRef_);
+    if ((ref >> slabBits_) == slabs_.size()) { slabs_.emplace_back(new Slot[slabMask_ + 1]); }
+    ++nextRef_;
+  }
+
+  Slot& slot = slabs_[ref >> slabBits_][ref & slabMask_];
+  try {
+    new (static_cast<void*>(&slot.obj)) ObjType{std::forward<Args>(a)...};
+  } catch (...) {
+    slot.next = freeList_;
+    freeList_ = ref;
+    throw;
+  }
+  ++liveCount_;
+  return ref;
+}
+
+template <typename ObjType>
+void AllocatorSlabIndex<ObjType>::deleteRef(RefType ref) {
+  if (ref == nullRef) { return; }
+  getPtr(ref)->~ObjType();
+  slabs_[ref >> slabBits_][ref & slabMask_].next = freeList_;
+  freeList_ = ref;
+  --liveCount_;
+}
+
+template <typename ObjType>
+void AllocatorSlabIndex<ObjType>::releaseAll() {
+  static_assert(CanReleaseAll,"AllocatorSlabIndex::releaseAll requires a trivially destructible object type");
+  reset();
+}
+
+template <typename ObjType>
+MemoryStats AllocatorSlabIndex<ObjType>::memoryStats() const {
+  // slot 0 is carved but never used
+  std::size_t carved = (slabs_.empty() ? 0 : static_cast<std::size_t>(nextRef_ - 1));
+  return makeStats(liveCount_,carved - liveCount_,sizeof(ObjType),slabs_.size()*(slabMask_ + 1)*sizeof(Slot));
+}
+
 }
 }
 }
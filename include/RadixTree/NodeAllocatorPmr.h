@@ -0,0 +1,151 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_ALLOCATOR_PMR_H_
+#define AKAMAI_MAPPER_RADIX_TREE_ALLOCATOR_PMR_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+
+#include "NodeAllocator.h"
+#include "SimpleRadixTree.h"
+
+/**
+ * \file NodeAllocatorPmr.h
+ * Node allocator drawing from a std::pmr::memory_resource (requires C++17).
+ */
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \brief Allocator that takes node storage from a std::pmr::memory_resource.
+ *
+ * Construct the tree with a memory_resource pointer (the default resource is used
+ * otherwise). Node types that accept (std::allocator_arg,allocator) construction,
+ * e.g. SimpleNodeImpl, are handed a polymorphic_allocator on the same resource, which
+ * they pass on to allocator-aware values such as std::pmr::string. Nodes and their
+ * values then share one monotonic or pool resource per tree.
+ *
+ * Nodes are still individually destroyed and deallocated on tree teardown, so this is
+ * safe with any resource; with a monotonic resource those deallocations are free and
+ * all memory comes back when the resource itself is released.
+ */
+template <typename ObjType>
+class AllocatorPmr
+  : public AllocatorValueCounter
+{
+public:
+  typedef void* RefType;
+  static constexpr RefType nullRef = nullptr;
+  using PolyAllocatorType = std::pmr::polymorphic_allocator<std::byte>;
+
+  explicit AllocatorPmr(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : resource_(resource) {}
+
+  template <typename... Args>
+  inline RefType newRef(Args&&... a);
+  inline void deleteRef(RefType ref);
+  static ObjType* getPtr(RefType ref) { return static_cast<ObjType*>(ref); }
+
+  std::pmr::memory_resource* resource() const { return resource_; }
+  std::size_t liveCount() const { return liveCount_; }
+  MemoryStats memoryStats() const { return makeStats(liveCount_,0,sizeof(ObjType),liveCount_*sizeof(ObjType)); }
+
+private:
+  ObjType* construct(void* p) { return constructDefault(p,std::is_constructible<ObjType,std::allocator_arg_t,const PolyAllocatorType&>{}); }
+  ObjType* constructDefault(void* p,std::true_type) { return new (p) ObjType(std::allocator_arg,PolyAllocatorType(resource_)); }
+  ObjType* constructDefault(void* p,std::false_type) { return new (p) ObjType{}; }
+  template <typename Arg,typename... Args>
+  ObjType* construct(void* p,Arg&& a,Args&&... as) { return new (p) ObjType{std::forward<Arg>(a),std::forward<Args>(as)...}; }
+
+  std::pmr::memory_resource* resource_{nullptr};
+  std::size_t liveCount_{0};
+};
+
+template <>
+struct AllocatorTraits<AllocatorPmr> {
+  using RefType = void*;
+  static constexpr RefType nullRef = nullptr;
+};
+
+/**
+ * \brief Child map for SimpleNodeImplMap that also allocates from the tree's resource.
+ */
+template <typename KeyT,typename ValT>
+using PmrNodeChildMap = std::pmr::unordered_map<KeyT,ValT>;
+
+/**
+ * \brief Simple tree node/tree with node and value storage from a memory_resource.
+ *
+ * Use an allocator-aware ValueT (std::pmr::string, std::pmr::vector...) to have values
+ * share the resource too.
+ */
+template <std::size_t R,typename ValueT,std::size_t EdgeLen>
+using SimpleTreeNodePmr = NodeInterface<AllocatorPmr<SimpleTreeNodeImpl<R,ValueT,EdgeLen>>,SimpleTreeNodeImpl<R,ValueT,EdgeLen>>;
+
+template <typename ValueT,std::size_t R,std::size_t MaxDepth,std::size_t EdgeLen>
+using SimpleRadixTreePmr = RadixTree<SimplePath<R,MaxDepth>,SimpleTreeNodePmr<R,ValueT,EdgeLen>,SimpleFixedDepthStack>;
+
+template <std::size_t R,typename ValueT,std::size_t EdgeLen>
+using SimpleTreeNodeMapPmr = NodeInterface<AllocatorPmr<SimpleTreeNodeImplMap<R,ValueT,EdgeLen,PmrNodeChildMap>>,
+                                           SimpleTreeNodeImplMap<R,ValueT,EdgeLen,PmrNodeChildMap>>;
+
+template <typename ValueT,std::size_t R,std::size_t MaxDepth,std::size_t EdgeLen>
+using SimpleRadixTreeMapPmr = RadixTree<SimplePath<R,MaxDepth>,SimpleTreeNodeMapPmr<R,ValueT,EdgeLen>,SimpleFixedDepthStack>;
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename ObjType>
+template <typename... Args>
+typename AllocatorPmr<ObjType>::RefType AllocatorPmr<ObjType>::newRef(Args&&... a) {
+  void* p = resource_->allocate(sizeof(ObjType),alignof(ObjType));
+  ObjType* obj;
+  try {
+    obj = construct(p,std::forward<Args>(a)...);
+  } catch (...) {
+    resource_->deallocate(p,sizeof(ObjType),alignof(ObjType));
+    throw;
+  }
+  ++liveCount_;
+  return obj;
+}
+
+template <typename ObjType>
+void AllocatorPmr<ObjType>::deleteRef(RefType ref) {
+  if (ref == nullRef) { return; }
+  getPtr(ref)->~ObjType();
+  resource_->deallocate(ref,sizeof(ObjType),alignof(ObjType));
+  --liveCount_;
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -106,13 +106,22 @@ public:
   ValueType& value() { return nodeImplPtr()->value(); }
 
   
-  void setValue(const ValueType& v) { nodeImplPtr()->setValue(v); }
-  void setValue(ValueType&& v) { nodeImplPtr()->setValue(std::move(v)); }
+  void setValue(const ValueType& v) {
+    if (!nodeImplPtr()->hasValue()) { alloc_->noteValueSet(); }
+    nodeImplPtr()->setValue(v);
+  }
+  void setValue(ValueType&& v) {
+    if (!nodeImplPtr()->hasValue()) { alloc_->noteValueSet(); }
+    nodeImplPtr()->setValue(std::move(v));
+  }
   
   /**
    * \brief Remove value stored at referenced node. 
    */
-  void clearValue() { nodeImplPtr()->clearValue(); }
+  void clearValue() {
+    if (nodeImplPtr()->hasValue()) { alloc_->noteValueCleared(); }
+    nodeImplPtr()->clearValue();
+  }
 
   /**
    * \brief Return referenced node object.
@@ -26,6 +26,7 @@ SOFTWARE.
 #include "Cursor.h"
 #include "WalkCursorRO.h"
 #include "LookupCursor.h"
+#include "NodeAllocator.h"
 
 namespace Akamai {
 namespace Mapper {
@@ -60,7 +61,7 @@ public:
   using Value = typename CursorROType::ValueType;
 
   template <typename... AllocatorArgs>
-  RadixTree(AllocatorArgs&&... aa) : alloc_(std::forward<AllocatorArgs>(aa)...), root_(alloc_.newRef()) {}
+  RadixTree(AllocatorArgs&&... aa) : alloc_(std::forward<AllocatorArgs>(aa)...), root_(attachRoot()) {}
 
   // No auto copying allowed - any tree copying must be done manually
   RadixTree(const MyType& o) = delete;
@@ -77,6 +78,17 @@ public:
    */
   inline void clear();
 
+  /**
+   * \brief Rewrite the nodes contiguously in pre-order and give back unused memory.
+   *
+   * Only available for node types providing a static compact(allocator,root), i.e. the
+   * word based binary nodes and InlineLeafNodeInterface. Invalidates any existing cursors.
+   */
+  void compact() {
+    root_ = NodeType::compact(alloc_,root_);
+    storeRoot();
+  }
+
   /**
    * \brief Return an RO cursor at the root of the tree.
    */
@@ -117,10 +129,38 @@ public:
    */
   const NodeAllocatorType& nodeAllocator() const { return alloc_; }
 
+  /**
+   * \brief Node/value counts and memory footprint, maintained incrementally by the allocator.
+   */
+  MemoryStats memoryStats() const { return alloc_.memoryStats(); }
+
 private:
   using NodeRefType = typename NodeAllocatorType::RefType;
   NodeAllocatorType alloc_{};
   NodeRefType root_{NodeAllocatorType::nullRef};
+
+  /**
+   * \brief Free every node including the root, leaving root_ dangling.
+   * Allocators that can drop everything at once do so, otherwise walk the tree.
+   */
+  void removeAllNodes() { removeAllNodes(AllocatorCanReleaseAll<NodeAllocatorType>{}); }
+  inline void removeAllNodes(std::true_type);
+  inline void removeAllNodes(std::false_type);
+
+  /**
+   * \brief Allocators that persist the tree (e.g. in a file) also keep track of the root.
+   * Pick up their existing root at construction, tell them when it changes, and leave the
+   * nodes alone when this tree object goes away.
+   */
+  NodeRefType attachRoot() { return attachRoot(AllocatorHasPersistentRoot<NodeAllocatorType>{}); }
+  inline NodeRefType attachRoot(std::true_type);
+  NodeRefType attachRoot(std::false_type) { return alloc_.newRef(); }
+  void storeRoot() { storeRoot(AllocatorHasPersistentRoot<NodeAllocatorType>{}); }
+  void storeRoot(std::true_type) { alloc_.setRootRef(root_); }
+  void storeRoot(std::false_type) {}
+  void detachTree() { detachTree(AllocatorHasPersistentRoot<NodeAllocatorType>{}); }
+  inline void detachTree(std::true_type);
+  void detachTree(std::false_type) { removeAllNodes(); }
 };
 
 
@@ -140,7 +180,7 @@ template <typename PathType,typename NodeType,template<typename,std::size_t> cla
 RadixTree<PathType,NodeType,NodeStackType>&
 RadixTree<PathType,NodeType,NodeStackType>::operator=(RadixTree<PathType,NodeType,NodeStackType>&& o) {
   if (this == &o) { return *this; }
-  alloc_.deleteRef(root_);
+  if (root_ != NodeAllocatorType::nullRef) { detachTree(); }
   root_ = std::move(o.root_);
   o.root_ = NodeAllocatorType::nullRef;
   alloc_ = std::move(o.alloc_);
@@ -166,11 +206,35 @@ inline void postOrderRemoveNodes(CursorType&& c) {
 }
 
 template <typename PathType,typename NodeType,template<typename,std::size_t> class NodeStackType>
-RadixTree<PathType,NodeType,NodeStackType>::~RadixTree() {
+void RadixTree<PathType,NodeType,NodeStackType>::removeAllNodes(std::true_type) {
+  alloc_.releaseAll();
+}
+
+template <typename PathType,typename NodeType,template<typename,std::size_t> class NodeStackType>
+void RadixTree<PathType,NodeType,NodeStackType>::removeAllNodes(std::false_type) {
   // walk tree and remove all the nodes post-order
+  postOrderRemoveNodes(cursor());
+  alloc_.deleteRef(root_);
+}
+
+template <typename PathType,typename NodeType,template<typename,std::size_t> class NodeStackType>
+typename RadixTree<PathType,NodeType,NodeStackType>::NodeRefType
+RadixTree<PathType,NodeType,NodeStackType>::attachRoot(std::true_type) {
+  if (alloc_.rootRef() == NodeAllocatorType::nullRef) { alloc_.setRootRef(alloc_.newRef()); }
+  return alloc_.rootRef();
+}
+
+template <typename PathType,typename NodeType,template<typename,std::size_t> class NodeStackType>
+void RadixTree<PathType,NodeType,NodeStackType>::detachTree(std::true_type) {
+  // Best effort flush - this runs from the destructor so can't throw,
+  // callers wanting to see sync errors should sync explicitly first.
+  try { alloc_.sync(); } catch (...) {}
+}
+
+template <typename PathType,typename NodeType,template<typename,std::size_t> class NodeStackType>
+RadixTree<PathType,NodeType,NodeStackType>::~RadixTree() {
   if (root_ != NodeAllocatorType::nullRef) {
-    postOrderRemoveNodes(cursor());
-    alloc_.deleteRef(root_);
+    detachTree();
     root_ = NodeAllocatorType::nullRef;
   }
 }
@@ -179,10 +243,10 @@ RadixTree<PathType,NodeType,NodeStackType>::~RadixTree() {
 template <typename PathType,typename NodeType,template<typename,std::size_t> class NodeStackType>
 void RadixTree<PathType,NodeType,NodeStackType>::clear() {
   if (root_ != NodeAllocatorType::nullRef) {
-    postOrderRemoveNodes(cursor());
-    alloc_.deleteRef(root_);
+    removeAllNodes();
   }
   root_ = alloc_.newRef();
+  storeRoot();
 }
 
 } // namespace RadixTree
@@ -23,8 +23,14 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <stdint.h>
 #include <cstddef>
 #include <array>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include "ChildKeySearch.h"
 
 namespace Akamai {
 namespace Mapper {
@@ -61,7 +67,13 @@ class SimpleNodeImplBaseValue
   : public SimpleNodeImplBase<R,EdgeT,NodeRef,nullRef>
 {
 public:
+  using ValueType = ValueT;
   SimpleNodeImplBaseValue() = default;
+  /**
+   * \brief Allocator-extended construction, the allocator is passed on to allocator-aware values.
+   */
+  template <typename Alloc>
+  SimpleNodeImplBaseValue(std::allocator_arg_t,const Alloc& a) : SimpleNodeImplBaseValue(a,std::uses_allocator<ValueT,Alloc>{}) {}
   ~SimpleNodeImplBaseValue() = default;
 
   bool hasValue() const { return hasValue_; }
@@ -85,6 +97,11 @@ public:
   }
 
 private:
+  template <typename Alloc>
+  SimpleNodeImplBaseValue(const Alloc& a,std::true_type) : value_(a) {}
+  template <typename Alloc>
+  SimpleNodeImplBaseValue(const Alloc&,std::false_type) : value_() {}
+
   bool hasValue_{false};
   ValueT value_;
 };
@@ -97,7 +114,10 @@ class SimpleNodeImplBaseValue<R,EdgeT,bool,NodeRef,nullRef>
   : public SimpleNodeImplBase<R,EdgeT,NodeRef,nullRef>
 {
 public:
+  using ValueType = bool;
   SimpleNodeImplBaseValue() = default;
+  template <typename Alloc>
+  SimpleNodeImplBaseValue(std::allocator_arg_t,const Alloc&) {}
   ~SimpleNodeImplBaseValue() = default;
 
   const bool& value() const { return this->hasValue_; }
@@ -110,20 +130,154 @@ private:
   bool hasValue_{false};
 };
 
+/**
+ * \brief Value type tag: keep ValueT out of line, allocated only for nodes that have a value.
+ *
+ * Use OutOfLineValue<ValueT> wherever a node implementation takes its value type, the
+ * tree's ValueType is still ValueT. Nodes hold a single pointer instead of a ValueT plus
+ * flag, so the (usually many) branching nodes without values stay small when ValueT is
+ * large. Costs an extra allocation per value and an extra dependent load on value reads.
+ */
+template <typename ValueT>
+struct OutOfLineValue {
+  using ValueType = ValueT;
+};
+
+/**
+ * \brief Specialize for out of line values - the value lives behind a pointer, null if not set.
+ *
+ * Values are always allocated with new, an allocator passed in at construction isn't used
+ * for them.
+ */
+template <std::size_t R,typename EdgeT,typename ValueT,typename NodeRef,NodeRef nullRef>
+class SimpleNodeImplBaseValue<R,EdgeT,OutOfLineValue<ValueT>,NodeRef,nullRef>
+  : public SimpleNodeImplBase<R,EdgeT,NodeRef,nullRef>
+{
+public:
+  using ValueType = ValueT;
+  SimpleNodeImplBaseValue() = default;
+  template <typename Alloc>
+  SimpleNodeImplBaseValue(std::allocator_arg_t,const Alloc&) {}
+  ~SimpleNodeImplBaseValue() = default;
+
+  bool hasValue() const { return (value_ != nullptr); }
+
+  /**
+   * \brief Only valid if hasValue().
+   */
+  const ValueT& value() const { return *value_; }
+  ValueT& value() { return *value_; }
+
+  void setValue(const ValueT& v) {
+    if (value_) { *value_ = v; }
+    else { value_.reset(new ValueT(v)); }
+  }
+
+  void setValue(ValueT&& v) {
+    if (value_) { *value_ = std::move(v); }
+    else { value_.reset(new ValueT(std::move(v))); }
+  }
+
+  void clearValue() { value_.reset(); }
+
+private:
+  std::unique_ptr<ValueT> value_{};
+};
+
+/**
+ * \brief Child reference store that adapts its layout to the number of children (ART style).
+ *
+ * Up to 4 children are kept inline as a sorted key/ref array. Beyond that the children
+ * move out of line into a sorted 16 entry array, then a 48 entry array behind an R entry
+ * byte index, and finally a plain R entry array. Layouts shrink back (with some hysteresis)
+ * as children are removed. Only layouts with capacity below R are ever grown out of, so
+ * small radix trees never leave the inline array.
+ */
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+class AdaptiveChildArray
+{
+public:
+  static_assert(R <= 256,"AdaptiveChildArray: child keys must fit in a byte");
+  using KeyType = uint8_t;
+
+  AdaptiveChildArray() = default;
+  AdaptiveChildArray(const AdaptiveChildArray& o) = delete;
+  AdaptiveChildArray& operator=(const AdaptiveChildArray& o) = delete;
+  ~AdaptiveChildArray() { freeBlock(); }
+
+  inline NodeRef get(std::size_t c) const;
+  /**
+   * \brief Set child c to (non-null) r, returns the previous child.
+   */
+  inline NodeRef set(std::size_t c,NodeRef r);
+  /**
+   * \brief Remove child c, returns the previous child.
+   */
+  inline NodeRef remove(std::size_t c);
+  std::size_t size() const { return count_; }
+  bool empty() const { return (count_ == 0); }
+  /**
+   * \brief Number of children the current layout holds before it has to grow.
+   */
+  std::size_t capacity() const { return Capacity[static_cast<std::size_t>(kind_)]; }
+
+private:
+  enum class Kind : uint8_t { Node4 = 0, Node16 = 1, Node48 = 2, Node256 = 3 };
+  static constexpr std::array<std::size_t,4> Capacity{{4,16,48,R}};
+  // Shrink a layout once the child count drops to this (or below)
+  static constexpr std::array<std::size_t,4> ShrinkAt{{0,3,12,36}};
+
+  struct Block16 {
+    std::array<KeyType,16> keys;
+    std::array<NodeRef,16> refs;
+  };
+  struct Block48 {
+    // Slot + 1 of each key, 0 for no child
+    std::array<uint8_t,R> index;
+    std::array<NodeRef,48> refs;
+  };
+  struct Block256 {
+    std::array<NodeRef,R> refs;
+  };
+
+  Kind kind_{Kind::Node4};
+  uint16_t count_{0};
+  std::array<KeyType,4> keys4_{};
+  std::array<NodeRef,4> refs4_{};
+  union {
+    Block16* b16;
+    Block48* b48;
+    Block256* b256;
+  } block_{nullptr};
+
+  const KeyType* sortedKeys() const { return ((kind_ == Kind::Node4) ? keys4_.data() : block_.b16->keys.data()); }
+  KeyType* sortedKeys() { return ((kind_ == Kind::Node4) ? keys4_.data() : block_.b16->keys.data()); }
+  const NodeRef* sortedRefs() const { return ((kind_ == Kind::Node4) ? refs4_.data() : block_.b16->refs.data()); }
+  NodeRef* sortedRefs() { return ((kind_ == Kind::Node4) ? refs4_.data() : block_.b16->refs.data()); }
+  inline std::size_t findKey(KeyType k) const;
+  inline std::size_t lowerBound(KeyType k) const;
+  inline void freeBlock();
+  inline void relayout(Kind newKind);
+  inline void insertNew(KeyType k,NodeRef r);
+};
+
   // finally add routines for handling children
 template <std::size_t R,typename EdgeT,typename ValueT,typename NodeRef,NodeRef nullRef>
 class SimpleNodeImpl
   : public SimpleNodeImplBaseValue<R,EdgeT,ValueT,NodeRef,nullRef>
 {
 public:
+  using Base = SimpleNodeImplBaseValue<R,EdgeT,ValueT,NodeRef,nullRef>;
   using EdgeType = EdgeT;
   using NodeImplRefType = NodeRef;
   static constexpr NodeImplRefType nodeNullRef = nullRef;
   static constexpr std::size_t Radix = R;
   static constexpr bool ValueIsCopy = false;
-  using ValueType = ValueT;
+  using ValueType = typename Base::ValueType;
 
   SimpleNodeImpl() = default;
+  template <typename Alloc>
+  SimpleNodeImpl(std::allocator_arg_t,const Alloc& a) : Base(std::allocator_arg,a), children_{} {}
   ~SimpleNodeImpl() = default;
 
   NodeRef getChild(std::size_t c) const { return children_.at(c); }
@@ -142,6 +296,11 @@ public:
     for (std::size_t c=0;c<R;++c) { if (hasChild(c)) { return false; } }
     return true; 
   }
+  /**
+   * \brief Direct access to the storage for child c, for node interfaces that keep
+   * more than plain refs there (see InlineLeafNodeInterface).
+   */
+  NodeRef* childSlot(std::size_t c) { return &children_.at(c); }
 
 private:
   // Children - store as simple array
@@ -158,14 +317,22 @@ class SimpleNodeImplMap
   : public SimpleNodeImplBaseValue<R,EdgeT,ValueT,NodeRef,nullRef>
 {
 public:
+  using Base = SimpleNodeImplBaseValue<R,EdgeT,ValueT,NodeRef,nullRef>;
   using EdgeType = EdgeT;
   using NodeImplRefType = NodeRef;
   static constexpr NodeImplRefType nodeNullRef = nullRef;
   static constexpr std::size_t Radix = R;
   static constexpr bool ValueIsCopy = false;
-  using ValueType = ValueT;
+  using ValueType = typename Base::ValueType;
 
   SimpleNodeImplMap() = default;
+  /**
+   * \brief Allocator-extended construction, the allocator is passed on to the value and child map.
+   */
+  template <typename Alloc>
+  SimpleNodeImplMap(std::allocator_arg_t,const Alloc& a)
+    : Base(std::allocator_arg,a)
+    , children_(makeChildMap(a,std::uses_allocator<ChildMapType,Alloc>{})) {}
   ~SimpleNodeImplMap() = default;
 
   NodeRef getChild(std::size_t c) const {
@@ -205,9 +372,224 @@ public:
   bool isLeaf() const { return children_.empty(); }
 
 private:
-  ChildMapT<std::size_t,NodeRef> children_{};
+  using ChildMapType = ChildMapT<std::size_t,NodeRef>;
+
+  template <typename Alloc>
+  static ChildMapType makeChildMap(const Alloc& a,std::true_type) { return ChildMapType(a); }
+  template <typename Alloc>
+  static ChildMapType makeChildMap(const Alloc&,std::false_type) { return ChildMapType{}; }
+
+  ChildMapType children_{};
+};
+
+/**
+ * \brief Node implementation with adaptively sized child storage.
+ * Dense array lookups for nodes with many children, close to map memory use for sparse ones.
+ * @see AdaptiveChildArray
+ */
+template <std::size_t R,typename EdgeT,typename ValueT,typename NodeRef,NodeRef nullRef>
+class SimpleNodeImplAdaptive
+  : public SimpleNodeImplBaseValue<R,EdgeT,ValueT,NodeRef,nullRef>
+{
+public:
+  using Base = SimpleNodeImplBaseValue<R,EdgeT,ValueT,NodeRef,nullRef>;
+  using EdgeType = EdgeT;
+  using NodeImplRefType = NodeRef;
+  static constexpr NodeImplRefType nodeNullRef = nullRef;
+  static constexpr std::size_t Radix = R;
+  static constexpr bool ValueIsCopy = false;
+  using ValueType = typename Base::ValueType;
+
+  SimpleNodeImplAdaptive() = default;
+  template <typename Alloc>
+  SimpleNodeImplAdaptive(std::allocator_arg_t,const Alloc& a) : Base(std::allocator_arg,a) {}
+  ~SimpleNodeImplAdaptive() = default;
+
+  NodeRef getChild(std::size_t c) const {
+    if (c >= R) { throw std::range_error("getChild() - child out of bounds"); }
+    return children_.get(c);
+  }
+  NodeRef setChild(std::size_t c,NodeRef newChild) {
+    if (newChild == nullRef) { return detachChild(c); }
+    if (c >= R) { throw std::range_error("setChild() - child out of bounds"); }
+    return children_.set(c,newChild);
+  }
+  NodeRef detachChild(std::size_t c) {
+    if (c >= R) { throw std::range_error("detachChild() - child out of bounds"); }
+    return children_.remove(c);
+  }
+  bool hasChild(std::size_t c) const { return ((c < R) && (children_.get(c) != nullRef)); }
+  bool isLeaf() const { return children_.empty(); }
+
+  /**
+   * \brief Children the current child layout holds before growing.
+   */
+  std::size_t childCapacity() const { return children_.capacity(); }
+
+private:
+  AdaptiveChildArray<R,NodeRef,nullRef> children_{};
 };
 
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+constexpr std::array<std::size_t,4> AdaptiveChildArray<R,NodeRef,nullRef>::Capacity;
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+constexpr std::array<std::size_t,4> AdaptiveChildArray<R,NodeRef,nullRef>::ShrinkAt;
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+std::size_t AdaptiveChildArray<R,NodeRef,nullRef>::findKey(KeyType k) const {
+  return ((kind_ == Kind::Node4) ? ChildKeySearch::findKey4(keys4_.data(),count_,k)
+                                 : ChildKeySearch::findKey16(block_.b16->keys.data(),count_,k));
+}
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+std::size_t AdaptiveChildArray<R,NodeRef,nullRef>::lowerBound(KeyType k) const {
+  return ((kind_ == Kind::Node4) ? ChildKeySearch::lowerBoundScalar(keys4_.data(),count_,k)
+                                 : ChildKeySearch::lowerBound16(block_.b16->keys.data(),count_,k));
+}
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+NodeRef AdaptiveChildArray<R,NodeRef,nullRef>::get(std::size_t c) const {
+  const KeyType k = static_cast<KeyType>(c);
+  switch (kind_) {
+  case Kind::Node4:
+  case Kind::Node16: {
+    const std::size_t i = findKey(k);
+    return ((i < count_) ? sortedRefs()[i] : nullRef);
+  }
+  case Kind::Node48: {
+    const uint8_t slot = block_.b48->index[c];
+    return ((slot != 0) ? block_.b48->refs[slot - 1] : nullRef);
+  }
+  case Kind::Node256:
+    return block_.b256->refs[c];
+  }
+  return nullRef;
+}
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+NodeRef AdaptiveChildArray<R,NodeRef,nullRef>::set(std::size_t c,NodeRef r) {
+  const KeyType k = static_cast<KeyType>(c);
+  NodeRef prev = get(c);
+  if (prev != nullRef) {
+    // Replace in place
+    switch (kind_) {
+    case Kind::Node4:
+    case Kind::Node16: sortedRefs()[findKey(k)] = r; break;
+    case Kind::Node48: block_.b48->refs[block_.b48->index[c] - 1] = r; break;
+    case Kind::Node256: block_.b256->refs[c] = r; break;
+    }
+    return prev;
+  }
+  if (count_ == capacity()) { relayout(static_cast<Kind>(static_cast<uint8_t>(kind_) + 1)); }
+  insertNew(k,r);
+  return nullRef;
+}
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+void AdaptiveChildArray<R,NodeRef,nullRef>::insertNew(KeyType k,NodeRef r) {
+  switch (kind_) {
+  case Kind::Node4:
+  case Kind::Node16: {
+    KeyType* keys = sortedKeys();
+    NodeRef* refs = sortedRefs();
+    const std::size_t i = lowerBound(k);
+    for (std::size_t j = count_; j > i; --j) {
+      keys[j] = keys[j - 1];
+      refs[j] = refs[j - 1];
+    }
+    keys[i] = k;
+    refs[i] = r;
+    break;
+  }
+  case Kind::Node48: {
+    std::size_t slot = 0;
+    while (block_.b48->refs[slot] != nullRef) { ++slot; }
+    block_.b48->refs[slot] = r;
+    block_.b48->index[k] = static_cast<uint8_t>(slot + 1);
+    break;
+  }
+  case Kind::Node256:
+    block_.b256->refs[k] = r;
+    break;
+  }
+  ++count_;
+}
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+NodeRef AdaptiveChildArray<R,NodeRef,nullRef>::remove(std::size_t c) {
+  const KeyType k = static_cast<KeyType>(c);
+  NodeRef prev = get(c);
+  if (prev == nullRef) { return nullRef; }
+  switch (kind_) {
+  case Kind::Node4:
+  case Kind::Node16: {
+    KeyType* keys = sortedKeys();
+    NodeRef* refs = sortedRefs();
+    for (std::size_t j = findKey(k); (j + 1) < count_; ++j) {
+      keys[j] = keys[j + 1];
+      refs[j] = refs[j + 1];
+    }
+    break;
+  }
+  case Kind::Node48:
+    block_.b48->refs[block_.b48->index[c] - 1] = nullRef;
+    block_.b48->index[c] = 0;
+    break;
+  case Kind::Node256:
+    block_.b256->refs[c] = nullRef;
+    break;
+  }
+  --count_;
+  if ((kind_ != Kind::Node4) && (count_ <= ShrinkAt[static_cast<std::size_t>(kind_)])) {
+    relayout(static_cast<Kind>(static_cast<uint8_t>(kind_) - 1));
+  }
+  return prev;
+}
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+void AdaptiveChildArray<R,NodeRef,nullRef>::freeBlock() {
+  switch (kind_) {
+  case Kind::Node4: break;
+  case Kind::Node16: delete block_.b16; break;
+  case Kind::Node48: delete block_.b48; break;
+  case Kind::Node256: delete block_.b256; break;
+  }
+  block_.b16 = nullptr;
+}
+
+template <std::size_t R,typename NodeRef,NodeRef nullRef>
+void AdaptiveChildArray<R,NodeRef,nullRef>::relayout(Kind newKind) {
+  // Pull out the children in key order...
+  std::array<KeyType,R> keys;
+  std::array<NodeRef,R> refs;
+  std::size_t n{0};
+  for (std::size_t c = 0; (c < R) && (n < count_); ++c) {
+    NodeRef r = get(c);
+    if (r != nullRef) {
+      keys[n] = static_cast<KeyType>(c);
+      refs[n++] = r;
+    }
+  }
+  // ...allocate the new layout before giving up the old one...
+  decltype(block_) newBlock{nullptr};
+  switch (newKind) {
+  case Kind::Node4: break;
+  case Kind::Node16: newBlock.b16 = new Block16{}; break;
+  case Kind::Node48: newBlock.b48 = new Block48{}; newBlock.b48->refs.fill(nullRef); break;
+  case Kind::Node256: newBlock.b256 = new Block256{}; newBlock.b256->refs.fill(nullRef); break;
+  }
+  freeBlock();
+  kind_ = newKind;
+  block_ = newBlock;
+  // ...and put them back.
+  count_ = 0;
+  for (std::size_t i = 0; i < n; ++i) { insertNew(keys[i],refs[i]); }
+}
 
 }
 }
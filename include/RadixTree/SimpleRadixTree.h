@@ -44,36 +44,70 @@ namespace RadixTree {
 
 /**
  * \brief Tree node implementation based on our basic allocator and simple edge.
+ *
+ * The allocator determines the child ref type, e.g. AllocatorSlabIndex for 32 bit refs.
  */
-template <std::size_t R,typename ValueT,std::size_t EdgeLen>
+template <std::size_t R,typename ValueT,std::size_t EdgeLen,template <typename> class AllocatorT = AllocatorNew>
 using SimpleTreeNodeImpl = SimpleNodeImpl<R,SimpleEdge<R,EdgeLen>,ValueT,
-                                          typename AllocatorTraits<AllocatorNew>::RefType,
-                                          AllocatorTraits<AllocatorNew>::nullRef>;
+                                          typename AllocatorTraits<AllocatorT>::RefType,
+                                          AllocatorTraits<AllocatorT>::nullRef>;
+
+template <std::size_t R,typename ValueT,std::size_t EdgeLen,template <typename> class AllocatorT = AllocatorNew>
+using SimpleTreeNode = NodeInterface<AllocatorT<SimpleTreeNodeImpl<R,ValueT,EdgeLen,AllocatorT>>,SimpleTreeNodeImpl<R,ValueT,EdgeLen,AllocatorT>>;
+
+
+template <typename ValueT,std::size_t R,std::size_t MaxDepth,std::size_t EdgeLen,template <typename> class AllocatorT = AllocatorNew>
+using SimpleRadixTree = RadixTree<SimplePath<R,MaxDepth>,SimpleTreeNode<R,ValueT,EdgeLen,AllocatorT>,SimpleFixedDepthStack>;
 
+/**
+ * \brief Same tree, but nodes are carved out of large slabs rather than individually new'd.
+ *
+ * With a trivially destructible value type the whole tree is released in one step.
+ */
 template <std::size_t R,typename ValueT,std::size_t EdgeLen>
-using SimpleTreeNode = NodeInterface<AllocatorNew<SimpleTreeNodeImpl<R,ValueT,EdgeLen>>,SimpleTreeNodeImpl<R,ValueT,EdgeLen>>;
+using SimpleTreeNodeSlab = NodeInterface<AllocatorSlab<SimpleTreeNodeImpl<R,ValueT,EdgeLen>>,SimpleTreeNodeImpl<R,ValueT,EdgeLen>>;
 
+template <typename ValueT,std::size_t R,std::size_t MaxDepth,std::size_t EdgeLen>
+using SimpleRadixTreeSlab = RadixTree<SimplePath<R,MaxDepth>,SimpleTreeNodeSlab<R,ValueT,EdgeLen>,SimpleFixedDepthStack>;
 
+/**
+ * \brief Slab tree with 32 bit child refs, see AllocatorSlabIndex.
+ */
 template <typename ValueT,std::size_t R,std::size_t MaxDepth,std::size_t EdgeLen>
-using SimpleRadixTree = RadixTree<SimplePath<R,MaxDepth>,SimpleTreeNode<R,ValueT,EdgeLen>,SimpleFixedDepthStack>;
+using SimpleRadixTreeSlabIndex = SimpleRadixTree<ValueT,R,MaxDepth,EdgeLen,AllocatorSlabIndex>;
 
 // Version of tree that uses a map to store the children instead of std::array
 
 template <typename KeyT,typename ValT>
 using DefaultNodeChildMap = std::unordered_map<KeyT,ValT>;
 
-template <std::size_t R,typename ValueT,std::size_t EdgeLen,template <typename,typename> class ChildMap = DefaultNodeChildMap>
+template <std::size_t R,typename ValueT,std::size_t EdgeLen,template <typename,typename> class ChildMap = DefaultNodeChildMap,
+          template <typename> class AllocatorT = AllocatorNew>
 using SimpleTreeNodeImplMap = SimpleNodeImplMap<R,SimpleEdge<R,EdgeLen>,ValueT,
-                                          typename AllocatorTraits<AllocatorNew>::RefType,
-                                          AllocatorTraits<AllocatorNew>::nullRef,
+                                          typename AllocatorTraits<AllocatorT>::RefType,
+                                          AllocatorTraits<AllocatorT>::nullRef,
                                           ChildMap>;
 
-template <std::size_t R,typename ValueT,std::size_t EdgeLen>
-using SimpleTreeNodeMap = NodeInterface<AllocatorNew<SimpleTreeNodeImplMap<R,ValueT,EdgeLen>>,SimpleTreeNodeImplMap<R,ValueT,EdgeLen>>;
+template <std::size_t R,typename ValueT,std::size_t EdgeLen,template <typename> class AllocatorT = AllocatorNew>
+using SimpleTreeNodeMap = NodeInterface<AllocatorT<SimpleTreeNodeImplMap<R,ValueT,EdgeLen,DefaultNodeChildMap,AllocatorT>>,
+                                        SimpleTreeNodeImplMap<R,ValueT,EdgeLen,DefaultNodeChildMap,AllocatorT>>;
 
 
-template <typename ValueT,std::size_t R,std::size_t MaxDepth,std::size_t EdgeLen>
-using SimpleRadixTreeMap = RadixTree<SimplePath<R,MaxDepth>,SimpleTreeNodeMap<R,ValueT,EdgeLen>,SimpleFixedDepthStack>;
+template <typename ValueT,std::size_t R,std::size_t MaxDepth,std::size_t EdgeLen,template <typename> class AllocatorT = AllocatorNew>
+using SimpleRadixTreeMap = RadixTree<SimplePath<R,MaxDepth>,SimpleTreeNodeMap<R,ValueT,EdgeLen,AllocatorT>,SimpleFixedDepthStack>;
+
+// Version of tree with adaptively sized child storage (4/16/48/R children)
+
+template <std::size_t R,typename ValueT,std::size_t EdgeLen,template <typename> class AllocatorT = AllocatorNew>
+using SimpleTreeNodeImplAdaptive = SimpleNodeImplAdaptive<R,SimpleEdge<R,EdgeLen>,ValueT,
+                                          typename AllocatorTraits<AllocatorT>::RefType,
+                                          AllocatorTraits<AllocatorT>::nullRef>;
+
+template <std::size_t R,typename ValueT,std::size_t EdgeLen,template <typename> class AllocatorT = AllocatorNew>
+using SimpleTreeNodeAdaptive = NodeInterface<AllocatorT<SimpleTreeNodeImplAdaptive<R,ValueT,EdgeLen,AllocatorT>>,SimpleTreeNodeImplAdaptive<R,ValueT,EdgeLen,AllocatorT>>;
+
+template <typename ValueT,std::size_t R,std::size_t MaxDepth,std::size_t EdgeLen,template <typename> class AllocatorT = AllocatorNew>
+using SimpleRadixTreeAdaptive = RadixTree<SimplePath<R,MaxDepth>,SimpleTreeNodeAdaptive<R,ValueT,EdgeLen,AllocatorT>,SimpleFixedDepthStack>;
 
 
 } // namespace RadixTree
@@ -0,0 +1,281 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_VALUE_DICTIONARY_H_
+#define AKAMAI_MAPPER_RADIX_TREE_VALUE_DICTIONARY_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "NodeValue.h"
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \file ValueDictionary.h
+ * Interned values for trees where many nodes share a small set of (large) values.
+ *
+ * The tree itself stores a small integer index per node, so any of the integer valued
+ * trees (CompactBinaryWordTree, the WORM UInt trees, ...) can hold them. A DictionaryCursor
+ * wrapped around one of that tree's cursors interns values on the way in and hands out
+ * references to the shared dictionary entries on the way out.
+ */
+
+/**
+ * \brief Append only set of unique values, each identified by a dense index.
+ *
+ * Values are never removed: an index stored in a tree stays valid for the dictionary's
+ * lifetime, and references returned by at() stay valid too (values live in a deque).
+ */
+template <typename ValueT,typename IndexT = uint32_t,typename HashT = std::hash<ValueT>>
+class ValueDictionary {
+public:
+  using ValueType = ValueT;
+  using IndexType = IndexT;
+  static_assert(std::is_integral<IndexType>::value && std::is_unsigned<IndexType>::value,"ValueDictionary: index must be an unsigned integer type");
+
+  ValueDictionary() = default;
+  ValueDictionary(const ValueDictionary& o) = delete;
+  ValueDictionary& operator=(const ValueDictionary& o) = delete;
+  ValueDictionary(ValueDictionary&& o) = default;
+  ValueDictionary& operator=(ValueDictionary&& o) = default;
+
+  /**
+   * \brief Return the index of v, adding it if it isn't already present.
+   *
+   * Throws std::length_error when a new value doesn't fit in IndexType.
+   */
+  inline IndexType intern(const ValueType& v);
+  inline IndexType intern(ValueType&& v);
+
+  /**
+   * \brief Look up a value without adding it, returns false if it isn't present.
+   */
+  inline bool find(const ValueType& v,IndexType* index) const;
+
+  /**
+   * \brief Value for index i, throws std::out_of_range for unknown indices.
+   */
+  const ValueType& at(IndexType i) const {
+    if (i >= values_.size()) { throw std::out_of_range("ValueDictionary: index out of range"); }
+    return values_[i];
+  }
+  const ValueType& operator[](IndexType i) const { return values_[i]; }
+
+  std::size_t size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+
+private:
+  using KeyType = std::reference_wrapper<const ValueType>;
+  struct KeyHash {
+    std::size_t operator()(const KeyType& k) const { return HashT{}(k.get()); }
+  };
+  struct KeyEqual {
+    bool operator()(const KeyType& a,const KeyType& b) const { return (a.get() == b.get()); }
+  };
+
+  template <typename V>
+  inline IndexType add(V&& v);
+
+  std::deque<ValueType> values_{};
+  std::unordered_map<KeyType,IndexType,KeyHash,KeyEqual> indices_{};
+};
+
+/**
+ * \brief Read only node value that resolves a stored dictionary index to the shared value.
+ */
+template <typename IndexNodeValueROT,typename DictT>
+class DictionaryNodeValueRO {
+public:
+  using ValueType = typename DictT::ValueType;
+  using IndexType = typename std::decay<typename IndexNodeValueROT::ValueType>::type;
+  static constexpr bool ValueIsCopy = false;
+
+  DictionaryNodeValueRO() = default;
+  DictionaryNodeValueRO(IndexNodeValueROT&& nv,DictT* dict) : nodeValue_(std::move(nv)), dict_(dict) {}
+
+  bool operator==(const DictionaryNodeValueRO& other) const {
+    auto myValuePtr = getPtrRO();
+    auto otherValuePtr = other.getPtrRO();
+    if (myValuePtr == otherValuePtr) { return true; }
+    if ((myValuePtr == nullptr) || (otherValuePtr == nullptr)) { return false; }
+    return (*myValuePtr == *otherValuePtr);
+  }
+  bool operator!=(const DictionaryNodeValueRO& other) const { return !(*this == other); }
+
+  bool atNode() const { return nodeValue_.atNode(); }
+  bool atValue() const { return nodeValue_.atValue(); }
+  const ValueType* getPtrRO() const { return (atValue() ? &(dict_->at(index())) : nullptr); }
+  bool ptrIsCopy() const { return ValueIsCopy; }
+
+  /**
+   * \brief The dictionary index actually stored in the node, only meaningful if atValue().
+   */
+  IndexType index() const { return *(nodeValue_.getPtrRO()); }
+
+protected:
+  IndexNodeValueROT nodeValue_{};
+  DictT* dict_{nullptr};
+};
+
+/**
+ * \brief Read/write version of DictionaryNodeValueRO, set() interns the value.
+ *
+ * There's no getPtrRW(): the value is shared with every other node holding the same
+ * index, set a new value instead.
+ */
+template <typename IndexNodeValueT,typename DictT>
+class DictionaryNodeValue
+  : public DictionaryNodeValueRO<IndexNodeValueT,DictT>
+{
+public:
+  using Base = DictionaryNodeValueRO<IndexNodeValueT,DictT>;
+  using ValueType = typename Base::ValueType;
+  using IndexType = typename Base::IndexType;
+
+  DictionaryNodeValue() = default;
+  DictionaryNodeValue(IndexNodeValueT&& nv,DictT* dict) : Base(std::move(nv),dict) {}
+
+  void set(const ValueType& v) { this->nodeValue_.set(static_cast<IndexType>(this->dict_->intern(v))); }
+  void set(ValueType&& v) { this->nodeValue_.set(static_cast<IndexType>(this->dict_->intern(std::move(v)))); }
+  void clear() { this->nodeValue_.clear(); }
+};
+
+/**
+ * \brief Cursor adapter presenting a tree of dictionary indices as a tree of dictionary values.
+ *
+ * Navigation is forwarded to the wrapped cursor unchanged. The read/write members
+ * (addNode(), setValue(), ...) only exist if the wrapped cursor has them; with a const
+ * DictT only the read only members can be used.
+ */
+template <typename CursorT,typename DictT>
+class DictionaryCursor {
+public:
+  using CursorType = CursorT;
+  using DictType = DictT;
+  using PathType = typename CursorType::PathType;
+  using ValueType = typename DictType::ValueType;
+  using IndexType = typename DictType::IndexType;
+  using NodeValueRO = DictionaryNodeValueRO<typename CursorType::NodeValueRO,const DictType>;
+  using NodeValue = DictionaryNodeValue<typename CursorType::NodeValue,DictType>;
+  static constexpr std::size_t Radix = CursorType::Radix;
+  static constexpr std::size_t MaxDepth = CursorType::MaxDepth;
+  static_assert(std::is_integral<typename std::decay<typename CursorType::ValueType>::type>::value,"DictionaryCursor: tree must hold integer indices");
+
+  DictionaryCursor(const CursorType& c,DictType* dict) : cursor_(c), dict_(dict) {}
+  DictionaryCursor(CursorType&& c,DictType* dict) : cursor_(std::move(c)), dict_(dict) {}
+
+  bool atNode() const { return cursor_.atNode(); }
+  bool atLeafNode() const { return cursor_.atLeafNode(); }
+  bool atValue() const { return cursor_.atValue(); }
+  bool goChild(std::size_t child) { return cursor_.goChild(child); }
+  bool canGoChild(std::size_t child) const { return cursor_.canGoChild(child); }
+  bool canGoChildNode(std::size_t child) const { return cursor_.canGoChildNode(child); }
+  bool goParent() { return cursor_.goParent(); }
+  bool canGoParent() const { return cursor_.canGoParent(); }
+  PathType getPath() const { return cursor_.getPath(); }
+
+  NodeValueRO nodeValueRO() const { return NodeValueRO(cursor_.nodeValueRO(),dict_); }
+  NodeValue nodeValue() { return NodeValue(cursor_.nodeValue(),dict_); }
+  NodeValueRO coveringNodeValueRO() const { return NodeValueRO(cursor_.coveringNodeValueRO(),dict_); }
+  std::size_t coveringNodeValueDepth() const { return cursor_.coveringNodeValueDepth(); }
+
+  NodeValue addNode() { return NodeValue(cursor_.addNode(),dict_); }
+  bool removeNode() { return cursor_.removeNode(); }
+  void setValue(const ValueType& v) { cursor_.setValue(static_cast<CursorIndexType>(dict_->intern(v))); }
+  void setValue(ValueType&& v) { cursor_.setValue(static_cast<CursorIndexType>(dict_->intern(std::move(v)))); }
+  bool clearValue() { return cursor_.clearValue(); }
+
+  const CursorType& cursor() const { return cursor_; }
+  CursorType& cursor() { return cursor_; }
+  DictType* dictionary() const { return dict_; }
+
+private:
+  using CursorIndexType = typename std::decay<typename CursorType::ValueType>::type;
+  static_assert(std::numeric_limits<CursorIndexType>::max() >= std::numeric_limits<IndexType>::max(),"DictionaryCursor: tree values can't hold every dictionary index");
+
+  CursorType cursor_;
+  DictType* dict_;
+};
+
+/**
+ * \brief Convenience function to wrap a cursor, the cursor type is deduced.
+ */
+template <typename CursorT,typename DictT>
+DictionaryCursor<typename std::decay<CursorT>::type,DictT>
+makeDictionaryCursor(CursorT&& cursor,DictT* dict) {
+  return DictionaryCursor<typename std::decay<CursorT>::type,DictT>(std::forward<CursorT>(cursor),dict);
+}
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename ValueT,typename IndexT,typename HashT>
+typename ValueDictionary<ValueT,IndexT,HashT>::IndexType
+ValueDictionary<ValueT,IndexT,HashT>::intern(const ValueType& v) {
+  IndexType index;
+  if (find(v,&index)) { return index; }
+  return add(v);
+}
+
+template <typename ValueT,typename IndexT,typename HashT>
+typename ValueDictionary<ValueT,IndexT,HashT>::IndexType
+ValueDictionary<ValueT,IndexT,HashT>::intern(ValueType&& v) {
+  IndexType index;
+  if (find(v,&index)) { return index; }
+  return add(std::move(v));
+}
+
+template <typename ValueT,typename IndexT,typename HashT>
+bool ValueDictionary<ValueT,IndexT,HashT>::find(const ValueType& v,IndexType* index) const {
+  auto it = indices_.find(std::cref(v));
+  if (it == indices_.end()) { return false; }
+  *index = it->second;
+  return true;
+}
+
+template <typename ValueT,typename IndexT,typename HashT>
+template <typename V>
+typename ValueDictionary<ValueT,IndexT,HashT>::IndexType
+ValueDictionary<ValueT,IndexT,HashT>::add(V&& v) {
+  if (values_.size() > static_cast<std::size_t>(std::numeric_limits<IndexType>::max())) {
+    throw std::length_error("ValueDictionary: index type exhausted");
+  }
+  const IndexType index = static_cast<IndexType>(values_.size());
+  values_.emplace_back(std::forward<V>(v));
+  indices_.emplace(std::cref(values_.back()),index);
+  return index;
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_WORD_ARRAY_VIEW_H_
+#define AKAMAI_MAPPER_RADIX_TREE_WORD_ARRAY_VIEW_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \brief Read only, fixed size view over WordCount contiguous words.
+ *
+ * Node implementations whose values live in an array of allocator words
+ * hand this out as their value type instead of copying the words into a
+ * std::array. The view doesn't own anything: it is only good for as long as
+ * the words it points to stay put, the same as a pointer into the allocator.
+ * An implicit conversion from std::array lets callers set values with a
+ * plain array.
+ */
+template <typename WordType,std::size_t WordCount>
+class WordArrayView {
+public:
+  using value_type = WordType;
+  using size_type = std::size_t;
+  using const_reference = const WordType&;
+  using const_iterator = const WordType*;
+  using ArrayType = std::array<WordType,WordCount>;
+
+  WordArrayView() = default;
+  explicit WordArrayView(const WordType* words) : words_(words) {}
+  WordArrayView(const ArrayType& a) : words_(a.data()) {}
+
+  static constexpr size_type size() { return WordCount; }
+  bool valid() const { return (words_ != nullptr); }
+  const WordType* data() const { return words_; }
+  const_iterator begin() const { return words_; }
+  const_iterator end() const { return (words_ + WordCount); }
+
+  const_reference operator[](size_type i) const { return words_[i]; }
+  const_reference at(size_type i) const {
+    if (i >= WordCount) { throw std::out_of_range("WordArrayView::at() - index out of range"); }
+    return words_[i];
+  }
+
+  /**
+   * \brief Copy the viewed words out, for when a value has to outlive the node.
+   */
+  inline ArrayType toArray() const;
+
+  friend bool operator==(const WordArrayView& a,const WordArrayView& b) {
+    if (a.words_ == b.words_) { return true; }
+    if ((a.words_ == nullptr) || (b.words_ == nullptr)) { return false; }
+    for (size_type i = 0; i < WordCount; ++i) {
+      if (a.words_[i] != b.words_[i]) { return false; }
+    }
+    return true;
+  }
+  friend bool operator!=(const WordArrayView& a,const WordArrayView& b) { return !(a == b); }
+
+private:
+  const WordType* words_{nullptr};
+};
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename WordType,std::size_t WordCount>
+typename WordArrayView<WordType,WordCount>::ArrayType
+WordArrayView<WordType,WordCount>::toArray() const {
+  ArrayType a;
+  for (size_type i = 0; i < WordCount; ++i) { a[i] = words_[i]; }
+  return a;
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
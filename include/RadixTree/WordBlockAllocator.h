@@ -24,9 +24,14 @@ SOFTWARE.
 */
 
 #include <stdexcept>
+#include <algorithm>
 #include <vector>
 #include <cstring>
 #include <limits>
+#include <memory>
+#include <unordered_map>
+
+#include "NodeAllocator.h"
 
 /**
  * \file WordBlockAllocator.h
@@ -37,6 +42,24 @@ namespace Akamai {
 namespace Mapper {
 namespace RadixTree {
 
+/**
+ * \brief Copy every chunk reachable from root into another allocator in pre-order.
+ *
+ * The childWordCount words starting at firstChildWord of each chunk are treated as
+ * child refs and rewritten to point at the copied chunks. Returns the new root ref.
+ */
+template <typename AllocT>
+inline typename AllocT::RefType copyChunksPreOrder(const AllocT& from,AllocT& to,typename AllocT::RefType root,
+                                                   std::size_t firstChildWord,std::size_t childWordCount);
+
+/**
+ * \brief As above, calling copied(fromRef,toRef) for each chunk so per-chunk state kept outside the chunk can follow.
+ */
+template <typename AllocT,typename CopiedFunc>
+inline typename AllocT::RefType copyChunksPreOrder(const AllocT& from,AllocT& to,typename AllocT::RefType root,
+                                                   std::size_t firstChildWord,std::size_t childWordCount,
+                                                   CopiedFunc&& copied);
+
 /**
  * \brief Simple vector-based multi-word allocator.
  *
@@ -44,6 +67,7 @@ namespace RadixTree {
  */
 template <typename WordType,std::size_t WordsPerChunk>
 class WordBlockVectorAllocator
+  : public AllocatorValueCounter
 {
 public:
   static_assert(std::is_integral<WordType>::value,"Word block must be based on an integer");
@@ -51,6 +75,8 @@ public:
 
   typedef WordType RefType;
   static constexpr RefType nullRef = 0;
+  static constexpr std::size_t ChunkWordCount = WordsPerChunk;
+  static constexpr bool CanReleaseAll = true;
 
   WordBlockVectorAllocator(WordType chunkCount = 0) {
     if (chunkCount > 0) { words_.reserve(WordsPerChunk*chunkCount); }
@@ -91,17 +117,368 @@ public:
   void clear() {
     words_.clear();
     freeChunks_.clear();
+    valueCount_ = 0;
   }
+  /**
+   * \brief Words carry no destructors, so dropping the whole tree is just a clear.
+   */
+  void releaseAll() { clear(); }
   void reserve(WordType chunkCount) { words_.reserve(WordsPerChunk*chunkCount); }
 
+  /**
+   * \brief Rewrite the chunks reachable from root contiguously in pre-order.
+   *
+   * Unreachable chunks and the free list are dropped and the vector is shrunk to fit.
+   * Returns the new root ref; all previously handed out refs and pointers are invalid.
+   */
+  inline RefType compact(RefType root,std::size_t firstChildWord,std::size_t childWordCount);
+
   const std::vector<WordType>& chunkVector() const { return words_; }
   std::size_t unusedChunkCount() const { return freeChunks_.size(); }
+  MemoryStats memoryStats() const {
+    std::size_t chunks = words_.size()/WordsPerChunk;
+    return makeStats(chunks - freeChunks_.size(),freeChunks_.size(),sizeof(WordType)*WordsPerChunk,
+                     sizeof(WordType)*(words_.capacity() + freeChunks_.capacity()));
+  }
 
 private:
   std::vector<WordType> words_;
   std::vector<WordType> freeChunks_;
 };
 
+/**
+ * \brief Paged multi-word allocator, chunks never move once allocated.
+ *
+ * Same contract as WordBlockVectorAllocator (1-based chunk refs, 0 is null, new chunks
+ * are zeroed), but chunks live in fixed size pages of 2^PageChunkBits chunks. The high
+ * bits of (ref - 1) select the page and the low bits the chunk within it, so growth only
+ * ever allocates one more page instead of copying every existing node the way a
+ * vector reallocation does.
+ */
+template <typename WordType,std::size_t WordsPerChunk>
+class WordBlockPagedAllocator
+  : public AllocatorValueCounter
+{
+public:
+  static_assert(std::is_integral<WordType>::value,"Word block must be based on an integer");
+  static_assert(!std::numeric_limits<WordType>::is_signed,"Word block integer must be unsigned");
+
+  typedef WordType RefType;
+  static constexpr RefType nullRef = 0;
+  static constexpr std::size_t ChunkWordCount = WordsPerChunk;
+  static constexpr bool CanReleaseAll = true;
+  static constexpr std::size_t PageChunkBits = 12;
+  static constexpr std::size_t PageChunkCount = (std::size_t{1} << PageChunkBits);
+  static constexpr std::size_t PageWordCount = PageChunkCount*WordsPerChunk;
+
+  WordBlockPagedAllocator(WordType chunkCount = 0) { reserve(chunkCount); }
+
+  inline RefType newRef();
+
+  void deleteRef(RefType ref) {
+    if (ref == nullRef) { return; }
+    if (static_cast<std::size_t>(ref) > chunkCount_) { throw std::out_of_range("chunk reference out of range"); }
+    freeChunks_.push_back(ref);
+  }
+  WordType* getPtr(RefType ref) const {
+    if (ref == nullRef) return nullptr;
+    std::size_t chunk = static_cast<std::size_t>(ref) - 1;
+    if (chunk >= chunkCount_) { throw std::out_of_range("chunk reference out of range"); }
+    return pages_[chunk >> PageChunkBits].get() + (chunk & (PageChunkCount - 1))*WordsPerChunk;
+  }
+
+  void clear() {
+    pages_.clear();
+    freeChunks_.clear();
+    chunkCount_ = 0;
+    valueCount_ = 0;
+  }
+  /**
+   * \brief Words carry no destructors, so dropping the whole tree is just a clear.
+   */
+  void releaseAll() { clear(); }
+
+  /**
+   * \brief Allocate pages up front for at least chunkCount chunks.
+   */
+  inline void reserve(WordType chunkCount);
+
+  /**
+   * \brief Rewrite the chunks reachable from root contiguously in pre-order.
+   *
+   * Unreachable chunks, the free list and any pages no longer needed are released.
+   * Returns the new root ref; all previously handed out refs and pointers are invalid.
+   */
+  inline RefType compact(RefType root,std::size_t firstChildWord,std::size_t childWordCount);
+
+  std::size_t pageCount() const { return pages_.size(); }
+  std::size_t chunkCount() const { return chunkCount_; }
+  std::size_t unusedChunkCount() const { return freeChunks_.size(); }
+  MemoryStats memoryStats() const {
+    return makeStats(chunkCount_ - freeChunks_.size(),freeChunks_.size(),sizeof(WordType)*WordsPerChunk,
+                     sizeof(WordType)*(pages_.size()*PageWordCount + freeChunks_.capacity()));
+  }
+
+private:
+  std::vector<std::unique_ptr<WordType[]>> pages_{};
+  std::vector<WordType> freeChunks_{};
+  std::size_t chunkCount_{0};
+};
+
+/**
+ * \brief WordBlockVectorAllocator that also keeps the spilled left child refs of ImplicitLeftBinaryWordNode.
+ *
+ * Those nodes have no word for a left child ref. A left child that isn't in the chunk after
+ * its parent gets its ref recorded here, keyed by the parent ref, until the next relayout
+ * puts it in place. The table is mutable, the same way the value count is, since nodes
+ * only hold a const allocator pointer.
+ */
+template <typename WordType,std::size_t WordsPerChunk>
+class WordBlockImplicitLeftAllocator
+  : public WordBlockVectorAllocator<WordType,WordsPerChunk>
+{
+public:
+  using Base = WordBlockVectorAllocator<WordType,WordsPerChunk>;
+  using RefType = typename Base::RefType;
+  static constexpr RefType nullRef = Base::nullRef;
+
+  WordBlockImplicitLeftAllocator(WordType chunkCount = 0) : Base(chunkCount) {}
+
+  RefType spilledLeftChild(RefType parent) const {
+    auto it = spilledLeft_.find(parent);
+    return ((it != spilledLeft_.end()) ? it->second : nullRef);
+  }
+  void setSpilledLeftChild(RefType parent,RefType child) const {
+    if (child == nullRef) { spilledLeft_.erase(parent); }
+    else { spilledLeft_[parent] = child; }
+  }
+  std::size_t spilledCount() const { return spilledLeft_.size(); }
+
+  void clear() {
+    Base::clear();
+    spilledLeft_.clear();
+  }
+  void releaseAll() { clear(); }
+
+  /**
+   * \brief Rebuild the live chunks into a fresh allocator.
+   *
+   * copyTo(fresh) copies the tree into fresh (whose refs come out in sequence from 1)
+   * and returns the new root ref. The fresh allocator then replaces this one, keeping
+   * the value count. All previously handed out refs and pointers are invalid.
+   */
+  template <typename CopyToFunc>
+  inline RefType relayout(CopyToFunc&& copyTo);
+
+  MemoryStats memoryStats() const {
+    MemoryStats ms = Base::memoryStats();
+    ms.bytesReserved += spilledLeft_.size()*(2*sizeof(RefType) + 2*sizeof(void*));
+    return ms;
+  }
+
+private:
+  mutable std::unordered_map<RefType,RefType> spilledLeft_{};
+};
+
+/**
+ * \brief WordBlockVectorAllocator with a value per chunk kept in a separate, parallel array.
+ *
+ * Topology chunks stay small and packed together, so a lookup walking down the tree only
+ * pulls node words into cache and touches a value once, at the end. Values are indexed
+ * by the same 1-based ref as the chunks and can be any default constructible type,
+ * typically a small POD struct.
+ */
+template <typename WordType,std::size_t WordsPerChunk,typename ValueT>
+class WordBlockSplitValueAllocator
+  : public WordBlockVectorAllocator<WordType,WordsPerChunk>
+{
+public:
+  using Base = WordBlockVectorAllocator<WordType,WordsPerChunk>;
+  using RefType = typename Base::RefType;
+  using ValueType = ValueT;
+  static constexpr RefType nullRef = Base::nullRef;
+
+  WordBlockSplitValueAllocator(WordType chunkCount = 0) : Base(chunkCount) { reserve(chunkCount); }
+
+  RefType newRef() {
+    RefType ref = Base::newRef();
+    if (static_cast<std::size_t>(ref) > values_.size()) { values_.resize(ref); }
+    else { values_[ref - 1] = ValueType{}; }
+    return ref;
+  }
+  void deleteRef(RefType ref) {
+    Base::deleteRef(ref);
+    if (ref != nullRef) { values_[ref - 1] = ValueType{}; }
+  }
+  /**
+   * \brief Value slot for chunk ref, mutable for the same reason getPtr() is.
+   */
+  ValueType* valuePtr(RefType ref) const {
+    if (ref == nullRef) { return nullptr; }
+    if (static_cast<std::size_t>(ref) > values_.size()) { throw std::out_of_range("value reference out of range"); }
+    return const_cast<ValueType*>(&values_[ref - 1]);
+  }
+
+  void clear() {
+    Base::clear();
+    values_.clear();
+  }
+  void releaseAll() { clear(); }
+  void reserve(WordType chunkCount) {
+    Base::reserve(chunkCount);
+    values_.reserve(chunkCount);
+  }
+
+  /**
+   * \brief Rewrite the chunks reachable from root contiguously in pre-order, values follow their chunks.
+   */
+  inline RefType compact(RefType root,std::size_t firstChildWord,std::size_t childWordCount);
+
+  const std::vector<ValueType>& valueVector() const { return values_; }
+  MemoryStats memoryStats() const {
+    std::size_t chunks = this->chunkVector().size()/WordsPerChunk;
+    return this->makeStats(chunks - this->unusedChunkCount(),this->unusedChunkCount(),
+                           sizeof(WordType)*WordsPerChunk + sizeof(ValueType),
+                           sizeof(WordType)*this->chunkVector().capacity() + sizeof(ValueType)*values_.capacity());
+  }
+
+private:
+  std::vector<ValueType> values_{};
+};
+
+/**
+ * \brief Binds a value type to WordBlockSplitValueAllocator, giving the (word type,chunk size) allocator template nodes expect.
+ */
+template <typename ValueT>
+struct WordBlockSplitValue {
+  template <typename WordType,std::size_t WordsPerChunk>
+  using Allocator = WordBlockSplitValueAllocator<WordType,WordsPerChunk,ValueT>;
+};
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename AllocT>
+typename AllocT::RefType copyChunksPreOrder(const AllocT& from,AllocT& to,typename AllocT::RefType root,
+                                            std::size_t firstChildWord,std::size_t childWordCount) {
+  using RefType = typename AllocT::RefType;
+  return copyChunksPreOrder(from,to,root,firstChildWord,childWordCount,[](RefType,RefType){});
+}
+
+template <typename AllocT,typename CopiedFunc>
+typename AllocT::RefType copyChunksPreOrder(const AllocT& from,AllocT& to,typename AllocT::RefType root,
+                                            std::size_t firstChildWord,std::size_t childWordCount,
+                                            CopiedFunc&& copied) {
+  using RefType = typename AllocT::RefType;
+  struct PendingChunk {
+    RefType fromRef;
+    RefType toParentRef;
+    std::size_t parentWord;
+  };
+
+  if (root == AllocT::nullRef) { return AllocT::nullRef; }
+  RefType newRoot = AllocT::nullRef;
+  std::vector<PendingChunk> pending{{root,AllocT::nullRef,0}};
+  while (!pending.empty()) {
+    PendingChunk cur = pending.back();
+    pending.pop_back();
+    RefType toRef = to.newRef();
+    const auto* src = from.getPtr(cur.fromRef);
+    auto* dst = to.getPtr(toRef);
+    std::copy(src,src + AllocT::ChunkWordCount,dst);
+    copied(cur.fromRef,toRef);
+    if (cur.toParentRef == AllocT::nullRef) { newRoot = toRef; }
+    else { to.getPtr(cur.toParentRef)[cur.parentWord] = toRef; }
+    // Push in reverse so the first child is copied next
+    for (std::size_t i = childWordCount; i > 0; --i) {
+      std::size_t childWord = firstChildWord + i - 1;
+      if (src[childWord] != AllocT::nullRef) { pending.push_back({src[childWord],toRef,childWord}); }
+    }
+  }
+  return newRoot;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+typename WordBlockVectorAllocator<WordType,WordsPerChunk>::RefType
+WordBlockVectorAllocator<WordType,WordsPerChunk>::compact(RefType root,std::size_t firstChildWord,std::size_t childWordCount) {
+  if ((firstChildWord + childWordCount) > WordsPerChunk) { throw std::out_of_range("compact: child words out of chunk range"); }
+  std::size_t liveChunks = (words_.size()/WordsPerChunk) - std::min(freeChunks_.size(),words_.size()/WordsPerChunk);
+  WordBlockVectorAllocator<WordType,WordsPerChunk> compacted(static_cast<WordType>(liveChunks));
+  RefType newRoot = copyChunksPreOrder(*this,compacted,root,firstChildWord,childWordCount);
+  compacted.words_.shrink_to_fit();
+  compacted.valueCount_ = valueCount_;
+  *this = std::move(compacted);
+  return newRoot;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+typename WordBlockPagedAllocator<WordType,WordsPerChunk>::RefType
+WordBlockPagedAllocator<WordType,WordsPerChunk>::newRef() {
+  if (freeChunks_.size() > 0) {
+    RefType newChunk = freeChunks_.back();
+    freeChunks_.pop_back();
+    memset(getPtr(newChunk),0,sizeof(WordType)*WordsPerChunk);
+    return newChunk;
+  }
+
+  if (chunkCount_ >= static_cast<std::size_t>(std::numeric_limits<WordType>::max())) {
+    throw std::length_error("WordBlockPagedAllocator: chunk references exhausted");
+  }
+  // Pages are value initialized so fresh chunks are already zero
+  if (chunkCount_ == (pages_.size() << PageChunkBits)) {
+    pages_.emplace_back(new WordType[PageWordCount]());
+  }
+  ++chunkCount_;
+  return static_cast<RefType>(chunkCount_);
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+typename WordBlockPagedAllocator<WordType,WordsPerChunk>::RefType
+WordBlockPagedAllocator<WordType,WordsPerChunk>::compact(RefType root,std::size_t firstChildWord,std::size_t childWordCount) {
+  if ((firstChildWord + childWordCount) > WordsPerChunk) { throw std::out_of_range("compact: child words out of chunk range"); }
+  WordBlockPagedAllocator<WordType,WordsPerChunk> compacted;
+  RefType newRoot = copyChunksPreOrder(*this,compacted,root,firstChildWord,childWordCount);
+  compacted.valueCount_ = valueCount_;
+  *this = std::move(compacted);
+  return newRoot;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+void WordBlockPagedAllocator<WordType,WordsPerChunk>::reserve(WordType chunkCount) {
+  std::size_t pagesNeeded = (static_cast<std::size_t>(chunkCount) + PageChunkCount - 1) >> PageChunkBits;
+  while (pages_.size() < pagesNeeded) {
+    pages_.emplace_back(new WordType[PageWordCount]());
+  }
+}
+
+template <typename WordType,std::size_t WordsPerChunk,typename ValueT>
+typename WordBlockSplitValueAllocator<WordType,WordsPerChunk,ValueT>::RefType
+WordBlockSplitValueAllocator<WordType,WordsPerChunk,ValueT>::compact(RefType root,std::size_t firstChildWord,std::size_t childWordCount) {
+  if ((firstChildWord + childWordCount) > WordsPerChunk) { throw std::out_of_range("compact: child words out of chunk range"); }
+  std::size_t chunks = this->chunkVector().size()/WordsPerChunk;
+  WordBlockSplitValueAllocator<WordType,WordsPerChunk,ValueT> compacted(static_cast<WordType>(chunks - std::min(this->unusedChunkCount(),chunks)));
+  RefType newRoot = copyChunksPreOrder(*this,compacted,root,firstChildWord,childWordCount,
+                                       [this,&compacted](RefType fromRef,RefType toRef) {
+                                         *compacted.valuePtr(toRef) = *valuePtr(fromRef);
+                                       });
+  compacted.valueCount_ = this->valueCount_;
+  *this = std::move(compacted);
+  return newRoot;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+template <typename CopyToFunc>
+typename WordBlockImplicitLeftAllocator<WordType,WordsPerChunk>::RefType
+WordBlockImplicitLeftAllocator<WordType,WordsPerChunk>::relayout(CopyToFunc&& copyTo) {
+  std::size_t chunks = this->chunkVector().size()/WordsPerChunk;
+  WordBlockImplicitLeftAllocator<WordType,WordsPerChunk> fresh(static_cast<WordType>(chunks - std::min(this->unusedChunkCount(),chunks)));
+  RefType newRoot = copyTo(fresh);
+  fresh.valueCount_ = this->valueCount_;
+  fresh.spilledLeft_.clear();
+  *this = std::move(fresh);
+  return newRoot;
+}
 
 }
 }
@@ -0,0 +1,380 @@
+#ifndef AKAMAI_MAPPER_RADIX_TREE_WORD_BLOCK_MMAP_ALLOCATOR_H_
+#define AKAMAI_MAPPER_RADIX_TREE_WORD_BLOCK_MMAP_ALLOCATOR_H_
+
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdexcept>
+#include <system_error>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+#include <stdint.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "BinaryPath.h"
+#include "BinaryWordNode.h"
+#include "RadixTree.h"
+#include "SimpleStack.h"
+
+/**
+ * \file WordBlockMmapAllocator.h
+ * File backed multi-word allocator for binary word type nodes (POSIX mmap).
+ */
+
+namespace Akamai {
+namespace Mapper {
+namespace RadixTree {
+
+/**
+ * \brief Multi-word allocator whose chunks live in a memory mapped file.
+ *
+ * Same contract as WordBlockVectorAllocator (1-based chunk refs, 0 is null, new chunks
+ * are zeroed), but the chunks, the free list and the tree root ref are all kept in a
+ * shared mapping of a file. A tree built on this allocator can be reopened by another
+ * process simply by mapping the file again, and keeps being updated in place.
+ *
+ * File layout: a fixed size header (magic, format version, word size, words per chunk,
+ * chunk counts, free list head, root ref) followed by the chunks. Freed chunks are linked
+ * through their first word so the free list survives a reopen. The file grows by doubling;
+ * as with the vector allocator, pointers from getPtr() are invalidated by growth.
+ *
+ * Changes reach the file through the page cache; call sync() for durability.
+ */
+template <typename WordType,std::size_t WordsPerChunk>
+class WordBlockMmapAllocator
+{
+public:
+  static_assert(std::is_integral<WordType>::value,"Word block must be based on an integer");
+  static_assert(!std::numeric_limits<WordType>::is_signed,"Word block integer must be unsigned");
+
+  typedef WordType RefType;
+  static constexpr RefType nullRef = 0;
+  static constexpr std::size_t ChunkWordCount = WordsPerChunk;
+  static constexpr bool CanReleaseAll = true;
+  static constexpr bool PersistentRoot = true;
+  static constexpr uint64_t Magic = 0x4b4c425752544b41ULL; // "AKTRWBLK"
+  static constexpr uint32_t FormatVersion = 1;
+  static constexpr std::size_t MinChunkCapacity = 1024;
+
+  /**
+   * \brief Map an existing tree file, or create a new empty one.
+   *
+   * Throws std::system_error if the file can't be opened/mapped and std::runtime_error
+   * if an existing file wasn't written by an allocator with the same word layout.
+   */
+  inline explicit WordBlockMmapAllocator(const std::string& path,WordType chunkCount = 0);
+
+  WordBlockMmapAllocator(const WordBlockMmapAllocator& o) = delete;
+  WordBlockMmapAllocator& operator=(const WordBlockMmapAllocator& o) = delete;
+  inline WordBlockMmapAllocator(WordBlockMmapAllocator&& o) noexcept;
+  inline WordBlockMmapAllocator& operator=(WordBlockMmapAllocator&& o) noexcept;
+  inline ~WordBlockMmapAllocator();
+
+  inline RefType newRef();
+  inline void deleteRef(RefType ref);
+  WordType* getPtr(RefType ref) const {
+    if (ref == nullRef) return nullptr;
+    if (static_cast<uint64_t>(ref) > header()->chunkCount) { throw std::out_of_range("chunk reference out of range"); }
+    return chunks() + (static_cast<std::size_t>(ref) - 1)*WordsPerChunk;
+  }
+
+  /**
+   * \brief Forget every chunk (and the root), keeping the file's capacity.
+   */
+  inline void clear();
+  /**
+   * \brief Words carry no destructors, so dropping the whole tree is just a clear.
+   */
+  void releaseAll() { clear(); }
+  /**
+   * \brief Grow the file so at least chunkCount chunks fit without remapping.
+   */
+  inline void reserve(WordType chunkCount);
+
+  /**
+   * \brief Root ref recorded in the file header, nullRef for a new file.
+   */
+  RefType rootRef() const { return static_cast<RefType>(header()->rootRef); }
+  void setRootRef(RefType ref) { header()->rootRef = ref; }
+
+  /**
+   * \brief Flush the mapping to the file; synchronous unless async is set.
+   */
+  inline void sync(bool async = false) const;
+
+  std::size_t chunkCount() const { return static_cast<std::size_t>(header()->chunkCount); }
+  std::size_t chunkCapacity() const { return static_cast<std::size_t>(header()->chunkCapacity); }
+  std::size_t unusedChunkCount() const { return static_cast<std::size_t>(header()->freeCount); }
+  inline MemoryStats memoryStats() const;
+
+  /**
+   * \brief Value count kept in the file header so it survives a reopen.
+   */
+  void noteValueSet() const { ++header()->valueCount; }
+  void noteValueCleared() const { --header()->valueCount; }
+  std::size_t valueCount() const { return static_cast<std::size_t>(header()->valueCount); }
+  const std::string& path() const { return path_; }
+
+private:
+  struct FileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t wordBytes;
+    uint64_t wordsPerChunk;
+    uint64_t chunkCount;
+    uint64_t chunkCapacity;
+    uint64_t freeHead;
+    uint64_t freeCount;
+    uint64_t rootRef;
+    uint64_t valueCount;
+  };
+  // Keep the chunks cache line aligned
+  static constexpr std::size_t HeaderBytes = ((sizeof(FileHeader) + 63)/64)*64;
+  static constexpr std::size_t ChunkBytes = sizeof(WordType)*WordsPerChunk;
+
+  FileHeader* header() const { return static_cast<FileHeader*>(map_); }
+  WordType* chunks() const { return reinterpret_cast<WordType*>(static_cast<uint8_t*>(map_) + HeaderBytes); }
+
+  inline void mapFile(std::size_t bytes);
+  inline void unmap();
+  inline void grow(std::size_t chunkCapacity);
+
+  std::string path_{};
+  int fd_{-1};
+  void* map_{nullptr};
+  std::size_t mapBytes_{0};
+};
+
+/**
+ * \brief BinaryWordTree stored in a memory mapped file, construct with the file path.
+ */
+template <typename WordType,std::size_t MaxDepth>
+using MmapBinaryWordTree = RadixTree<BinaryPath<MaxDepth>,BinaryWordNode<WordType,WordBlockMmapAllocator>,SimpleFixedDepthStack>;
+
+/**
+ * \brief CompactBinaryWordTree stored in a memory mapped file, construct with the file path.
+ */
+template <typename ValueT,typename WordType,std::size_t MaxDepth>
+using MmapCompactBinaryWordTree = RadixTree<BinaryPath<MaxDepth>,CompactBinaryWordNode<ValueT,WordType,WordBlockMmapAllocator>,SimpleFixedDepthStack>;
+
+/////////////////////
+// IMPLEMENTATIONS //
+/////////////////////
+
+template <typename WordType,std::size_t WordsPerChunk>
+WordBlockMmapAllocator<WordType,WordsPerChunk>::WordBlockMmapAllocator(const std::string& path,WordType chunkCount)
+  : path_(path)
+{
+  fd_ = ::open(path.c_str(),O_RDWR | O_CREAT,0644);
+  if (fd_ < 0) { throw std::system_error(errno,std::generic_category(),"WordBlockMmapAllocator: open " + path); }
+
+  try {
+    struct stat st;
+    if (::fstat(fd_,&st) != 0) { throw std::system_error(errno,std::generic_category(),"WordBlockMmapAllocator: stat " + path); }
+    std::size_t fileBytes = static_cast<std::size_t>(st.st_size);
+    if (fileBytes == 0) {
+      // New file - lay down an empty header
+      std::size_t capacity = std::max<std::size_t>(MinChunkCapacity,chunkCount);
+      fileBytes = HeaderBytes + capacity*ChunkBytes;
+      if (::ftruncate(fd_,static_cast<off_t>(fileBytes)) != 0) {
+        throw std::system_error(errno,std::generic_category(),"WordBlockMmapAllocator: resize " + path);
+      }
+      mapFile(fileBytes);
+      FileHeader* h = header();
+      h->magic = Magic;
+      h->version = FormatVersion;
+      h->wordBytes = sizeof(WordType);
+      h->wordsPerChunk = WordsPerChunk;
+      h->chunkCount = 0;
+      h->chunkCapacity = capacity;
+      h->freeHead = nullRef;
+      h->freeCount = 0;
+      h->rootRef = nullRef;
+      h->valueCount = 0;
+    } else {
+      if (fileBytes < HeaderBytes) { throw std::runtime_error("WordBlockMmapAllocator: file too small for header: " + path); }
+      mapFile(fileBytes);
+      const FileHeader* h = header();
+      if (h->magic != Magic) { throw std::runtime_error("WordBlockMmapAllocator: bad magic: " + path); }
+      if (h->version != FormatVersion) { throw std::runtime_error("WordBlockMmapAllocator: unsupported format version: " + path); }
+      if ((h->wordBytes != sizeof(WordType)) || (h->wordsPerChunk != WordsPerChunk)) {
+        throw std::runtime_error("WordBlockMmapAllocator: word layout mismatch: " + path);
+      }
+      if ((h->chunkCount > h->chunkCapacity) || ((HeaderBytes + h->chunkCapacity*ChunkBytes) > fileBytes)) {
+        throw std::runtime_error("WordBlockMmapAllocator: truncated file: " + path);
+      }
+      reserve(chunkCount);
+    }
+  } catch (...) {
+    unmap();
+    ::close(fd_);
+    fd_ = -1;
+    throw;
+  }
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+WordBlockMmapAllocator<WordType,WordsPerChunk>::WordBlockMmapAllocator(WordBlockMmapAllocator<WordType,WordsPerChunk>&& o) noexcept
+  : path_(std::move(o.path_))
+  , fd_(o.fd_)
+  , map_(o.map_)
+  , mapBytes_(o.mapBytes_)
+{
+  o.fd_ = -1;
+  o.map_ = nullptr;
+  o.mapBytes_ = 0;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+WordBlockMmapAllocator<WordType,WordsPerChunk>&
+WordBlockMmapAllocator<WordType,WordsPerChunk>::operator=(WordBlockMmapAllocator<WordType,WordsPerChunk>&& o) noexcept {
+  if (this == &o) { return *this; }
+  unmap();
+  if (fd_ >= 0) { ::close(fd_); }
+  path_ = std::move(o.path_);
+  fd_ = o.fd_;
+  map_ = o.map_;
+  mapBytes_ = o.mapBytes_;
+  o.fd_ = -1;
+  o.map_ = nullptr;
+  o.mapBytes_ = 0;
+  return *this;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+WordBlockMmapAllocator<WordType,WordsPerChunk>::~WordBlockMmapAllocator() {
+  unmap();
+  if (fd_ >= 0) { ::close(fd_); }
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+void WordBlockMmapAllocator<WordType,WordsPerChunk>::mapFile(std::size_t bytes) {
+  void* m = ::mmap(nullptr,bytes,PROT_READ | PROT_WRITE,MAP_SHARED,fd_,0);
+  if (m == MAP_FAILED) { throw std::system_error(errno,std::generic_category(),"WordBlockMmapAllocator: mmap " + path_); }
+  map_ = m;
+  mapBytes_ = bytes;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+void WordBlockMmapAllocator<WordType,WordsPerChunk>::unmap() {
+  if (map_ != nullptr) { ::munmap(map_,mapBytes_); }
+  map_ = nullptr;
+  mapBytes_ = 0;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+void WordBlockMmapAllocator<WordType,WordsPerChunk>::grow(std::size_t chunkCapacity) {
+  std::size_t newBytes = HeaderBytes + chunkCapacity*ChunkBytes;
+  // Extending the file zero fills the new chunks
+  if (::ftruncate(fd_,static_cast<off_t>(newBytes)) != 0) {
+    throw std::system_error(errno,std::generic_category(),"WordBlockMmapAllocator: resize " + path_);
+  }
+  unmap();
+  mapFile(newBytes);
+  header()->chunkCapacity = chunkCapacity;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+typename WordBlockMmapAllocator<WordType,WordsPerChunk>::RefType
+WordBlockMmapAllocator<WordType,WordsPerChunk>::newRef() {
+  FileHeader* h = header();
+  if (h->freeHead != nullRef) {
+    RefType newChunk = static_cast<RefType>(h->freeHead);
+    WordType* p = getPtr(newChunk);
+    h->freeHead = p[0];
+    --h->freeCount;
+    memset(p,0,ChunkBytes);
+    return newChunk;
+  }
+
+  if (h->chunkCount >= static_cast<uint64_t>(std::numeric_limits<WordType>::max())) {
+    throw std::length_error("WordBlockMmapAllocator: chunk references exhausted");
+  }
+  if (h->chunkCount == h->chunkCapacity) {
+    grow(2*static_cast<std::size_t>(h->chunkCapacity));
+    h = header();
+  }
+  ++h->chunkCount;
+  RefType newChunk = static_cast<RefType>(h->chunkCount);
+  // Chunks past the old high water mark might have been used before a clear()
+  memset(getPtr(newChunk),0,ChunkBytes);
+  return newChunk;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+void WordBlockMmapAllocator<WordType,WordsPerChunk>::deleteRef(RefType ref) {
+  if (ref == nullRef) { return; }
+  WordType* p = getPtr(ref);
+  FileHeader* h = header();
+  p[0] = static_cast<WordType>(h->freeHead);
+  h->freeHead = ref;
+  ++h->freeCount;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+void WordBlockMmapAllocator<WordType,WordsPerChunk>::clear() {
+  FileHeader* h = header();
+  h->chunkCount = 0;
+  h->freeHead = nullRef;
+  h->freeCount = 0;
+  h->rootRef = nullRef;
+  h->valueCount = 0;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+MemoryStats WordBlockMmapAllocator<WordType,WordsPerChunk>::memoryStats() const {
+  const FileHeader* h = header();
+  MemoryStats ms;
+  ms.nodeCount = static_cast<std::size_t>(h->chunkCount - h->freeCount);
+  ms.valueNodeCount = static_cast<std::size_t>(h->valueCount);
+  ms.scaffoldNodeCount = (ms.nodeCount > ms.valueNodeCount) ? (ms.nodeCount - ms.valueNodeCount) : 0;
+  ms.freeNodeCount = static_cast<std::size_t>(h->freeCount);
+  ms.nodeBytes = ChunkBytes;
+  ms.bytesInUse = ms.nodeCount*ChunkBytes;
+  ms.bytesReserved = mapBytes_;
+  return ms;
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+void WordBlockMmapAllocator<WordType,WordsPerChunk>::reserve(WordType chunkCount) {
+  if (static_cast<uint64_t>(chunkCount) > header()->chunkCapacity) { grow(chunkCount); }
+}
+
+template <typename WordType,std::size_t WordsPerChunk>
+void WordBlockMmapAllocator<WordType,WordsPerChunk>::sync(bool async) const {
+  if (map_ == nullptr) { return; }
+  if (::msync(map_,mapBytes_,async ? MS_ASYNC : MS_SYNC) != 0) {
+    throw std::system_error(errno,std::generic_category(),"WordBlockMmapAllocator: msync " + path_);
+  }
+}
+
+} // namespace RadixTree
+} // namespace Mapper
+} // namespace Akamai
+
+#endif
@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "RandomUtils.h"
+#include "BinaryTestPath.h"
+#include "TreeTestUtils.h"
+#include "PathSort.h"
+#include "TreeTests.h"
+
+#include "../RadixTree/BinaryPath.h"
+#include "../RadixTree/BinaryStrideTree.h"
+#include "../RadixTree/BinaryRadixTree.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+template <std::size_t MaxDepth,std::size_t StrideBits>
+using StrideTree = BinaryStrideTree<BinaryPath<MaxDepth>,uint64_t,StrideBits>;
+
+using PathValue12 = TestPathValue<BinaryTestPath<12,uint16_t>,uint64_t>;
+using PathValue16 = TestPathValue<BinaryTestPath<16,uint16_t>,uint64_t>;
+
+TEST(BinaryStrideTree4, FillTest) {
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  auto newTree = [](){ return StrideTree<12,4>{}; };
+  std::string result = fillEntireTree<PathValue12,StrideTree<12,4>>(rn,4,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(BinaryStrideTree4, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.1};
+  auto newTree = [](){ return StrideTree<16,4>{}; };
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<PathValue16,StrideTree<16,4>>(rnShuffle,4,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+// Stride that doesn't divide the path length, and the widest stride
+// (multi-word bitmaps).
+TEST(BinaryStrideTree5, FillTest) {
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  auto newTree = [](){ return StrideTree<12,5>{}; };
+  std::string result = fillEntireTree<PathValue12,StrideTree<12,5>>(rn,4,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(BinaryStrideTree8, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.75,0.25};
+  auto newTree = [](){ return StrideTree<12,8>{}; };
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<PathValue12,StrideTree<12,8>>(rnShuffle,4,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+// Covering value lookups have to agree with the regular edge based tree.
+TEST(BinaryStrideTree, CoveringMatchesRadixTree) {
+  using Path = BinaryPath<32>;
+  RandomNumbers<uint64_t> rn(RandomSeeds::seed(1));
+  StrideTree<32,6> strideTree{};
+  BinaryRadixTree32<uint64_t,32> radixTree{};
+  auto randomPath = [&rn](std::size_t length) {
+    Path p{};
+    uint64_t bits = rn.next();
+    for (std::size_t i = 0; i < length; ++i) { p.push_back((bits >> i) & 0x1); }
+    return p;
+  };
+  for (uint64_t i = 0; i < 500; ++i) {
+    Path p = randomPath(rn.next() % 33);
+    auto strideCursor = strideTree.lookupCursorWO();
+    cursorGoto(strideCursor,p);
+    strideCursor.addNode().set(i);
+    auto radixCursor = radixTree.lookupCursorWO();
+    cursorGoto(radixCursor,p);
+    radixCursor.addNode().set(i);
+  }
+  for (std::size_t i = 0; i < 2000; ++i) {
+    Path p = randomPath(32);
+    auto strideCursor = strideTree.lookupCursorRO();
+    auto radixCursor = radixTree.lookupCursorRO();
+    cursorGoto(strideCursor,p);
+    cursorGoto(radixCursor,p);
+    ASSERT_EQ(strideCursor.coveringNodeValueDepth(),radixCursor.coveringNodeValueDepth());
+    auto strideValue = strideCursor.coveringNodeValueRO();
+    auto radixValue = radixCursor.coveringNodeValueRO();
+    ASSERT_EQ(strideValue.atValue(),radixValue.atValue());
+    if (strideValue.atValue()) { ASSERT_EQ(*strideValue.getPtrRO(),*radixValue.getPtrRO()); }
+  }
+}
+
+// Removing values prunes the binary positions and the stride nodes
+// below them, leaving an empty root behind.
+TEST(BinaryStrideTree, RemoveValues) {
+  using Path = BinaryPath<16>;
+  StrideTree<16,4> tree{};
+  std::vector<Path> paths{{1,0,1,1,0,0,1,0,1},{1,0,1},{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},{}};
+  uint64_t v{0};
+  auto w = tree.cursor();
+  for (const Path& p : paths) {
+    cursorGoto(w,p);
+    w.addNode().set(v++);
+  }
+  auto c = tree.cursorRO();
+  cursorGoto(c,Path{1,0,1,1,0});
+  ASSERT_TRUE(c.atNode());
+  ASSERT_FALSE(c.atValue());
+  ASSERT_EQ(c.coveringNodeValueDepth(),3);
+  ASSERT_EQ(*c.coveringNodeValueRO().getPtrRO(),1);
+
+  for (const Path& p : paths) {
+    cursorGoto(w,p);
+    ASSERT_TRUE(w.clearValue());
+    while (w.removeNode() && w.canGoParent()) { w.goParent(); }
+  }
+  auto r = tree.cursorRO();
+  ASSERT_FALSE(r.atValue());
+  ASSERT_FALSE(r.canGoChildNode(0));
+  ASSERT_FALSE(r.canGoChildNode(1));
+}
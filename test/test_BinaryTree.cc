@@ -724,6 +724,102 @@ TEST(BinaryTree, FillSomeOfTest) {
   }
 }
 
+// Inline leaves: after compact() small leaves live in their parent's child
+// slot, everything should still read and write as a regular tree.
+using InlineLeafTree16 = InlineLeafBinaryRadixTree32<uint64_t,16>;
+using InlineLeafPath12 = TestPathValue<BinaryTestPath<12,uint16_t>,uint64_t>;
+
+TEST(InlineLeafBinaryTree, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  auto newTree = [](){ return InlineLeafTree16{}; };
+  std::vector<float> fillRatios{0.5,0.1};
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<BinaryPath16,InlineLeafTree16>(rnShuffle,3,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+TEST(InlineLeafBinaryTree, Compact) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<InlineLeafPath12> keep = spotListFillSomeOfTree<InlineLeafPath12>(rnChoose,0.3,10);
+  TreeSpotList<InlineLeafPath12> churn = spotListFillLayer<InlineLeafPath12>(12);
+  keep.shuffle(rnShuffle);
+
+  InlineLeafBinaryRadixTree32<uint64_t,12> t;
+  keep.addToTree(t.cursor());
+  std::size_t nodeCount = t.memoryStats().nodeCount;
+  std::size_t valueCount = t.memoryStats().valueNodeCount;
+  t.compact();
+  ASSERT_LT(t.memoryStats().nodeCount,nodeCount);
+  ASSERT_EQ(t.memoryStats().valueNodeCount,valueCount);
+  ASSERT_EQ(checkTreeWithAllCursors(keep,&t),"OK");
+
+  // Writes below and at packed leaves unpack them again
+  churn.addToTree(t.cursor());
+  ASSERT_EQ(checkTreeWithAllCursors(churn,&t),"OK");
+  ASSERT_EQ(checkTreeWithAllCursors(keep,&t),"OK");
+  t.compact();
+  auto c = t.cursor();
+  for (const InlineLeafPath12& spot : churn.treeSpots()) {
+    spot.setCursor(c);
+    ASSERT_TRUE(c.clearValue());
+    ASSERT_TRUE(c.removeNode());
+  }
+  ASSERT_EQ(checkTreeWithAllCursors(keep,&t),"OK");
+}
+
+TEST(InlineLeafBinaryTree, LargeValues) {
+  using Path = BinaryPath<16>;
+  InlineLeafTree16 t;
+  const uint64_t big = 0xfedcba9876543210;
+  std::vector<Path> paths{{1,0,1,1,0,0,1,0,1},{0,1},{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}};
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    auto c = t.cursor();
+    cursorGoto(c,paths[i]);
+    c.addNode().set(i);
+  }
+  std::size_t nodeCount = t.memoryStats().nodeCount;
+  t.compact();
+  ASSERT_LT(t.memoryStats().nodeCount,nodeCount);
+  // too big to stay packed
+  {
+    auto c = t.cursor();
+    cursorGoto(c,paths[0]);
+    ASSERT_TRUE(c.atValue());
+    c.nodeValue().set(big);
+  }
+  {
+    auto c = t.lookupCursorRO();
+    cursorGoto(c,paths[0],false);
+    ASSERT_EQ(*c.coveringNodeValueRO().getPtrRO(),big);
+  }
+  // still fits, stays packed
+  std::size_t nodesBefore = t.memoryStats().nodeCount;
+  {
+    auto c = t.cursor();
+    cursorGoto(c,paths[1]);
+    c.nodeValue().set(0xffffffffffff);
+    ASSERT_EQ(*c.nodeValueRO().getPtrRO(),0xffffffffffffu);
+  }
+  ASSERT_EQ(t.memoryStats().nodeCount,nodesBefore);
+  // split a packed leaf's edge from a lookup cursor
+  {
+    auto c = t.lookupCursorWO();
+    cursorGoto(c,Path{0,0,0,0},false);
+    c.addNode().set(7);
+  }
+  auto c = t.cursorRO();
+  cursorGoto(c,paths[2]);
+  ASSERT_TRUE(c.atValue());
+  ASSERT_EQ(*c.nodeValueRO().getPtrRO(),2u);
+  cursorGoto(c,Path{0,0,0,0});
+  ASSERT_EQ(*c.nodeValueRO().getPtrRO(),7u);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
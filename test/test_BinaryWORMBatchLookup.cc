@@ -0,0 +1,136 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "CursorIterator.h"
+#include "BinaryWORMBatchLookup.h"
+#include "BinaryWORMTree.h"
+#include "BinaryWORMTreeBuilder.h"
+#include "BinaryWORMTreeUInt.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path16 = TestPath<2,16>;
+using PathVal16 = TestPathValue<Path16,uint32_t>;
+
+template <typename NodeWOT>
+std::vector<uint8_t> buildWORM(TreeSpotList<PathVal16>& tsl) {
+  BinaryRadixTree32<uint32_t,16> tree{};
+  tsl.addToTree(tree.cursor());
+  BinaryWORMTreeBuilderVector<BinaryPath<16>,NodeWOT> builder;
+  builder.start();
+  auto treeIter = make_preorder_iterator<false,true>(tree.cursorRO());
+  while (!treeIter.finished()) {
+    bool atValue = treeIter->atValue();
+    builder.addNode(treeIter->getPath(),atValue,atValue ? treeIter->nodeValueRO().getPtrRO() : nullptr,
+                    {treeIter->canGoChildNode(0),treeIter->canGoChildNode(1)});
+    treeIter++;
+  }
+  builder.finish();
+  return builder.extractBuffer();
+}
+
+// Random paths, mostly full length, some ending part way down
+std::vector<Path16> randomPaths(RandomNumbers<uint64_t>& rn,std::size_t count) {
+  std::vector<Path16> paths;
+  for (std::size_t i = 0; i < count; ++i) {
+    uint64_t bits = rn.next();
+    std::size_t length = (((bits >> 32) % 4) == 0) ? ((bits >> 40) % 17) : 16;
+    Path16 p{};
+    for (std::size_t b = 0; b < length; ++b) { p.push_back((bits >> b) & 0x1); }
+    paths.push_back(p);
+  }
+  return paths;
+}
+
+// Batch results have to agree with one lookup cursor per path
+template <std::size_t BatchWidth,typename TreeT>
+std::string checkBatch(const TreeT& tree,const std::vector<Path16>& paths) {
+  using ValueType = typename TreeT::LookupCursorROType::ValueType;
+  std::vector<BinaryWORMLookupResult<ValueType>> results(paths.size());
+  tree.template lookupBatch<BatchWidth>(paths.data(),paths.size(),results.data());
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    auto c = tree.lookupCursorRO();
+    cursorGoto(c,paths[i]);
+    auto v = c.coveringNodeValueRO();
+    const BinaryWORMLookupResult<ValueType>& r = results[i];
+    if (r.found != (v.getPtrRO() != nullptr)) { return "found mismatch at " + std::to_string(i); }
+    if (r.found && (r.value != *v.getPtrRO())) { return "value mismatch at " + std::to_string(i); }
+    if (r.depth != c.coveringNodeValueDepth()) { return "depth mismatch at " + std::to_string(i); }
+  }
+  return "OK";
+}
+
+TEST(BinaryWORMBatchLookup, FillSomeOf) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntRO<true,4,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  RandomNumbers<uint64_t> rnPaths(seeds.next());
+  std::vector<float> fillRatios{0.5,0.05,0.001};
+  for (float fillRatio : fillRatios) {
+    TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,fillRatio);
+    BinaryWORMTreeVector<Path16,NodeRO> tree{buildWORM<NodeWO>(tsl)};
+    std::vector<Path16> paths = randomPaths(rnPaths,5000);
+    ASSERT_EQ(checkBatch<1>(tree,paths),"OK");
+    ASSERT_EQ(checkBatch<8>(tree,paths),"OK");
+    ASSERT_EQ(checkBatch<16>(tree,std::vector<Path16>(paths.begin(),paths.begin() + 13)),"OK");
+    ASSERT_EQ(checkBatch<16>(tree,std::vector<Path16>{}),"OK");
+  }
+}
+
+TEST(BinaryWORMBatchLookup, LongEdge) {
+  using NodeWO = BinaryWORMNodeUIntLongEdgeWO<false,3,4>;
+  using NodeRO = BinaryWORMNodeUIntLongEdgeRO<false,3,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  RandomNumbers<uint64_t> rnPaths(seeds.next());
+  TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.01);
+  BinaryWORMTreeVector<Path16,NodeRO> tree{buildWORM<NodeWO>(tsl)};
+  ASSERT_EQ(checkBatch<8>(tree,randomPaths(rnPaths,5000)),"OK");
+}
+
+TEST(BinaryWORMBatchLookup, JumpTree) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntRO<true,4,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  RandomNumbers<uint64_t> rnPaths(seeds.next());
+  TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.05);
+  std::vector<uint8_t> plain = buildWORM<NodeWO>(tsl);
+  std::vector<Path16> paths = randomPaths(rnPaths,5000);
+  for (std::size_t jumpBits : {1,6,16}) {
+    BinaryWORMJumpTree<std::vector<uint8_t>,Path16,NodeRO> tree{
+      addBinaryWORMJumpTable<Path16,NodeRO>(plain.data(),plain.size(),jumpBits,std::vector<uint8_t>{})};
+    ASSERT_EQ(checkBatch<8>(tree,paths),"OK");
+  }
+}
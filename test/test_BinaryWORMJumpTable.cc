@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "CursorIterator.h"
+#include "BinaryWORMTree.h"
+#include "BinaryWORMTreeBuilder.h"
+#include "BinaryWORMTreeUInt.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path16 = TestPath<2,16>;
+using PathVal16 = TestPathValue<Path16,uint32_t>;
+
+template <typename NodeWOT>
+std::vector<uint8_t> buildWORM(TreeSpotList<PathVal16>& tsl) {
+  BinaryRadixTree32<uint32_t,16> tree{};
+  tsl.addToTree(tree.cursor());
+  BinaryWORMTreeBuilderVector<BinaryPath<16>,NodeWOT> builder;
+  builder.start();
+  auto treeIter = make_preorder_iterator<false,true>(tree.cursorRO());
+  while (!treeIter.finished()) {
+    bool atValue = treeIter->atValue();
+    builder.addNode(treeIter->getPath(),atValue,atValue ? treeIter->nodeValueRO().getPtrRO() : nullptr,
+                    {treeIter->canGoChildNode(0),treeIter->canGoChildNode(1)});
+    treeIter++;
+  }
+  builder.finish();
+  return builder.extractBuffer();
+}
+
+/*
+ * Add a jump table to plain, then check the tree and that every lookup
+ * agrees with the same lookup on the plain tree.
+ */
+template <typename NodeROT>
+std::string checkJumpTree(TreeSpotList<PathVal16>& tsl,const std::vector<uint8_t>& plain,std::size_t jumpBits) {
+  BinaryWORMTreeVector<Path16,NodeROT> plainTree{plain};
+  BinaryWORMJumpTree<std::vector<uint8_t>,Path16,NodeROT> jumpTree{
+    addBinaryWORMJumpTable<Path16,NodeROT>(plain.data(),plain.size(),jumpBits,std::vector<uint8_t>{})};
+  if (jumpTree.jumpTable().jumpBits() != jumpBits) { return "wrong jump bits"; }
+  if (jumpTree.buffer().size() != BinaryWORMJumpTable::sectionSize(jumpBits) + plain.size()) { return "wrong buffer size"; }
+
+  std::string r = tsl.checkTree(jumpTree.cursorRO());
+  if (r != "OK") { return "[Check cursorRO] " + r; }
+  r = tsl.checkTreeNewCursor([&jumpTree](){ return jumpTree.lookupCursorRO(); });
+  if (r != "OK") { return "[Check lookupCursorRO] " + r; }
+
+  for (uint32_t bits = 0; bits < (0x1 << 16); bits += 3) {
+    auto j = jumpTree.lookupCursorRO();
+    auto p = plainTree.lookupCursorRO();
+    // stop now and then to look around part way through the jump
+    std::size_t stopAt = (bits % 17);
+    for (std::size_t i = 0; i < 16; ++i) {
+      std::size_t step = ((bits >> (15 - i)) & 0x1);
+      j.goChild(step);
+      p.goChild(step);
+      if ((i + 1 == stopAt) || (i == 15)) {
+        if ((j.atNode() != p.atNode()) || (j.canGoChildNode(0) != p.canGoChildNode(0)) || (j.canGoChildNode(1) != p.canGoChildNode(1))) {
+          return "node mismatch for " + std::to_string(bits) + " at depth " + std::to_string(i + 1);
+        }
+        if ((j.coveringNodeValueDepth() != p.coveringNodeValueDepth()) || (j.coveringNodeValueRO() != p.coveringNodeValueRO())) {
+          return "covering value mismatch for " + std::to_string(bits) + " at depth " + std::to_string(i + 1);
+        }
+      }
+    }
+  }
+  return "OK";
+}
+
+TEST(BinaryWORMJumpTable, FillSomeOf) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntRO<true,4,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.05,0.001};
+  for (float fillRatio : fillRatios) {
+    TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,fillRatio);
+    std::vector<uint8_t> plain = buildWORM<NodeWO>(tsl);
+    for (std::size_t jumpBits : {0,1,5,8,16}) {
+      ASSERT_EQ(checkJumpTree<NodeRO>(tsl,plain,jumpBits),"OK");
+    }
+  }
+}
+
+TEST(BinaryWORMJumpTable, LongEdge) {
+  using NodeWO = BinaryWORMNodeUIntLongEdgeWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntLongEdgeRO<true,4,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.01);
+  std::vector<uint8_t> plain = buildWORM<NodeWO>(tsl);
+  for (std::size_t jumpBits : {3,12}) {
+    ASSERT_EQ(checkJumpTree<NodeRO>(tsl,plain,jumpBits),"OK");
+  }
+}
+
+TEST(BinaryWORMJumpTable, Section) {
+  ASSERT_EQ(chooseBinaryWORMJumpBits(100,32),0u);
+  ASSERT_EQ(chooseBinaryWORMJumpBits(4*BinaryWORMJumpTable::EntrySize*256,32),8u);
+  ASSERT_EQ(chooseBinaryWORMJumpBits(std::size_t{1} << 40,32),16u);
+  ASSERT_EQ(chooseBinaryWORMJumpBits(std::size_t{1} << 40,12),12u);
+
+  using NodeRO = BinaryWORMNodeUIntRO<true,4,4>;
+  std::vector<uint8_t> notATable(64,0);
+  using JumpTree = BinaryWORMJumpTree<std::vector<uint8_t>,Path16,NodeRO>;
+  ASSERT_THROW(JumpTree{notATable},std::runtime_error);
+  ASSERT_THROW((addBinaryWORMJumpTable<Path16,NodeRO>(notATable.data(),notATable.size(),17,std::vector<uint8_t>{})),std::invalid_argument);
+
+  std::vector<uint8_t> truncated(BinaryWORMJumpTable::HeaderSize);
+  BinaryWORMJumpTable::writeHeader(truncated.data(),4);
+  ASSERT_THROW(JumpTree{truncated},std::runtime_error);
+}
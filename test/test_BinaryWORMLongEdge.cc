@@ -0,0 +1,170 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "BinaryWORMTree.h"
+#include "BinaryWORMTreeBuilder.h"
+#include "BinaryWORMTreeUInt.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+template <std::size_t DEPTH>
+using BinaryTestPath = TestPath<2,DEPTH>;
+
+template <std::size_t DEPTH>
+using PathVal = TestPathValue<BinaryTestPath<DEPTH>,uint32_t>;
+
+template <template <std::size_t,bool> class HeaderBytesT>
+using WORMNodeWO = BinaryWORMNodeWO<4,false,BinaryWORMReadWriteUInt<4,false>,HeaderBytesT>;
+
+template <template <std::size_t,bool> class HeaderBytesT>
+using WORMNodeRO = BinaryWORMNodeRO<4,false,BinaryWORMReadWriteUInt<4,false>,HeaderBytesT>;
+
+/*
+ * Traverses cursor in pre-order; callback executed when cursor is at a node.
+ */
+template <typename PathType,typename CursorType,typename CallbackType>
+void preOrderWalkNodes(PathType& p,CursorType& c,CallbackType&& cb) {
+  if (c.atNode()) { cb(p,c); }
+  for (std::size_t child = 0; child < 2; ++child) {
+    if (c.canGoChildNode(child)) {
+      p.push_back(child);
+      c.goChild(child);
+      preOrderWalkNodes(p,c,cb);
+      c.goParent();
+      p.pop_back();
+    }
+  }
+}
+
+/*
+ * Build a WORM tree with the given header from the spot list, check it, report its size.
+ */
+template <template <std::size_t,bool> class HeaderBytesT,std::size_t DEPTH>
+std::string buildAndCheckWORM(TreeSpotList<PathVal<DEPTH>>& tsl,std::size_t* bufferSize,std::size_t* chainNodes = nullptr) {
+  BinaryRadixTree32<uint32_t,DEPTH> tree{};
+  tsl.addToTree(tree.cursor());
+  BinaryWORMTreeBuilderVector<BinaryTestPath<DEPTH>,WORMNodeWO<HeaderBytesT>> wormBuilder;
+  auto srcCursor = tree.cursorRO();
+  auto buildWORMCB =
+    [&wormBuilder](const BinaryTestPath<DEPTH>& p,const decltype(srcCursor)& c) {
+      bool hasLeftChild = c.canGoChildNode(0);
+      bool hasRightChild = c.canGoChildNode(1);
+      if (c.atValue() || (hasLeftChild && hasRightChild)) {
+        wormBuilder.addNode(p,c.atValue(),c.nodeValueRO().getPtrRO(),{hasLeftChild,hasRightChild});
+      }
+    };
+  BinaryTestPath<DEPTH> p{};
+  if (!wormBuilder.start()) { return "Unable to start building tree"; };
+  preOrderWalkNodes(p,srcCursor,buildWORMCB);
+  if (!wormBuilder.finish()) { return "Unable to finish building tree"; }
+  *bufferSize = wormBuilder.sizeofBuffer();
+  if (chainNodes != nullptr) { *chainNodes = wormBuilder.treeStats().allNodeStats.headersSingleChild.count; }
+
+  BinaryWORMTreeVector<BinaryTestPath<DEPTH>,WORMNodeRO<HeaderBytesT>> wormTree(wormBuilder.extractBuffer());
+  std::string r{};
+  r = tsl.checkTree(wormTree.cursorRO());
+  if (r != "OK") { return "[Check cursorRO] " + r; }
+  r = tsl.checkTree(wormTree.cursorRO(),true);
+  if (r != "OK") { return "[Check cursorRO from root] " + r; }
+  r = tsl.checkTreeNewCursor([&wormTree](){return wormTree.lookupCursorRO();});
+  if (r != "OK") { return "[Check lookupCursorRO] " +  r; }
+  return "OK";
+}
+
+TEST(BinaryWORMLongEdge, HeaderBytes) {
+  using HB = BinaryWORMNodeHeaderLongEdgeBytes<3,false>;
+  uint8_t b[HB::MaxHeaderSize]{};
+  HB::clear(b);
+  HB::setHasChild(b,0,true);
+  HB::setHasChild(b,1,true);
+  HB::setRightChildOffset(b,0x123456);
+  // grow the edge one step at a time, the offset has to follow the edge bytes
+  for (std::size_t i = 0; i < HB::MaxEdgeSteps; ++i) {
+    HB::setEdgeStepCount(b,i + 1);
+    HB::setEdgeStepAt(b,i,(i % 3) == 0);
+    ASSERT_EQ(HB::getRightChildOffset(b),0x123456u);
+  }
+  ASSERT_EQ(HB::edgeStepCount(b),HB::MaxEdgeSteps);
+  ASSERT_EQ(HB::headerSize(b),HB::MaxHeaderSize);
+  for (std::size_t i = 0; i < HB::MaxEdgeSteps; ++i) { ASSERT_EQ(HB::edgeStepAt(b,i),((i % 3) == 0) ? 1u : 0u); }
+  HB::EdgeWordType w = HB::getEdgeBitsAsWord(b);
+  for (std::size_t i = 0; i < HB::MaxEdgeSteps; ++i) { ASSERT_EQ((w >> (31 - i)) & 0x1,((i % 3) == 0) ? 1u : 0u); }
+  ASSERT_EQ(w & 0x1,0u);
+
+  uint8_t c[HB::MaxHeaderSize]{};
+  HB::clear(c);
+  HB::setHasValue(c,true);
+  HB::copyEdge(c,b);
+  ASSERT_TRUE(HB::hasValue(c));
+  ASSERT_EQ(HB::getEdgeBitsAsWord(c),w);
+  ASSERT_EQ(HB::headerSize(c),1 + HB::MaxEdgeBytes);
+
+  // shrinking the edge pulls the offset back in
+  HB::setEdgeStepCount(b,3);
+  ASSERT_EQ(HB::getRightChildOffset(b),0x123456u);
+  ASSERT_EQ(HB::headerSize(b),1 + 1 + 3u);
+}
+
+TEST(BinaryWORMLongEdge, FillSomeOf) {
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.1,0.01};
+  for (float fillRatio : fillRatios) {
+    TreeSpotList<PathVal<14>> tsl = spotListFillSomeOfTree<PathVal<14>>(rnChoose,fillRatio);
+    std::size_t size{0};
+    ASSERT_EQ((buildAndCheckWORM<BinaryWORMNodeHeaderLongEdgeBytes,14>(tsl,&size)),"OK");
+  }
+}
+
+// Long runs without branches are where the long edge header pays off: the basic
+// header needs a single child node every 4 steps, the long edge header every 32.
+TEST(BinaryWORMLongEdge, SparseDeepPaths) {
+  RandomNumbers<uint64_t> rn(RandomSeeds::seed(2));
+  std::vector<PathVal<128>> spots{};
+  for (uint32_t i = 0; i < 200; ++i) {
+    std::vector<std::size_t> steps{};
+    uint64_t bits = rn.next();
+    std::size_t len = 32 + (rn.next() % 97);
+    for (std::size_t s = 0; s < len; ++s) { steps.push_back((bits >> (s % 64)) & 0x1); }
+    spots.emplace_back(steps,i);
+  }
+  TreeSpotList<PathVal<128>> tsl(spots);
+  std::size_t longEdgeSize{0};
+  std::size_t longEdgeChain{0};
+  std::size_t basicSize{0};
+  std::size_t basicChain{0};
+  ASSERT_EQ((buildAndCheckWORM<BinaryWORMNodeHeaderLongEdgeBytes,128>(tsl,&longEdgeSize,&longEdgeChain)),"OK");
+  ASSERT_EQ((buildAndCheckWORM<BinaryWORMNodeHeaderBytes,128>(tsl,&basicSize,&basicChain)),"OK");
+  ASSERT_LT(4*longEdgeChain,basicChain);
+  ASSERT_LT(longEdgeSize,basicSize);
+}
@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "CursorIterator.h"
+#include "BinaryWORMTree.h"
+#include "BinaryWORMTreeBuilder.h"
+#include "BinaryWORMTreeParallelBuilder.h"
+#include "BinaryWORMTreeUInt.h"
+#include "BinaryWORMTreeUIntBuilder.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path16 = TestPath<2,16>;
+using PathVal16 = TestPathValue<Path16,uint32_t>;
+using SourceTree = BinaryRadixTree32<uint32_t,16>;
+
+template <typename NodeWOT>
+std::vector<uint8_t> buildSequential(const SourceTree& tree) {
+  BinaryWORMTreeBuilderVector<BinaryPath<16>,NodeWOT> builder;
+  builder.start();
+  auto treeIter = make_preorder_iterator<false,true>(tree.cursorRO());
+  while (!treeIter.finished()) {
+    bool atValue = treeIter->atValue();
+    builder.addNode(treeIter->getPath(),atValue,atValue ? treeIter->nodeValueRO().getPtrRO() : nullptr,
+                    {treeIter->canGoChildNode(0),treeIter->canGoChildNode(1)});
+    treeIter++;
+  }
+  builder.finish();
+  return builder.extractBuffer();
+}
+
+/*
+ * Build tsl in parallel with each split depth and thread count, check the
+ * stitched tree holds what tsl holds and its stats agree with the buffer.
+ */
+template <typename NodeWOT,typename NodeROT>
+std::string checkParallelBuild(TreeSpotList<PathVal16>& tsl) {
+  SourceTree tree{};
+  tsl.addToTree(tree.cursor());
+  const std::size_t sequentialSize = buildSequential<NodeWOT>(tree).size();
+  for (std::size_t splitBits : {0,1,4,9,16}) {
+    for (std::size_t threadCount : {1,4}) {
+      std::string testID = "[split " + std::to_string(splitBits) + " threads " + std::to_string(threadCount) + "] ";
+      BinaryWORMTreeParallelBuilderVector<BinaryPath<16>,NodeWOT> builder{splitBits,threadCount};
+      builder.build(tree.cursorRO(),true);
+      const std::size_t dryRunSize = builder.sizeofBuffer();
+      const auto dryRunStats = builder.treeStats();
+      builder.build(tree.cursorRO());
+      if (builder.treeStats() != dryRunStats) { return testID + "dry run stats differ"; }
+      std::vector<uint8_t> buffer = builder.extractBuffer();
+      if ((buffer.size() != dryRunSize) || (buffer.size() < sequentialSize)) { return testID + "unexpected size"; }
+      if ((splitBits == 0) && (buffer.size() != sequentialSize)) { return testID + "single job differs from sequential build"; }
+
+      BinaryWORMTreeVector<Path16,NodeROT> wormTree{std::move(buffer)};
+      std::string r = tsl.checkTree(wormTree.cursorRO());
+      if (r != "OK") { return testID + "[Check cursorRO] " + r; }
+      r = tsl.checkTreeNewCursor([&wormTree](){ return wormTree.lookupCursorRO(); });
+      if (r != "OK") { return testID + "[Check lookupCursorRO] " + r; }
+    }
+  }
+  return "OK";
+}
+
+TEST(BinaryWORMParallelBuilder, FillSomeOf) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntRO<true,4,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.05,0.001};
+  for (float fillRatio : fillRatios) {
+    TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,fillRatio);
+    ASSERT_EQ((checkParallelBuild<NodeWO,NodeRO>(tsl)),"OK");
+  }
+}
+
+TEST(BinaryWORMParallelBuilder, LongEdge) {
+  using NodeWO = BinaryWORMNodeUIntLongEdgeWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntLongEdgeRO<true,4,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.01);
+  ASSERT_EQ((checkParallelBuild<NodeWO,NodeRO>(tsl)),"OK");
+}
+
+TEST(BinaryWORMParallelBuilder, Empty) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntRO<true,4,4>;
+  TreeSpotList<PathVal16> tsl{};
+  ASSERT_EQ((checkParallelBuild<NodeWO,NodeRO>(tsl)),"OK");
+}
+
+TEST(BinaryWORMParallelBuilder, UIntGeneric) {
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.05);
+  SourceTree tree{};
+  tsl.addToTree(tree.cursor());
+  BinaryWORMTreeUIntParams sequentialParams = findMinimumWORMTreeUIntParameters(tree.cursorRO());
+  BinaryWORMTreeUIntParams params = findMinimumWORMTreeUIntParameters(tree.cursorRO(),6,3);
+  ASSERT_EQ(params.valueSize,sequentialParams.valueSize);
+  ASSERT_GE(params.offsetSize,sequentialParams.offsetSize);
+  BinaryWORMTreeUIntGeneric<BinaryPath<16>> wormTree = buildWORMTreeUIntGeneric(params,tree.cursorRO(),6,3);
+  ASSERT_EQ(tsl.checkTree(wormTree.cursorRO()),"OK");
+  ASSERT_EQ(tsl.checkTreeNewCursor([&wormTree](){ return wormTree.lookupCursorRO(); }),"OK");
+}
+
+TEST(BinaryWORMParallelBuilder, Errors) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using Builder = BinaryWORMTreeParallelBuilderVector<BinaryPath<16>,NodeWO>;
+  ASSERT_THROW(Builder(17),std::invalid_argument);
+
+  // Values too large for the WORM value size fail in whichever worker meets them.
+  SourceTree tree{};
+  auto c = tree.cursor();
+  c.goChild(1);
+  c.goChild(0);
+  c.goChild(1);
+  c.addNode().set(0x10000);
+  ASSERT_THROW((buildBinaryWORMTreeUIntBuffer<true,4,2>(tree.cursorRO(),std::vector<uint8_t>{},2,2)),std::runtime_error);
+}
@@ -0,0 +1,134 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "CursorIterator.h"
+#include "BinaryWORMTree.h"
+#include "BinaryWORMTreeBuilder.h"
+#include "BinaryWORMTreeUInt.h"
+#include "BinaryWORMTreeUIntBuilder.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path16 = TestPath<2,16>;
+using PathVal16 = TestPathValue<Path16,uint32_t>;
+using SourceTree = BinaryRadixTree32<uint32_t,16>;
+
+template <typename NodeWOT>
+std::vector<uint8_t> buildFromTree(const SourceTree& tree) {
+  BinaryWORMTreeBuilderVector<BinaryPath<16>,NodeWOT> builder;
+  builder.start();
+  auto treeIter = make_preorder_iterator<false,true>(tree.cursorRO());
+  while (!treeIter.finished()) {
+    bool atValue = treeIter->atValue();
+    typename NodeWOT::ValueType value{};
+    if (atValue) { value = *(treeIter->nodeValueRO().getPtrRO()); }
+    builder.addNode(treeIter->getPath(),atValue,atValue ? &value : nullptr,
+                    {treeIter->canGoChildNode(0),treeIter->canGoChildNode(1)});
+    treeIter++;
+  }
+  builder.finish();
+  return builder.extractBuffer();
+}
+
+/*
+ * The single pass build has to hold the same values, and be the same bytes
+ * as the two pass build whenever it lands on the same parameters.
+ */
+std::string checkSinglePass(TreeSpotList<PathVal16>& tsl,bool isLittleEndian) {
+  SourceTree tree{};
+  tsl.addToTree(tree.cursor());
+  BinaryWORMTreeUIntParams params = findMinimumWORMTreeUIntParameters(tree.cursorRO());
+  params.isLittleEndian = isLittleEndian;
+  BinaryWORMTreeUIntGeneric<BinaryPath<16>> twoPass = buildWORMTreeUIntGeneric(params,tree.cursorRO());
+  BinaryWORMTreeUIntGeneric<BinaryPath<16>> onePass = buildWORMTreeUIntGenericSinglePass(tree.cursorRO(),isLittleEndian);
+
+  const BinaryWORMTreeUIntParams& onePassParams = onePass.treeParams();
+  if ((onePassParams.isLittleEndian != isLittleEndian) || (onePassParams.valueSize != params.valueSize)) { return "wrong parameters"; }
+  if (onePassParams.offsetSize < params.offsetSize) { return "offset size too small"; }
+  if (onePassParams.offsetSize == params.offsetSize) {
+    std::vector<uint8_t> expected(twoPass.bytes(),twoPass.bytes() + twoPass.bytesSize());
+    std::vector<uint8_t> actual(onePass.bytes(),onePass.bytes() + onePass.bytesSize());
+    if (actual != expected) { return "tree bytes differ"; }
+  }
+  std::string r = tsl.checkTree(onePass.cursorRO());
+  if (r != "OK") { return "[Check cursorRO] " + r; }
+  r = tsl.checkTreeNewCursor([&onePass](){ return onePass.lookupCursorRO(); });
+  if (r != "OK") { return "[Check lookupCursorRO] " + r; }
+  return "OK";
+}
+
+TEST(BinaryWORMSinglePass, FillSomeOf) {
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.05,0.001};
+  for (float fillRatio : fillRatios) {
+    TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,fillRatio);
+    ASSERT_EQ(checkSinglePass(tsl,true),"OK");
+    ASSERT_EQ(checkSinglePass(tsl,false),"OK");
+  }
+}
+
+TEST(BinaryWORMSinglePass, Empty) {
+  TreeSpotList<PathVal16> tsl{};
+  ASSERT_EQ(checkSinglePass(tsl,true),"OK");
+}
+
+TEST(BinaryWORMSinglePass, RepackLongEdge) {
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.01);
+  SourceTree tree{};
+  tsl.addToTree(tree.cursor());
+  std::vector<uint8_t> wide = buildFromTree<BinaryWORMNodeUIntLongEdgeWO<false,8,8>>(tree);
+  std::vector<uint8_t> expected = buildFromTree<BinaryWORMNodeUIntLongEdgeWO<false,3,4>>(tree);
+  wide.resize(repackBinaryWORMTreeUInt<false,BinaryWORMNodeHeaderLongEdgeBytes>(wide.data(),wide.size(),3,4));
+  ASSERT_EQ(wide,expected);
+}
+
+TEST(BinaryWORMSinglePass, RepackErrors) {
+  SourceTree tree{};
+  auto c = tree.cursor();
+  c.goChild(0);
+  c.addNode().set(0x100);
+  c.goChild(1);
+  c.addNode().set(1);
+  std::vector<uint8_t> wide = buildFromTree<BinaryWORMNodeUIntWO<true,8,8>>(tree);
+  std::vector<uint8_t> copy{wide};
+  ASSERT_THROW(repackBinaryWORMTreeUInt<true>(copy.data(),copy.size(),0,2),std::invalid_argument);
+  ASSERT_THROW(repackBinaryWORMTreeUInt<true>(copy.data(),copy.size(),1,9),std::invalid_argument);
+  ASSERT_THROW(repackBinaryWORMTreeUInt<true>(copy.data(),copy.size(),1,1),std::runtime_error);
+  copy = wide;
+  ASSERT_THROW(repackBinaryWORMTreeUInt<true>(copy.data(),copy.size() - 1,1,2),std::runtime_error);
+  copy = wide;
+  ASSERT_EQ(repackBinaryWORMTreeUInt<true>(copy.data(),copy.size(),1,2),wide.size() - 2*6);
+}
@@ -0,0 +1,170 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "CursorIterator.h"
+#include "BinaryWORMTree.h"
+#include "BinaryWORMTreeBuilder.h"
+#include "BinaryWORMTreeStreamBuilder.h"
+#include "BinaryWORMTreeUInt.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path16 = TestPath<2,16>;
+using PathVal16 = TestPathValue<Path16,uint32_t>;
+using SourceTree = BinaryRadixTree32<uint32_t,16>;
+using SortedPairs = std::vector<std::pair<BinaryPath<16>,uint32_t>>;
+
+template <typename NodeWOT>
+std::vector<uint8_t> buildFromTree(const SourceTree& tree) {
+  BinaryWORMTreeBuilderVector<BinaryPath<16>,NodeWOT> builder;
+  builder.start();
+  auto treeIter = make_preorder_iterator<false,true>(tree.cursorRO());
+  while (!treeIter.finished()) {
+    bool atValue = treeIter->atValue();
+    builder.addNode(treeIter->getPath(),atValue,atValue ? treeIter->nodeValueRO().getPtrRO() : nullptr,
+                    {treeIter->canGoChildNode(0),treeIter->canGoChildNode(1)});
+    treeIter++;
+  }
+  builder.finish();
+  return builder.extractBuffer();
+}
+
+SortedPairs sortedPairs(const SourceTree& tree) {
+  SortedPairs pairs{};
+  for (auto treeIter = make_preorder_iterator(tree.cursorRO()); !treeIter.finished(); treeIter++) {
+    pairs.emplace_back(treeIter->getPath(),*(treeIter->nodeValueRO().getPtrRO()));
+  }
+  return pairs;
+}
+
+/*
+ * The streamed tree has to match the tree walking build byte for byte.
+ */
+template <typename NodeWOT,typename NodeROT>
+std::string checkStreamBuild(TreeSpotList<PathVal16>& tsl) {
+  SourceTree tree{};
+  tsl.addToTree(tree.cursor());
+  SortedPairs pairs = sortedPairs(tree);
+  std::vector<uint8_t> expected = buildFromTree<NodeWOT>(tree);
+
+  BinaryWORMTreeStreamBuilderVector<BinaryPath<16>,NodeWOT> dryRun{};
+  dryRun.start(true);
+  for (const auto& p : pairs) { dryRun.add(p.first,p.second); }
+  if (!dryRun.finish()) { return "dry run didn't finish"; }
+  if (dryRun.sizeofBuffer() != expected.size()) { return "dry run size differs"; }
+  if (dryRun.pendingCount() != 0) { return "nodes left pending"; }
+
+  std::vector<uint8_t> streamed =
+    buildBinaryWORMTreeFromSorted<NodeWOT,BinaryPath<16>>(pairs.begin(),pairs.end(),std::vector<uint8_t>{});
+  if (streamed != expected) { return "streamed tree differs"; }
+
+  BinaryWORMTreeVector<Path16,NodeROT> wormTree{std::move(streamed)};
+  std::string r = tsl.checkTree(wormTree.cursorRO());
+  if (r != "OK") { return "[Check cursorRO] " + r; }
+  r = tsl.checkTreeNewCursor([&wormTree](){ return wormTree.lookupCursorRO(); });
+  if (r != "OK") { return "[Check lookupCursorRO] " + r; }
+  return "OK";
+}
+
+TEST(BinaryWORMStreamBuilder, FillSomeOf) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntRO<true,4,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.05,0.001};
+  for (float fillRatio : fillRatios) {
+    TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,fillRatio);
+    ASSERT_EQ((checkStreamBuild<NodeWO,NodeRO>(tsl)),"OK");
+  }
+}
+
+TEST(BinaryWORMStreamBuilder, LongEdge) {
+  using NodeWO = BinaryWORMNodeUIntLongEdgeWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntLongEdgeRO<true,4,4>;
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.01);
+  ASSERT_EQ((checkStreamBuild<NodeWO,NodeRO>(tsl)),"OK");
+}
+
+TEST(BinaryWORMStreamBuilder, Empty) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using NodeRO = BinaryWORMNodeUIntRO<true,4,4>;
+  TreeSpotList<PathVal16> tsl{};
+  ASSERT_EQ((checkStreamBuild<NodeWO,NodeRO>(tsl)),"OK");
+}
+
+// Only the 0 subtree being read is held back, a 1 step settles everything before it.
+TEST(BinaryWORMStreamBuilder, Lookahead) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  BinaryWORMTreeStreamBuilderVector<BinaryPath<16>,NodeWO> builder{};
+  builder.start();
+  builder.add(BinaryPath<16>{},1);
+  builder.add(BinaryPath<16>{1},2);
+  ASSERT_EQ(builder.pendingCount(),1u);
+  for (uint32_t i = 0; i < 10; ++i) {
+    BinaryPath<16> p{1};
+    for (uint32_t j = 0; j <= i; ++j) { p.push_back(1); }
+    builder.add(p,i);
+    ASSERT_EQ(builder.pendingCount(),1u);
+  }
+  // 1^11 can't be written until we know if it has a 1 child.
+  builder.add(BinaryPath<16>{1,1,1,1,1,1,1,1,1,1,1,0},20);
+  builder.add(BinaryPath<16>{1,1,1,1,1,1,1,1,1,1,1,0,1},21);
+  ASSERT_EQ(builder.pendingCount(),3u);
+  builder.add(BinaryPath<16>{1,1,1,1,1,1,1,1,1,1,1,1},22);
+  ASSERT_EQ(builder.pendingCount(),1u);
+  ASSERT_TRUE(builder.finish());
+  ASSERT_EQ(builder.pendingCount(),0u);
+  ASSERT_EQ(builder.maxPendingCount(),3u);
+}
+
+TEST(BinaryWORMStreamBuilder, OutOfOrder) {
+  using NodeWO = BinaryWORMNodeUIntWO<true,4,4>;
+  using Builder = BinaryWORMTreeStreamBuilderVector<BinaryPath<16>,NodeWO>;
+  std::vector<SortedPairs> badInputs{
+    {{BinaryPath<16>{1},1},{BinaryPath<16>{0},2}},
+    {{BinaryPath<16>{0,1},1},{BinaryPath<16>{0},2}},
+    {{BinaryPath<16>{0,1},1},{BinaryPath<16>{0,1},2}},
+    {{BinaryPath<16>{0,1},1},{BinaryPath<16>{},2}},
+  };
+  for (const SortedPairs& pairs : badInputs) {
+    Builder builder{};
+    builder.start();
+    builder.add(pairs.at(0).first,pairs.at(0).second);
+    ASSERT_THROW(builder.add(pairs.at(1).first,pairs.at(1).second),std::runtime_error);
+  }
+  Builder notStarted{};
+  ASSERT_THROW(notStarted.add(BinaryPath<16>{1},1),std::runtime_error);
+}
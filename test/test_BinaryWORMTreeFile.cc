@@ -0,0 +1,164 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "BinaryWORMTreeFile.h"
+#include "BinaryWORMTreeUInt.h"
+#include "BinaryWORMTreeUIntBuilder.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path16 = TestPath<2,16>;
+using PathVal16 = TestPathValue<Path16,uint32_t>;
+using SourceTree = BinaryRadixTree32<uint32_t,16>;
+
+// Scratch file removed when the test finishes
+class TempTreeFile {
+public:
+  TempTreeFile() {
+    char name[] = "/tmp/akamai-radixtree-worm-XXXXXX";
+    int fd = mkstemp(name);
+    if (fd >= 0) { close(fd); }
+    path_ = name;
+  }
+  ~TempTreeFile() { unlink(path_.c_str()); }
+  const std::string& path() const { return path_; }
+private:
+  std::string path_;
+};
+
+std::vector<uint8_t> readFile(const std::string& path) {
+  std::ifstream in(path,std::ios::binary);
+  return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path,const std::vector<uint8_t>& bytes) {
+  std::ofstream out(path,std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(bytes.data()),bytes.size());
+}
+
+BinaryWORMTreeUIntGeneric<BinaryPath<16>> buildTree(TreeSpotList<PathVal16>& tsl,bool isLittleEndian) {
+  SourceTree tree{};
+  tsl.addToTree(tree.cursor());
+  BinaryWORMTreeUIntParams params = findMinimumWORMTreeUIntParameters(tree.cursorRO());
+  params.isLittleEndian = isLittleEndian;
+  return buildWORMTreeUIntGeneric(params,tree.cursorRO());
+}
+
+TEST(BinaryWORMTreeFile, RoundTrip) {
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<MmapBufferOptions> options(3);
+  options[1].populate = true;
+  options[2].warmUp = true;
+  options[2].randomAccess = true;
+  for (bool isLittleEndian : {true,false}) {
+    TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.05);
+    BinaryWORMTreeUIntGeneric<BinaryPath<16>> built = buildTree(tsl,isLittleEndian);
+    TempTreeFile f;
+    writeBinaryWORMTreeUIntFile(f.path(),built);
+    ASSERT_EQ(readFile(f.path()).size(),BinaryWORMFileHeader::Size + built.bytesSize());
+    for (const MmapBufferOptions& o : options) {
+      BinaryWORMTreeUIntGeneric<BinaryPath<16>> opened = openBinaryWORMTreeUIntFile<BinaryPath<16>>(f.path(),o,true);
+      ASSERT_EQ(opened.treeParams().isLittleEndian,built.treeParams().isLittleEndian);
+      ASSERT_EQ(opened.treeParams().offsetSize,built.treeParams().offsetSize);
+      ASSERT_EQ(opened.treeParams().valueSize,built.treeParams().valueSize);
+      ASSERT_EQ(opened.bytesSize(),built.bytesSize());
+      ASSERT_EQ(std::memcmp(opened.bytes(),built.bytes(),built.bytesSize()),0);
+      ASSERT_EQ(tsl.checkTree(opened.cursorRO()),"OK");
+      ASSERT_EQ(tsl.checkTreeNewCursor([&opened](){ return opened.lookupCursorRO(); }),"OK");
+    }
+  }
+}
+
+TEST(BinaryWORMTreeFile, MmapBuffer) {
+  TempTreeFile f;
+  std::vector<uint8_t> bytes(10000);
+  for (std::size_t i = 0; i < bytes.size(); ++i) { bytes[i] = static_cast<uint8_t>(i*7); }
+  writeFile(f.path(),bytes);
+  MmapBufferOptions o{};
+  o.warmUp = true;
+  MmapBufferRO b{f.path(),o};
+  ASSERT_EQ(b.size(),bytes.size());
+  b.setView(100,50);
+  MmapBufferRO moved{std::move(b)};
+  ASSERT_EQ(b.data(),nullptr);
+  ASSERT_EQ(moved.size(),50);
+  ASSERT_EQ(std::memcmp(moved.data(),bytes.data() + 100,50),0);
+  ASSERT_THROW(moved.setView(9000,1001),std::out_of_range);
+  moved.waitForWarmUp();
+  ASSERT_TRUE(moved.warmedUp());
+  ASSERT_EQ(moved.mapSize(),bytes.size());
+}
+
+TEST(BinaryWORMTreeFile, Errors) {
+  using Path = BinaryPath<16>;
+  TempTreeFile f;
+  ASSERT_THROW(openBinaryWORMTreeUIntFile<Path>(f.path() + ".missing"),std::system_error);
+  ASSERT_THROW(openBinaryWORMTreeUIntFile<Path>(f.path()),std::system_error);
+
+  TreeSpotList<PathVal16> tsl = spotListFillLayer<PathVal16>(8);
+  writeBinaryWORMTreeUIntFile(f.path(),buildTree(tsl,true));
+  const std::vector<uint8_t> good = readFile(f.path());
+
+  std::vector<uint8_t> bad{good};
+  bad[0] ^= 0x1;
+  writeFile(f.path(),bad);
+  ASSERT_THROW(openBinaryWORMTreeUIntFile<Path>(f.path()),std::runtime_error);
+
+  bad = good;
+  bad[8] = BinaryWORMFileHeader::Version + 1;
+  writeFile(f.path(),bad);
+  ASSERT_THROW(openBinaryWORMTreeUIntFile<Path>(f.path()),std::runtime_error);
+
+  bad = good;
+  bad.resize(bad.size() - 1);
+  writeFile(f.path(),bad);
+  ASSERT_THROW(openBinaryWORMTreeUIntFile<Path>(f.path()),std::runtime_error);
+
+  bad = good;
+  bad[18] = 3;
+  writeFile(f.path(),bad);
+  ASSERT_THROW(openBinaryWORMTreeUIntFile<Path>(f.path()),std::runtime_error);
+
+  // A damaged tree is only caught when asked to verify
+  bad = good;
+  bad.back() ^= 0x1;
+  writeFile(f.path(),bad);
+  ASSERT_NO_THROW(openBinaryWORMTreeUIntFile<Path>(f.path()));
+  ASSERT_THROW(openBinaryWORMTreeUIntFile<Path>(f.path(),MmapBufferOptions{},true),std::runtime_error);
+}
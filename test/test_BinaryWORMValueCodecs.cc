@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "BinaryWORMTree.h"
+#include "BinaryWORMValueCodecs.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path16 = TestPath<2,16>;
+using PathVal16 = TestPathValue<Path16,uint32_t>;
+
+template <typename TreeT>
+std::string checkStrings(const TreeT& tree,const std::vector<std::pair<Path16,std::string>>& expected) {
+  for (const auto& pv : expected) {
+    auto c = tree.lookupCursorRO();
+    cursorGoto(c,pv.first);
+    if (!c.atValue()) { return "missing value"; }
+    if (*(c.nodeValueRO().getPtrRO()) != pv.second) { return "value mismatch: " + *(c.nodeValueRO().getPtrRO()); }
+  }
+  return "OK";
+}
+
+// Random paths with values drawn from a handful of strings, so most repeat
+std::vector<std::pair<Path16,std::string>> randomStrings(RandomNumbers<uint64_t>& rn,std::size_t count) {
+  const std::vector<std::string> strings{"","a","edge.example.net",std::string(200,'x'),std::string("\0bin\xff",5)};
+  std::vector<std::pair<Path16,std::string>> pvs;
+  for (std::size_t i = 0; i < count; ++i) {
+    uint64_t bits = rn.next();
+    Path16 p{};
+    for (std::size_t b = 0; b < 16; ++b) { p.push_back((bits >> b) & 0x1); }
+    pvs.emplace_back(p,strings[(bits >> 32) % strings.size()]);
+  }
+  return pvs;
+}
+
+TEST(BinaryWORMValueCodecs, VarUInt) {
+  std::vector<uint64_t> values{0,1,0x7F,0x80,0x3FFF,0x4000,0xFFFFFFFF,0x1ULL << 63,~0ULL};
+  std::vector<std::size_t> sizes{1,1,1,2,2,3,5,10,10};
+  uint8_t buf[BinaryWORMVarUInt::MaxSize];
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(BinaryWORMReadWriteVarUInt::writeSize(&values[i]),sizes[i]);
+    ASSERT_EQ(BinaryWORMReadWriteVarUInt::write(&values[i],buf),sizes[i]);
+    ASSERT_EQ(BinaryWORMReadWriteVarUInt::readSize(buf),sizes[i]);
+    uint64_t v{0};
+    ASSERT_EQ(BinaryWORMReadWriteVarUInt::read(buf,&v),sizes[i]);
+    ASSERT_EQ(v,values[i]);
+  }
+}
+
+TEST(BinaryWORMValueCodecs, VarUIntTree) {
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.01};
+  for (float fillRatio : fillRatios) {
+    TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,fillRatio);
+    BinaryRadixTree32<uint32_t,16> tree{};
+    tsl.addToTree(tree.cursor());
+    BinaryWORMTreeVarUInt<std::vector<uint8_t>,Path16,true,4> worm{
+      buildBinaryWORMTreeBuffer<BinaryWORMNodeVarUIntWO<true,4>>(tree.cursorRO(),std::vector<uint8_t>{})};
+    ASSERT_EQ(tsl.checkTree(worm.cursorRO()),"OK");
+    ASSERT_EQ(tsl.checkTreeNewCursor([&worm](){ return worm.lookupCursorRO(); }),"OK");
+  }
+}
+
+TEST(BinaryWORMValueCodecs, StringTrees) {
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rn(seeds.next());
+  std::vector<std::pair<Path16,std::string>> pvs = randomStrings(rn,2000);
+  BinaryRadixTree32<std::string,16> tree{};
+  for (const auto& pv : pvs) {
+    auto c = tree.cursor();
+    cursorGoto(c,pv.first);
+    c.addNode().set(pv.second);
+  }
+  // Later duplicates of a path overwrite earlier ones
+  std::vector<std::pair<Path16,std::string>> expected;
+  for (auto pv = pvs.rbegin(); pv != pvs.rend(); ++pv) {
+    bool seen = false;
+    for (const auto& e : expected) { seen = seen || (e.first == pv->first); }
+    if (!seen) { expected.push_back(*pv); }
+  }
+
+  std::vector<uint8_t> bytesBuffer = buildBinaryWORMTreeBuffer<BinaryWORMNodeBytesWO<false,4>>(tree.cursorRO(),std::vector<uint8_t>{});
+  std::size_t bytesSize = bytesBuffer.size();
+  BinaryWORMTreeBytes<std::vector<uint8_t>,Path16,false,4> bytesTree{std::move(bytesBuffer)};
+  ASSERT_EQ(checkStrings(bytesTree,expected),"OK");
+
+  for (bool littleEndian : {true,false}) {
+    std::vector<uint8_t> refBuffer = littleEndian ?
+      buildBinaryWORMTreeStringRefBuffer<true,4,3>(tree.cursorRO(),std::vector<uint8_t>{}) :
+      buildBinaryWORMTreeStringRefBuffer<false,4,3>(tree.cursorRO(),std::vector<uint8_t>{});
+    // Every distinct string stored once, instead of once per node
+    ASSERT_LT(refBuffer.size(),bytesSize / 4);
+    if (littleEndian) {
+      BinaryWORMTreeStringRef<std::vector<uint8_t>,Path16,true,4,3> refTree{std::move(refBuffer)};
+      ASSERT_EQ(checkStrings(refTree,expected),"OK");
+    } else {
+      BinaryWORMTreeStringRef<std::vector<uint8_t>,Path16,false,4,3> refTree{std::move(refBuffer)};
+      ASSERT_EQ(checkStrings(refTree,expected),"OK");
+    }
+  }
+}
+
+TEST(BinaryWORMValueCodecs, StringTable) {
+  BinaryWORMStringTable table{};
+  ASSERT_EQ(table.add("ab"),0);
+  ASSERT_EQ(table.add(""),1);
+  ASSERT_EQ(table.add("ab"),0);
+  ASSERT_EQ(table.size(),2);
+  ASSERT_EQ(table.sectionSize(),4);
+  std::vector<uint8_t> section(table.sectionSize());
+  ASSERT_EQ(table.writeSection(section.data()),(std::vector<std::size_t>{0,3}));
+  ASSERT_EQ(section,(std::vector<uint8_t>{2,'a','b',0}));
+}
+
+TEST(BinaryWORMValueCodecs, Errors) {
+  BinaryRadixTree32<std::string,16> tree{};
+  auto c = tree.cursor();
+  c.goChild(1);
+  c.addNode().set("far");
+  // No table to write the string to
+  BinaryWORMNodeStringRefWO<true,4,1>::WriteValueType noTable{};
+  std::string v{"x"};
+  uint8_t buf[1];
+  ASSERT_THROW(noTable.write(&v,buf),std::runtime_error);
+  // Offsets past 1 byte refs
+  c.goParent();
+  c.goChild(0);
+  c.addNode().set(std::string(300,'y'));
+  ASSERT_THROW((buildBinaryWORMTreeStringRefBuffer<true,4,1>(tree.cursorRO(),std::vector<uint8_t>{})),std::runtime_error);
+  // One byte child offsets aren't enough for the inline strings
+  ASSERT_THROW((buildBinaryWORMTreeBuffer<BinaryWORMNodeBytesWO<true,1>>(tree.cursorRO(),std::vector<uint8_t>{})),std::runtime_error);
+}
@@ -0,0 +1,120 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "TestPath.h"
+#include "TreeTestUtils.h"
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "BinaryWORMTreeUInt.h"
+#include "BinaryWORMTreeUIntBuilder.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path = BinaryPath<16>;
+using Path16 = TestPath<2,16>;
+using PathVal16 = TestPathValue<Path16,uint32_t>;
+using SourceTree = BinaryRadixTree32<uint32_t,16>;
+
+// Covering value (+1, 0 if none) of every 16 bit path, looked up with the concrete cursor
+struct CoveringValues {
+  template <typename TreeT>
+  std::vector<uint64_t> operator()(const TreeT& tree) const {
+    std::vector<uint64_t> values;
+    for (uint32_t i = 0; i < 0x10000; ++i) {
+      Path p{};
+      for (std::size_t b = 0; b < 16; ++b) { p.push_back((i >> (15 - b)) & 0x1); }
+      auto c = tree.lookupCursorRO();
+      cursorGoto(c,p);
+      auto v = c.coveringNodeValueRO();
+      values.push_back(v.atValue() ? (static_cast<uint64_t>(*v.getPtrRO()) + 1) : 0);
+    }
+    return values;
+  }
+};
+
+// Same, through the generic (virtual) cursors
+std::vector<uint64_t> genericCoveringValues(const BinaryWORMTreeUIntGeneric<Path>& tree) {
+  std::vector<uint64_t> values;
+  for (uint32_t i = 0; i < 0x10000; ++i) {
+    Path p{};
+    for (std::size_t b = 0; b < 16; ++b) { p.push_back((i >> (15 - b)) & 0x1); }
+    auto c = tree.lookupCursorRO();
+    cursorGoto(c,p);
+    values.push_back(c.hasCoveringValue() ? (c.coveringValueCopy() + 1) : 0);
+  }
+  return values;
+}
+
+TEST(BinaryWORMVisit, MatchesGenericCursor) {
+  RandomSeeds seeds;
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathVal16> tsl = spotListFillSomeOfTree<PathVal16>(rnChoose,0.01);
+  SourceTree tree{};
+  tsl.addToTree(tree.cursor());
+  const BinaryWORMTreeUIntParams minParams = findMinimumWORMTreeUIntParameters(tree.cursorRO());
+  std::vector<BinaryWORMTreeUIntParams> allParams{
+    minParams,
+    {true,minParams.offsetSize,minParams.valueSize},
+    {false,minParams.offsetSize + 1,8},
+    {true,8,minParams.valueSize + 2}
+  };
+  for (const BinaryWORMTreeUIntParams& params : allParams) {
+    BinaryWORMTreeUIntGeneric<Path> worm = buildWORMTreeUIntGeneric(params,tree.cursorRO());
+    const std::vector<uint64_t> expected = genericCoveringValues(worm);
+    ASSERT_EQ(worm.visit(CoveringValues{}),expected);
+    ASSERT_EQ(visitBinaryWORMTreeUInt<Path>(params,worm.bytes(),worm.bytesSize(),CoveringValues{}),expected);
+  }
+}
+
+// Only counts the instantiation matching the tree it was built for
+struct ValueAt101 {
+  std::size_t* calls;
+  uint64_t operator()(const BinaryWORMTreeUInt<UnownedBufferRO,Path,true,2,1>& t) const {
+    ++(*calls);
+    auto l = t.lookupCursorRO();
+    cursorGoto(l,Path{1,0,1,1});
+    return static_cast<uint64_t>(*l.coveringNodeValueRO().getPtrRO());
+  }
+  template <typename TreeT>
+  uint64_t operator()(const TreeT&) const { return 0; }
+};
+
+TEST(BinaryWORMVisit, Dispatch) {
+  SourceTree tree{};
+  auto c = tree.cursor();
+  cursorGoto(c,Path{1,0,1});
+  c.addNode().set(7);
+  BinaryWORMTreeUIntGeneric<Path> worm = buildWORMTreeUIntGeneric(BinaryWORMTreeUIntParams{true,2,1},tree.cursorRO());
+  std::size_t calls{0};
+  ASSERT_EQ(worm.visit(ValueAt101{&calls}),7);
+  ASSERT_EQ(calls,1);
+  ASSERT_THROW(visitBinaryWORMTreeUInt<Path>(BinaryWORMTreeUIntParams{true,0,1},worm.bytes(),worm.bytesSize(),ValueAt101{&calls}),std::runtime_error);
+  ASSERT_THROW(visitBinaryWORMTreeUInt<Path>(BinaryWORMTreeUIntParams{true,2,9},worm.bytes(),worm.bytesSize(),ValueAt101{&calls}),std::runtime_error);
+  ASSERT_EQ(calls,1);
+}
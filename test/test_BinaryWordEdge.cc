@@ -27,6 +27,7 @@ SOFTWARE.
 #include "gtest/gtest.h"
 
 #include "../RadixTree/BinaryWordEdge.h"
+#include "../RadixTree/WordBlockAllocator.h"
 #include "PathEdgeTestUtils.h"
 #include "RandomUtils.h"
 #include "PathEdgeTests.h"
@@ -49,6 +50,47 @@ TEST(SimpleBinaryWordEdge64,RandomOps) {
 
 // XXX should test more binary word edge variants with leading/trailing space reserved
 
+// Standalone multi-word edges - small words so the edge spills over into
+// every extra word.
+TEST(BinaryMultiWordEdge16,RandomOps) {
+  using Edge = BinaryMultiWordEdgeRef<WordBlockVectorAllocator<uint16_t,6>,uint16_t,2,4>;
+  ASSERT_EQ(Edge::MaxDepth,41);
+  std::string testResult = pathRandomOps<Edge>(200000);
+  ASSERT_EQ(testResult,"OK");
+}
+
+TEST(BinaryMultiWordEdge64,RandomOps) {
+  using Edge = BinaryMultiWordEdgeRef<WordBlockVectorAllocator<uint64_t,5>,uint64_t,1,4>;
+  ASSERT_EQ(Edge::MaxDepth,119);
+  std::string testResult = pathRandomOps<Edge>(200000);
+  ASSERT_EQ(testResult,"OK");
+}
+
+TEST(BinaryMultiWordEdge32,Matching) {
+  using Edge = BinaryMultiWordEdgeRef<WordBlockVectorAllocator<uint32_t,6>,uint32_t,2,4>;
+  Edge a{};
+  Edge b{};
+  for (std::size_t i = 0; i < 80; ++i) {
+    a.push_back(i % 3 == 0);
+    b.push_back(i % 3 == 0);
+  }
+  ASSERT_TRUE(a == b);
+  ASSERT_EQ(a.matching(b),80);
+  b.pop_back();
+  ASSERT_FALSE(a == b);
+  ASSERT_TRUE(b.coveredby(a));
+  ASSERT_FALSE(a.coveredby(b));
+  // Mismatches in the info word, the first extra word and the second extra word.
+  for (std::size_t at : {5,40,70}) {
+    Edge c{a};
+    c.trim_back(c.size() - at);
+    c.push_back(a[at] ^ 0x1);
+    for (std::size_t i = at + 1; i < a.size(); ++i) { c.push_back(a[i]); }
+    ASSERT_EQ(c.matching(a),at);
+    ASSERT_EQ(a.matching(c),at);
+  }
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -32,6 +32,7 @@ SOFTWARE.
 
 #include "RandomUtils.h"
 #include "BinaryTestPath.h"
+#include "TestPath.h"
 //#include "PathEdgeTestUtils.h"
 #include "TreeTestUtils.h"
 #include "PathSort.h"
@@ -49,6 +50,7 @@ using FourWord32Node = BinaryWordNode<uint32_t,WordBlockVectorAllocator>;
 using FourWord64Node = BinaryWordNode<uint64_t,WordBlockVectorAllocator>;
 using ThreeWord64Node = CompactBinaryWordNode<uint32_t,uint64_t,WordBlockVectorAllocator>;
 using ThreeWord32Node = CompactBinaryWordNode<uint16_t,uint32_t,WordBlockVectorAllocator>;
+using TwoWord32Node = ImplicitLeftBinaryWordNode<uint16_t,uint32_t,WordBlockImplicitLeftAllocator>;
 
 
 template <std::size_t MaxDepth>
@@ -63,6 +65,12 @@ using ThreeWord64 = RadixTree<BinaryPath<MaxDepth>,ThreeWord64Node,SimpleFixedDe
 template <std::size_t MaxDepth>
 using ThreeWord32 = RadixTree<BinaryPath<MaxDepth>,ThreeWord32Node,SimpleFixedDepthStack>;
 
+template <std::size_t MaxDepth>
+using TwoWord32 = RadixTree<BinaryPath<MaxDepth>,TwoWord32Node,SimpleFixedDepthStack>;
+
+template <std::size_t MaxDepth>
+using SplitValue32 = RadixTree<BinaryPath<MaxDepth>,BinaryWordSplitValueNode<uint32_t,uint64_t>,SimpleFixedDepthStack>;
+
 using PathValue16 = TestPathValue<BinaryTestPath<16,uint16_t>,uint64_t>;
 using PathValue12 = TestPathValue<BinaryTestPath<12,uint16_t>,uint64_t>;
 
@@ -182,6 +190,46 @@ std::vector<bool> boolValues{false,
                              true,
                              false};
 
+TEST(SplitValueBinaryWordTree32, FillTest) {
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  auto newTree = [](){ return SplitValue32<12>{}; };
+  std::string result = fillEntireTree<PathValue12,SplitValue32<12>>(rn,4,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(SplitValueBinaryWordTree32, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.1};
+  auto newTree = [](){ return SplitValue32<16>{}; };
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<PathValue16,SplitValue32<16>>(rnShuffle,4,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+// Implicit left child nodes: before any compact() most left children are
+// spilled, so these exercise the spill table as much as the adjacent case.
+TEST(ImplicitLeftBinaryWordTree32, FillTest) {
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  auto newTree = [](){ return TwoWord32<12>{}; };
+  std::string result = fillEntireTree<PathValue12,TwoWord32<12>>(rn,4,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(ImplicitLeftBinaryWordTree32, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.1};
+  auto newTree = [](){ return TwoWord32<12>{}; };
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<PathValue12,TwoWord32<12>>(rnShuffle,4,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
 TEST(CompactBinaryWordTreeBool32, SimpleTest) {
   ThreeWordBool16 tree{};
   auto cursorRW = tree.cursor();
@@ -281,7 +329,7 @@ arrayValueWord32SimpleTest() {
     cursorGoto(cursorRO,wordArrayPaths.at(i));
     if (!cursorRO.atValue()) { return "No value at path: " + wordArrayPaths.at(i).toBinaryString(); }
     ValueType expectedValue = getExpectedArrayValue<ArrayValueWords>(i);
-    ValueType foundValue = *(cursorRO.nodeValueRO().getPtrRO());
+    const auto& foundValue = *(cursorRO.nodeValueRO().getPtrRO());
     if (foundValue != expectedValue) {
       std::string foundValueStr,expectedValueStr;
       for (std::size_t j=0;j<ArrayValueWords;++j) {
@@ -315,6 +363,279 @@ TEST(WordArrayNode32,SimpleTest) {
   ASSERT_EQ(result,"OK");
 }
 
+// Values are views of the node words: two reads see the same words,
+// and a view taken before an update sees the update.
+TEST(WordArrayNode32,ValueViewsNodeWords) {
+  ArrayWord32<4,16> arrayWordTree{};
+  BinaryPath16 p{1,0,1};
+  auto cursorRW = arrayWordTree.cursor();
+  cursorGoto(cursorRW,p);
+  cursorRW.addNode().set(getExpectedArrayValue<4>(0));
+
+  auto cursorRO = arrayWordTree.cursorRO();
+  cursorGoto(cursorRO,p);
+  auto valueRO = cursorRO.nodeValueRO();
+  ASSERT_FALSE(valueRO.ptrIsCopy());
+  const auto* view = valueRO.getPtrRO();
+  ASSERT_EQ(view->data(),cursorRO.nodeValueRO().getPtrRO()->data());
+  ASSERT_EQ(view->toArray(),getExpectedArrayValue<4>(0));
+
+  cursorGoto(cursorRW,p);
+  cursorRW.nodeValue().set(getExpectedArrayValue<4>(1));
+  ASSERT_EQ(*view,getExpectedArrayValue<4>(1));
+  ASSERT_THROW(view->at(4),std::out_of_range);
+}
+
+// Struct values, stored by reference in the value array.
+struct SplitTestValue {
+  uint32_t id{0};
+  uint16_t weight{0};
+  uint8_t flags{0};
+};
+
+TEST(SplitValueBinaryWordTree32, StructValues) {
+  RadixTree<BinaryPath16,BinaryWordSplitValueNode<uint32_t,SplitTestValue>,SimpleFixedDepthStack> tree{};
+  auto c = tree.cursor();
+  for (std::size_t i = 0; i < wordArrayPaths.size(); ++i) {
+    cursorGoto(c,wordArrayPaths.at(i));
+    c.addNode().set(SplitTestValue{static_cast<uint32_t>(i),static_cast<uint16_t>(10*i),0x5});
+  }
+  auto r = tree.cursorRO();
+  for (std::size_t i = 0; i < wordArrayPaths.size(); ++i) {
+    cursorGoto(r,wordArrayPaths.at(i));
+    ASSERT_TRUE(r.atValue());
+    auto v = r.nodeValueRO();
+    ASSERT_FALSE(v.ptrIsCopy());
+    ASSERT_EQ(v.getPtrRO()->id,i);
+    ASSERT_EQ(v.getPtrRO()->weight,10*i);
+  }
+  // updates through the RW pointer land in the value array
+  cursorGoto(c,wordArrayPaths.at(2));
+  c.nodeValue().getPtrRW()->flags = 0x7;
+  cursorGoto(r,wordArrayPaths.at(2));
+  ASSERT_EQ(r.nodeValueRO().getPtrRO()->flags,0x7);
+  ASSERT_EQ(tree.memoryStats().nodeBytes,3*sizeof(uint32_t) + sizeof(SplitTestValue));
+  ASSERT_EQ(tree.nodeAllocator().valueVector().size(),tree.memoryStats().nodeCount);
+}
+
+// Paged allocator: same trees, nodes held in fixed size pages
+
+using FourWord32PagedNode = BinaryWordNode<uint32_t,WordBlockPagedAllocator>;
+using ThreeWord32PagedNode = CompactBinaryWordNode<uint16_t,uint32_t,WordBlockPagedAllocator>;
+
+template <std::size_t MaxDepth>
+using FourWord32Paged = RadixTree<BinaryPath<MaxDepth>,FourWord32PagedNode,SimpleFixedDepthStack>;
+
+template <std::size_t MaxDepth>
+using ThreeWord32Paged = RadixTree<BinaryPath<MaxDepth>,ThreeWord32PagedNode,SimpleFixedDepthStack>;
+
+TEST(WordBlockPagedAllocator, RefsStayPut) {
+  using Alloc = WordBlockPagedAllocator<uint32_t,4>;
+  Alloc alloc;
+  std::vector<Alloc::RefType> refs;
+  std::vector<uint32_t*> ptrs;
+  for (std::size_t i = 0; i < 3*Alloc::PageChunkCount + 5; ++i) {
+    refs.push_back(alloc.newRef());
+    ptrs.push_back(alloc.getPtr(refs.back()));
+    ASSERT_EQ(ptrs.back()[0],0U);
+    ptrs.back()[0] = static_cast<uint32_t>(i);
+  }
+  ASSERT_EQ(alloc.pageCount(),4U);
+  ASSERT_EQ(alloc.chunkCount(),refs.size());
+  for (std::size_t i = 0; i < refs.size(); ++i) {
+    ASSERT_EQ(alloc.getPtr(refs[i]),ptrs[i]);
+    ASSERT_EQ(ptrs[i][0],i);
+  }
+
+  alloc.deleteRef(refs[7]);
+  ASSERT_EQ(alloc.unusedChunkCount(),1U);
+  ASSERT_EQ(alloc.newRef(),refs[7]);
+  ASSERT_EQ(ptrs[7][0],0U);
+  ASSERT_THROW(alloc.getPtr(static_cast<Alloc::RefType>(refs.size() + 1)),std::out_of_range);
+
+  Alloc reserved(static_cast<uint32_t>(Alloc::PageChunkCount + 1));
+  ASSERT_EQ(reserved.pageCount(),2U);
+  ASSERT_EQ(reserved.chunkCount(),0U);
+}
+
+TEST(PagedBinaryWordTree32, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.75,0.25};
+  auto newTree = [](){ return FourWord32Paged<12>{}; };
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<PathValue12,FourWord32Paged<12>>(rnShuffle,2,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+TEST(PagedCompactBinaryWordTree32, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.75,0.25};
+  auto newTree = [](){ return ThreeWord32Paged<12>{}; };
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<PathValue12,ThreeWord32Paged<12>>(rnShuffle,2,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+// Long edge nodes: 16 bit words keep the info word part of the edge short
+// (9 steps), so edges in a 12 deep tree already spill into the extra words.
+
+using LongEdge16Node = BinaryWordLongEdgeNode<uint16_t,2,WordBlockVectorAllocator>;
+using LongEdge32Node = BinaryWordLongEdgeNode<uint32_t,2,WordBlockVectorAllocator>;
+
+template <std::size_t MaxDepth>
+using LongEdge16 = RadixTree<BinaryPath<MaxDepth>,LongEdge16Node,SimpleFixedDepthStack>;
+
+template <std::size_t MaxDepth>
+using LongEdge32 = RadixTree<BinaryPath<MaxDepth>,LongEdge32Node,SimpleFixedDepthStack>;
+
+TEST(LongEdgeBinaryWordTree16, FillTest) {
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  auto newTree = [](){ return LongEdge16<12>{}; };
+  std::string result = fillEntireTree<PathValue12,LongEdge16<12>>(rn,4,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(LongEdgeBinaryWordTree16, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.1,0.02};
+  auto newTree = [](){ return LongEdge16<12>{}; };
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<PathValue12,LongEdge16<12>>(rnShuffle,4,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+// Sparse IPv6 style tree: a few /16s with long, mostly unshared runs below
+// them. Every run (at most 80 steps) fits in one 88 step edge, so no
+// scaffolding nodes are needed.
+TEST(LongEdgeBinaryWordTree32, SparseDeepPaths) {
+  using DeepPathValue = TestPathValue<TestPath<2,128>,uint64_t>;
+  RandomNumbers<uint64_t> rn(RandomSeeds::seed(2));
+  std::vector<DeepPathValue> spots{};
+  for (uint64_t i = 0; i < 200; ++i) {
+    std::vector<std::size_t> steps{};
+    const uint64_t slash16 = (0x2000 | (rn.next() % 4));
+    for (std::size_t b = 0; b < 16; ++b) { steps.push_back((slash16 >> (15 - b)) & 0x1); }
+    std::size_t len = 48 + (rn.next() % 49);
+    uint64_t bits = rn.next();
+    while (steps.size() < len) {
+      steps.push_back(bits & 0x1);
+      bits = ((bits >> 1) | (bits << 63));
+    }
+    spots.emplace_back(steps,i);
+  }
+  TreeSpotList<DeepPathValue> spotList(spots);
+
+  RandomNumbers<std::size_t> rnShuffle(RandomSeeds::seed(3));
+  std::string result = checkShuffleTreeWithAllCursors<DeepPathValue,LongEdge32<128>>(rnShuffle,2,spotList,[](){ return LongEdge32<128>{}; });
+  ASSERT_EQ(result,"OK");
+
+  LongEdge32<128> longTree{};
+  FourWord32<128> shortTree{};
+  spotList.addToTree(longTree.cursor());
+  spotList.addToTree(shortTree.cursor());
+  ASSERT_EQ(checkTreeWithAllCursors(spotList,&longTree),"OK");
+  // No scaffolding: at most a value node plus a branch node per spot, and the root.
+  ASSERT_LE(longTree.memoryStats().nodeCount,2*spots.size() + 1);
+  ASSERT_LT(longTree.memoryStats().nodeCount,shortTree.memoryStats().nodeCount);
+}
+
+// Compaction: churn a tree so the free list fills up and nodes get scattered,
+// then compact and make sure everything we kept is still there.
+template <typename TreeType>
+std::string compactAndCheck() {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathValue12> keep = spotListFillSomeOfTree<PathValue12>(rnChoose,0.3,10);
+  TreeSpotList<PathValue12> churn = spotListFillLayer<PathValue12>(12);
+  keep.shuffle(rnShuffle);
+
+  TreeType t;
+  churn.addToTree(t.cursor());
+  keep.addToTree(t.cursor());
+  auto c = t.cursor();
+  for (const PathValue12& spot : churn.treeSpots()) {
+    spot.setCursor(c);
+    if (!c.clearValue() || !c.removeNode()) { return "failed to remove churn node " + pathToString(spot); }
+  }
+  if (t.nodeAllocator().unusedChunkCount() == 0) { return "churn left no free chunks"; }
+
+  t.compact();
+  if (t.nodeAllocator().unusedChunkCount() != 0) { return "free chunks remain after compact"; }
+  // pre-order layout puts the root first
+  if (!t.cursorRO().atNode() || t.nodeAllocator().getPtr(1) == nullptr) { return "root not at first chunk"; }
+  std::string r = checkTreeWithAllCursors(keep,&t);
+  if (r != "OK") { return "[after compact] " + r; }
+
+  // still a regular mutable tree afterwards
+  churn.addToTree(t.cursor());
+  r = checkTreeWithAllCursors(churn,&t);
+  if (r != "OK") { return "[re-add after compact] " + r; }
+  return checkTreeWithAllCursors(keep,&t);
+}
+
+TEST(BinaryWordTree32, Compact) {
+  std::string result = compactAndCheck<FourWord32<12>>();
+  ASSERT_EQ(result,"OK");
+  FourWord32<12> t;
+  spotListFillLayer<PathValue12>(6).addToTree(t.cursor());
+  std::size_t liveWords = t.nodeAllocator().chunkVector().size();
+  t.compact();
+  ASSERT_EQ(t.nodeAllocator().chunkVector().size(),liveWords);
+  ASSERT_EQ(t.nodeAllocator().chunkVector().capacity(),liveWords);
+}
+
+TEST(CompactBinaryWordTree32, Compact) {
+  std::string result = compactAndCheck<ThreeWord32<12>>();
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(SplitValueBinaryWordTree32, Compact) {
+  std::string result = compactAndCheck<SplitValue32<12>>();
+  ASSERT_EQ(result,"OK");
+}
+
+// After compact() every left child sits in the chunk after its parent and
+// nothing is left in the spill table; inserts afterwards spill again.
+TEST(ImplicitLeftBinaryWordTree32, Compact) {
+  std::string result = compactAndCheck<TwoWord32<12>>();
+  ASSERT_EQ(result,"OK");
+
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathValue12> spots = spotListFillSomeOfTree<PathValue12>(rnChoose,0.2);
+  spots.shuffle(rnShuffle);
+  TwoWord32<12> t;
+  spots.addToTree(t.cursor());
+  ASSERT_GT(t.nodeAllocator().spilledCount(),0u);
+  t.compact();
+  ASSERT_EQ(t.nodeAllocator().spilledCount(),0u);
+  ASSERT_EQ(checkTreeWithAllCursors(spots,&t),"OK");
+  for (uint32_t ref = 1; ref <= t.memoryStats().nodeCount; ++ref) {
+    TwoWord32Node n{&t.nodeAllocator(),ref};
+    if (n.hasChild(0)) { ASSERT_TRUE(n.leftChildIsNext()); }
+  }
+  ASSERT_EQ(t.memoryStats().nodeBytes,2*sizeof(uint32_t));
+
+  TreeSpotList<PathValue12> more = spotListFillLayer<PathValue12>(12);
+  more.addToTree(t.cursor());
+  ASSERT_EQ(checkTreeWithAllCursors(more,&t),"OK");
+}
+
+TEST(PagedBinaryWordTree32, Compact) {
+  std::string result = compactAndCheck<FourWord32Paged<12>>();
+  ASSERT_EQ(result,"OK");
+}
 
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
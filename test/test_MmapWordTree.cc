@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include "RandomUtils.h"
+#include "BinaryTestPath.h"
+#include "TreeTestUtils.h"
+#include "PathSort.h"
+#include "TreeTests.h"
+
+#include "../RadixTree/WordBlockMmapAllocator.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using MmapTree32 = MmapBinaryWordTree<uint32_t,12>;
+using MmapCompactTree32 = MmapCompactBinaryWordTree<uint16_t,uint32_t,12>;
+using PathValue12 = TestPathValue<BinaryTestPath<12,uint16_t>,uint64_t>;
+
+// Scratch file removed when the test finishes
+class TempTreeFile {
+public:
+  TempTreeFile() {
+    char name[] = "/tmp/akamai-radixtree-mmap-XXXXXX";
+    int fd = mkstemp(name);
+    if (fd >= 0) { close(fd); }
+    path_ = name;
+  }
+  ~TempTreeFile() { unlink(path_.c_str()); }
+  const std::string& path() const { return path_; }
+private:
+  std::string path_;
+};
+
+template <typename TreeType>
+std::string reopenAndCheck() {
+  TempTreeFile f;
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  TreeSpotList<PathValue12> first = spotListFillSomeOfTree<PathValue12>(rnChoose,0.3,10);
+  TreeSpotList<PathValue12> second = spotListFillLayer<PathValue12>(12);
+  first.shuffle(rnShuffle);
+
+  std::size_t chunksUsed = 0;
+  {
+    TreeType t(f.path());
+    first.addToTree(t.cursor());
+    std::string r = checkTreeWithAllCursors(first,&t);
+    if (r != "OK") { return "[initial] " + r; }
+    t.nodeAllocator().sync();
+    chunksUsed = t.nodeAllocator().chunkCount();
+  }
+  {
+    TreeType t(f.path());
+    if (t.nodeAllocator().chunkCount() != chunksUsed) { return "chunk count changed on reopen"; }
+    if (t.memoryStats().valueNodeCount != first.treeSpots().size()) { return "value count lost on reopen"; }
+    std::string r = checkTreeWithAllCursors(first,&t);
+    if (r != "OK") { return "[reopen] " + r; }
+    // keep updating in place, enough to grow the file
+    second.addToTree(t.cursor());
+  }
+  {
+    TreeType t(f.path());
+    std::string r = checkTreeWithAllCursors(second,&t);
+    if (r != "OK") { return "[second reopen] " + r; }
+    r = checkTreeWithAllCursors(first,&t);
+    if (r != "OK") { return "[second reopen, first list] " + r; }
+    t.clear();
+    if (t.cursorRO().atValue()) { return "value at root after clear"; }
+  }
+  {
+    TreeType t(f.path());
+    if (t.nodeAllocator().chunkCount() != 1) { return "cleared tree not empty on reopen"; }
+    first.addToTree(t.cursor());
+    return checkTreeWithAllCursors(first,&t);
+  }
+}
+
+TEST(MmapBinaryWordTree32, Reopen) {
+  std::string result = reopenAndCheck<MmapTree32>();
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(MmapCompactBinaryWordTree32, Reopen) {
+  std::string result = reopenAndCheck<MmapCompactTree32>();
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(WordBlockMmapAllocator, FreeListPersists) {
+  using Alloc = WordBlockMmapAllocator<uint64_t,4>;
+  TempTreeFile f;
+  std::vector<Alloc::RefType> refs;
+  {
+    Alloc a(f.path());
+    for (std::size_t i = 0; i < 2*Alloc::MinChunkCapacity; ++i) {
+      refs.push_back(a.newRef());
+      a.getPtr(refs.back())[3] = i;
+    }
+    ASSERT_GE(a.chunkCapacity(),refs.size());
+    a.deleteRef(refs[5]);
+    a.deleteRef(refs[9]);
+    a.setRootRef(refs[1]);
+  }
+  Alloc a(f.path());
+  ASSERT_EQ(a.rootRef(),refs[1]);
+  ASSERT_EQ(a.unusedChunkCount(),2U);
+  ASSERT_EQ(a.getPtr(refs[100])[3],100U);
+  ASSERT_EQ(a.newRef(),refs[9]);
+  ASSERT_EQ(a.newRef(),refs[5]);
+  ASSERT_EQ(a.getPtr(refs[5])[3],0U);
+  ASSERT_EQ(a.unusedChunkCount(),0U);
+  ASSERT_THROW(a.getPtr(static_cast<Alloc::RefType>(refs.size() + 1)),std::out_of_range);
+}
+
+TEST(WordBlockMmapAllocator, LayoutMismatch) {
+  TempTreeFile f;
+  { WordBlockMmapAllocator<uint64_t,4> a(f.path()); }
+  ASSERT_THROW((WordBlockMmapAllocator<uint32_t,4>(f.path())),std::runtime_error);
+  ASSERT_THROW((WordBlockMmapAllocator<uint64_t,3>(f.path())),std::runtime_error);
+  ASSERT_THROW((WordBlockMmapAllocator<uint64_t,4>("/nonexistent-dir/tree")),std::system_error);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,368 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory_resource>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "RandomUtils.h"
+#include "TestPath.h"
+#include "BinaryTestPath.h"
+#include "TreeTestUtils.h"
+#include "PathSort.h"
+#include "TreeTests.h"
+
+#include "SimpleRadixTree.h"
+#include "BinaryRadixTree.h"
+#include "NodeAllocator.h"
+#include "NodeAllocatorPmr.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using SlabBinaryTree12 = SimpleRadixTreeSlab<uint64_t,2,12,4>;
+using BinaryPathValue12 = TestPathValue<TestPath<2,12>,uint64_t>;
+
+using SlabTerenaryTree7 = SimpleRadixTreeSlab<uint64_t,3,7,3>;
+using TerenaryPathValue7 = TestPathValue<TestPath<3,7>,uint64_t>;
+
+using SlabStringTree = BinaryRadixTree32<std::string,32,AllocatorSlab>;
+
+static_assert(AllocatorCanReleaseAll<SlabBinaryTree12::NodeAllocatorType>::value,"integer valued slab tree should release in bulk");
+static_assert(!AllocatorCanReleaseAll<SlabStringTree::NodeAllocatorType>::value,"string valued slab tree must walk to release");
+static_assert(!AllocatorCanReleaseAll<AllocatorNew<int>>::value,"AllocatorNew cannot release in bulk");
+
+TEST(AllocatorSlab, FreeListReuse) {
+  AllocatorSlab<uint64_t> alloc(4);
+  std::vector<AllocatorSlab<uint64_t>::RefType> refs;
+  for (uint64_t i = 0; i < 10; ++i) { refs.push_back(alloc.newRef(i)); }
+  ASSERT_EQ(alloc.slabCount(),3U);
+  ASSERT_EQ(alloc.liveCount(),10U);
+  for (uint64_t i = 0; i < 10; ++i) { ASSERT_EQ(*alloc.getPtr(refs[i]),i); }
+
+  // freed slots come back before any new slab is made
+  alloc.deleteRef(refs[3]);
+  alloc.deleteRef(refs[7]);
+  alloc.deleteRef(AllocatorSlab<uint64_t>::nullRef);
+  ASSERT_EQ(alloc.liveCount(),8U);
+  auto r1 = alloc.newRef();
+  auto r2 = alloc.newRef();
+  ASSERT_TRUE((r1 == refs[7] && r2 == refs[3]));
+  ASSERT_EQ(*alloc.getPtr(r1),0U);
+  ASSERT_EQ(alloc.slabCount(),3U);
+
+  AllocatorSlab<uint64_t> moved(std::move(alloc));
+  ASSERT_EQ(moved.liveCount(),10U);
+  ASSERT_EQ(alloc.slabCount(),0U);
+  ASSERT_EQ(*moved.getPtr(refs[9]),9U);
+
+  moved.releaseAll();
+  ASSERT_EQ(moved.slabCount(),0U);
+  ASSERT_EQ(moved.liveCount(),0U);
+}
+
+TEST(AllocatorSlab, BadSlabSize) {
+  ASSERT_THROW(AllocatorSlab<uint64_t>{0},std::invalid_argument);
+}
+
+TEST(SlabBinaryTree, FillTest) {
+  auto newTree = [](){ return SlabBinaryTree12{}; };
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  std::string result = fillEntireTree<BinaryPathValue12,SlabBinaryTree12>(rn,2,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(SlabBinaryTree, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  auto newTree = [](){ return SlabBinaryTree12{16}; };
+  std::vector<float> fillRatios{0.5,0.25,0.1};
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<BinaryPathValue12,SlabBinaryTree12>(rnShuffle,2,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+TEST(SlabTerenaryTree, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  auto newTree = [](){ return SlabTerenaryTree7{}; };
+  std::vector<float> fillRatios{0.5,0.1};
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<TerenaryPathValue7,SlabTerenaryTree7>(rnShuffle,2,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+TEST(SlabBinaryTree, ClearAndMove) {
+  TreeSpotList<BinaryPathValue12> spots = spotListFillTree<BinaryPathValue12>(8);
+  SlabBinaryTree12 t;
+  spots.addToTree(t.cursor());
+  ASSERT_EQ(spots.checkTree(t.cursorRO()),"OK");
+  ASSERT_GT(t.nodeAllocator().liveCount(),1U);
+
+  // bulk release leaves just a fresh root behind
+  t.clear();
+  ASSERT_EQ(t.nodeAllocator().liveCount(),1U);
+  ASSERT_EQ(t.nodeAllocator().slabCount(),1U);
+  ASSERT_FALSE(t.cursorRO().nodeValue().atValue());
+
+  spots.addToTree(t.cursor());
+  SlabBinaryTree12 t2(std::move(t));
+  ASSERT_EQ(spots.checkTree(t2.cursorRO()),"OK");
+  SlabBinaryTree12 t3;
+  t3 = std::move(t2);
+  ASSERT_EQ(spots.checkTree(t3.cursorRO()),"OK");
+}
+
+TEST(SlabStringTree, WalkingTeardown) {
+  SlabStringTree t;
+  auto c = t.lookupCursorWO();
+  c.goChild(1);
+  c.goChild(0);
+  c.goChild(1);
+  c.addNode();
+  c.nodeValue().set(std::string(64,'x'));
+  auto c2 = t.lookupCursorWO();
+  c2.goChild(0);
+  c2.addNode();
+  c2.nodeValue().set(std::string(64,'y'));
+  ASSERT_GT(t.nodeAllocator().liveCount(),1U);
+
+  t.clear();
+  ASSERT_EQ(t.nodeAllocator().liveCount(),1U);
+}
+
+TEST(AllocatorSlabIndex, FreeListReuse) {
+  AllocatorSlabIndex<uint64_t> alloc(2);
+  std::vector<AllocatorSlabIndex<uint64_t>::RefType> refs;
+  for (uint64_t i = 0; i < 10; ++i) { refs.push_back(alloc.newRef(i)); }
+  ASSERT_EQ(refs.front(),1U);
+  ASSERT_EQ(alloc.slabCount(),3U);
+  ASSERT_EQ(alloc.liveCount(),10U);
+  for (uint64_t i = 0; i < 10; ++i) { ASSERT_EQ(*alloc.getPtr(refs[i]),i); }
+
+  alloc.deleteRef(refs[3]);
+  alloc.deleteRef(refs[7]);
+  alloc.deleteRef(AllocatorSlabIndex<uint64_t>::nullRef);
+  ASSERT_EQ(alloc.liveCount(),8U);
+  ASSERT_EQ(alloc.memoryStats().freeNodeCount,2U);
+  auto r1 = alloc.newRef();
+  auto r2 = alloc.newRef();
+  ASSERT_TRUE((r1 == refs[7] && r2 == refs[3]));
+  ASSERT_EQ(*alloc.getPtr(r1),0U);
+  ASSERT_EQ(alloc.slabCount(),3U);
+
+  AllocatorSlabIndex<uint64_t> moved(std::move(alloc));
+  ASSERT_EQ(moved.liveCount(),10U);
+  ASSERT_EQ(alloc.slabCount(),0U);
+  ASSERT_EQ(*moved.getPtr(refs[9]),9U);
+
+  moved.releaseAll();
+  ASSERT_EQ(moved.slabCount(),0U);
+  ASSERT_EQ(moved.newRef(),1U);
+}
+
+TEST(AllocatorSlabIndex, BadSlabSize) {
+  ASSERT_THROW(AllocatorSlabIndex<uint64_t>{0},std::invalid_argument);
+  ASSERT_THROW(AllocatorSlabIndex<uint64_t>{25},std::invalid_argument);
+}
+
+using SlabIndexBinaryTree12 = SimpleRadixTreeSlabIndex<uint64_t,2,12,4>;
+using SlabIndexTerenaryTree7 = SimpleRadixTreeSlabIndex<uint64_t,3,7,3>;
+using SlabIndexWordTree12 = BinaryRadixTree32<uint64_t,12,AllocatorSlabIndex>;
+using SlabIndexWordPathValue12 = TestPathValue<BinaryTestPath<12,uint16_t>,uint64_t>;
+
+TEST(SlabIndexTree, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  auto newBinary = [](){ return SlabIndexBinaryTree12{4}; };
+  auto newTerenary = [](){ return SlabIndexTerenaryTree7{}; };
+  auto newWord = [](){ return SlabIndexWordTree12{}; };
+  std::vector<float> fillRatios{0.5,0.1};
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<BinaryPathValue12,SlabIndexBinaryTree12>(rnShuffle,2,rnChoose,fillRatio,newBinary);
+    ASSERT_EQ(result,"OK");
+    result = fillSomeOfTree<TerenaryPathValue7,SlabIndexTerenaryTree7>(rnShuffle,2,rnChoose,fillRatio,newTerenary);
+    ASSERT_EQ(result,"OK");
+    result = fillSomeOfTree<SlabIndexWordPathValue12,SlabIndexWordTree12>(rnShuffle,2,rnChoose,fillRatio,newWord);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+// 32 bit refs for the wide nodes that are mostly child array
+TEST(SlabIndexTree, NodeSize) {
+  using PtrImpl = SimpleTreeNodeImpl<26,uint64_t,4>;
+  using IndexImpl = SimpleTreeNodeImpl<26,uint64_t,4,AllocatorSlabIndex>;
+  ASSERT_EQ(sizeof(PtrImpl) - sizeof(IndexImpl),26*(sizeof(void*) - sizeof(uint32_t)));
+}
+
+// Stats are maintained incrementally - compare them against what we put in the tree
+template <typename TreeType,typename PathValueType>
+std::string checkMemoryStats() {
+  TreeSpotList<PathValueType> spots = spotListFillLayer<PathValueType>(5);
+  TreeType t;
+  MemoryStats ms = t.memoryStats();
+  if ((ms.nodeCount != 1) || (ms.valueNodeCount != 0) || (ms.scaffoldNodeCount != 1)) { return "empty tree stats wrong"; }
+
+  spots.addToTree(t.cursor());
+  ms = t.memoryStats();
+  if (ms.valueNodeCount != spots.treeSpots().size()) {
+    return "value count " + std::to_string(ms.valueNodeCount) + " expected " + std::to_string(spots.treeSpots().size());
+  }
+  if (ms.nodeCount != ms.valueNodeCount + ms.scaffoldNodeCount) { return "node count doesn't add up"; }
+  if (ms.bytesInUse != ms.nodeCount*ms.nodeBytes) { return "bytes in use wrong"; }
+  if (ms.bytesReserved < ms.bytesInUse) { return "reserved less than in use"; }
+
+  // overwriting a value doesn't change the count, clearing does
+  spots.addToTree(t.cursor());
+  if (t.memoryStats().valueNodeCount != spots.treeSpots().size()) { return "value count changed by overwrite"; }
+  auto c = t.cursor();
+  spots.treeSpots().front().setCursor(c);
+  c.clearValue();
+  c.removeNode();
+  ms = t.memoryStats();
+  if (ms.valueNodeCount != spots.treeSpots().size() - 1) { return "value count not decremented"; }
+
+  t.clear();
+  ms = t.memoryStats();
+  if ((ms.nodeCount != 1) || (ms.valueNodeCount != 0)) { return "cleared tree stats wrong"; }
+  return "OK";
+}
+
+using SimpleBinaryTree12 = SimpleRadixTree<uint64_t,2,12,4>;
+using WordTree12 = BinaryWordTree<uint64_t,12>;
+using PagedWordTree12 = PagedBinaryWordTree<uint64_t,12>;
+using CompactWordTree12 = CompactBinaryWordTree<uint16_t,uint32_t,12>;
+using BinaryPathValue12 = TestPathValue<TestPath<2,12>,uint64_t>;
+using WordPathValue12 = TestPathValue<BinaryTestPath<12,uint16_t>,uint64_t>;
+
+TEST(MemoryStats, AllTreeTypes) {
+  ASSERT_EQ((checkMemoryStats<SimpleBinaryTree12,BinaryPathValue12>()),"OK");
+  ASSERT_EQ((checkMemoryStats<SlabBinaryTree12,BinaryPathValue12>()),"OK");
+  ASSERT_EQ((checkMemoryStats<SlabIndexBinaryTree12,BinaryPathValue12>()),"OK");
+  ASSERT_EQ((checkMemoryStats<SimpleRadixTreeMap<uint64_t,2,12,4>,BinaryPathValue12>()),"OK");
+  ASSERT_EQ((checkMemoryStats<WordTree12,WordPathValue12>()),"OK");
+  ASSERT_EQ((checkMemoryStats<PagedWordTree12,WordPathValue12>()),"OK");
+  ASSERT_EQ((checkMemoryStats<CompactWordTree12,WordPathValue12>()),"OK");
+}
+
+TEST(MemoryStats, FreeSlots) {
+  AllocatorSlab<uint64_t> slab(8);
+  auto r1 = slab.newRef();
+  slab.newRef();
+  slab.deleteRef(r1);
+  MemoryStats ms = slab.memoryStats();
+  ASSERT_EQ(ms.nodeCount,1U);
+  ASSERT_EQ(ms.freeNodeCount,1U);
+  ASSERT_EQ(ms.nodeBytes,sizeof(uint64_t));
+  ASSERT_GE(ms.bytesReserved,8*sizeof(uint64_t));
+
+  WordBlockVectorAllocator<uint32_t,4> words;
+  auto w1 = words.newRef();
+  words.newRef();
+  words.deleteRef(w1);
+  ms = words.memoryStats();
+  ASSERT_EQ(ms.nodeCount,1U);
+  ASSERT_EQ(ms.freeNodeCount,1U);
+  ASSERT_EQ(ms.nodeBytes,4*sizeof(uint32_t));
+}
+
+// Resource that keeps track of what is outstanding
+class CountingResource : public std::pmr::memory_resource {
+public:
+  std::size_t outstandingBytes() const { return outstandingBytes_; }
+  std::size_t allocationCount() const { return allocationCount_; }
+private:
+  void* do_allocate(std::size_t bytes,std::size_t align) override {
+    outstandingBytes_ += bytes;
+    ++allocationCount_;
+    return std::pmr::new_delete_resource()->allocate(bytes,align);
+  }
+  void do_deallocate(void* p,std::size_t bytes,std::size_t align) override {
+    outstandingBytes_ -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p,bytes,align);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return (this == &o); }
+
+  std::size_t outstandingBytes_{0};
+  std::size_t allocationCount_{0};
+};
+
+using PmrStringTree = SimpleRadixTreePmr<std::pmr::string,4,6,2>;
+using PmrStringTreeMap = SimpleRadixTreeMapPmr<std::pmr::string,4,6,2>;
+using PmrBinaryTree12 = SimpleRadixTreePmr<uint64_t,2,12,4>;
+
+template <typename TreeType>
+std::string checkPmrStringTree() {
+  CountingResource res;
+  {
+    TreeType t(&res);
+    if (t.nodeAllocator().resource() != &res) { return "tree not using given resource"; }
+    std::vector<std::vector<std::size_t>> paths{{1,2,3},{1,2},{3,3,3,3,3,3},{0}};
+    for (const auto& p : paths) {
+      auto c = t.lookupCursorWO();
+      for (std::size_t step : p) { c.goChild(step); }
+      c.addNode();
+      c.nodeValue().set(std::pmr::string(100,static_cast<char>('a' + p.size())));
+    }
+    std::size_t nodeBytes = t.memoryStats().bytesInUse;
+    if (res.outstandingBytes() < nodeBytes + 4*100) { return "values not allocated from tree resource"; }
+
+    auto c = t.cursorRO();
+    for (std::size_t step : paths[0]) { c.goChild(step); }
+    if (!c.atValue()) { return "missing value"; }
+    const std::pmr::string& v = *(c.nodeValue().getPtrRO());
+    if (v != std::pmr::string(100,'d')) { return "wrong value"; }
+    if (v.get_allocator().resource() != &res) { return "value allocator doesn't use tree resource"; }
+  }
+  if (res.outstandingBytes() != 0) { return std::to_string(res.outstandingBytes()) + " bytes leaked"; }
+  return "OK";
+}
+
+TEST(AllocatorPmr, StringValues) {
+  ASSERT_EQ(checkPmrStringTree<PmrStringTree>(),"OK");
+  ASSERT_EQ(checkPmrStringTree<PmrStringTreeMap>(),"OK");
+}
+
+TEST(AllocatorPmr, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::pmr::unsynchronized_pool_resource pool;
+  auto newTree = [&pool](){ return PmrBinaryTree12{&pool}; };
+  std::vector<float> fillRatios{0.5,0.1};
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<BinaryPathValue12,PmrBinaryTree12>(rnShuffle,2,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
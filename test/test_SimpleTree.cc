@@ -51,6 +51,14 @@ using TerenaryPathValue10 = TestPathValue<TestPath<3,10>,uint64_t>;
 using SimpleQuatenaryTree7 = SimpleRadixTree<uint64_t,4,7,3>;
 using QuatenaryPathValue7 = TestPathValue<TestPath<4,7>,uint64_t>;
 
+using SimpleTerenaryTreeAdaptive10 = SimpleRadixTreeAdaptive<uint64_t,3,10,3>;
+using SimpleTree64Adaptive2 = SimpleRadixTreeAdaptive<uint64_t,64,2,1>;
+using PathValue64x2 = TestPathValue<TestPath<64,2>,uint64_t>;
+using SimpleTree256Adaptive2 = SimpleRadixTreeAdaptive<uint64_t,256,2,1>;
+using PathValue256x2 = TestPathValue<TestPath<256,2>,uint64_t>;
+using SimpleTerenaryTreeOutOfLine10 = SimpleRadixTree<OutOfLineValue<uint64_t>,3,10,3>;
+using SimpleTerenaryTreeMapOutOfLine10 = SimpleRadixTreeMap<OutOfLineValue<uint64_t>,3,10,3>;
+
 
 TEST(SimpleBinaryTree, FillTest) {
   auto newTree = [](){ return SimpleBinaryTree16{}; };
@@ -129,6 +137,139 @@ TEST(SimpleQuatenaryTree, FillSomeOfTest) {
   }
 }
 
+TEST(SimpleTerenaryTreeAdaptive, FillTest) {
+  auto newTree = [](){ return SimpleTerenaryTreeAdaptive10{}; };
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  std::string result = fillEntireTree<TerenaryPathValue10,SimpleTerenaryTreeAdaptive10>(rn,2,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+// Wide nodes go through every child layout on the way up and back down.
+TEST(SimpleTree64Adaptive, FillTest) {
+  auto newTree = [](){ return SimpleTree64Adaptive2{}; };
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  std::string result = fillEntireTree<PathValue64x2,SimpleTree64Adaptive2>(rn,2,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(SimpleTree256Adaptive, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  auto newTree = [](){ return SimpleTree256Adaptive2{}; };
+  std::vector<float> fillRatios{0.25,0.05};
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<PathValue256x2,SimpleTree256Adaptive2>(rnShuffle,1,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+TEST(AdaptiveChildArray, GrowAndShrink) {
+  AdaptiveChildArray<256,void*,nullptr> children{};
+  std::vector<std::size_t> keys(256);
+  for (std::size_t i = 0; i < keys.size(); ++i) { keys[i] = (i*97) % 256; }
+  auto refOf = [](std::size_t k) { return reinterpret_cast<void*>(k + 1); };
+  std::vector<std::size_t> expectCapacity{4,16,48,256};
+  std::size_t layout{0};
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(children.set(keys[i],refOf(keys[i])),nullptr);
+    if (children.size() > expectCapacity[layout]) { ++layout; }
+    ASSERT_EQ(children.capacity(),expectCapacity[layout]);
+    for (std::size_t j = 0; j <= i; ++j) { ASSERT_EQ(children.get(keys[j]),refOf(keys[j])); }
+  }
+  // Replacing doesn't change the count
+  ASSERT_EQ(children.set(keys[0],refOf(1000)),refOf(keys[0]));
+  ASSERT_EQ(children.size(),256);
+  ASSERT_EQ(children.set(keys[0],refOf(keys[0])),refOf(1000));
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(children.remove(keys[i]),refOf(keys[i]));
+    ASSERT_EQ(children.remove(keys[i]),nullptr);
+    for (std::size_t j = i + 1; j < keys.size(); ++j) { ASSERT_EQ(children.get(keys[j]),refOf(keys[j])); }
+  }
+  ASSERT_TRUE(children.empty());
+  ASSERT_EQ(children.capacity(),4);
+}
+TEST(ChildKeySearch, MatchesScalar) {
+  RandomNumbers<uint64_t> rn(RandomSeeds::seed(0));
+  std::array<uint8_t,16> keys{};
+  for (std::size_t round = 0; round < 2000; ++round) {
+    // Sorted, distinct keys with random garbage past count
+    const std::size_t count = round % 17;
+    std::vector<uint8_t> all(256);
+    for (std::size_t i = 0; i < all.size(); ++i) { all[i] = static_cast<uint8_t>(i); }
+    for (std::size_t i = 0; i < count; ++i) { std::swap(all[i],all[i + (rn.next() % (all.size() - i))]); }
+    std::sort(all.begin(),all.begin() + count);
+    for (std::size_t i = 0; i < keys.size(); ++i) { keys[i] = ((i < count) ? all[i] : static_cast<uint8_t>(rn.next())); }
+    for (std::size_t k = 0; k < 256; ++k) {
+      const uint8_t key = static_cast<uint8_t>(k);
+      const std::size_t expect = ChildKeySearch::findKeyScalar(keys.data(),count,key);
+      ASSERT_EQ(ChildKeySearch::findKey16(keys.data(),count,key),expect);
+      ASSERT_EQ(ChildKeySearch::lowerBound16(keys.data(),count,key),ChildKeySearch::lowerBoundScalar(keys.data(),count,key));
+      if (count <= 4) { ASSERT_EQ(ChildKeySearch::findKey4(keys.data(),count,key),expect); }
+    }
+  }
+}
+
+TEST(SimpleTerenaryTreeOutOfLine, FillTest) {
+  auto newTree = [](){ return SimpleTerenaryTreeOutOfLine10{}; };
+  RandomNumbers<std::size_t> rn(RandomSeeds::seed(0));
+  std::string result = fillEntireTree<TerenaryPathValue10,SimpleTerenaryTreeOutOfLine10>(rn,2,newTree);
+  ASSERT_EQ(result,"OK");
+}
+
+TEST(SimpleTerenaryTreeMapOutOfLine, FillSomeOfTest) {
+  RandomSeeds seeds;
+  RandomNumbers<std::size_t> rnShuffle(seeds.next());
+  RandomNumbers<uint64_t> rnChoose(seeds.next());
+  std::vector<float> fillRatios{0.5,0.1};
+  auto newTree = [](){ return SimpleTerenaryTreeMapOutOfLine10{}; };
+  for (float fillRatio : fillRatios) {
+    std::string result = fillSomeOfTree<TerenaryPathValue10,SimpleTerenaryTreeMapOutOfLine10>(rnShuffle,2,rnChoose,fillRatio,newTree);
+    ASSERT_EQ(result,"OK");
+  }
+}
+
+// Big values only cost a pointer in nodes without one.
+TEST(SimpleTreeOutOfLine, LargeValues) {
+  struct BigValue {
+    std::array<uint64_t,8> words{};
+    bool operator==(const BigValue& o) const { return (words == o.words); }
+  };
+  using InlineImpl = SimpleTreeNodeImpl<2,BigValue,4>;
+  using OutOfLineImpl = SimpleTreeNodeImpl<2,OutOfLineValue<BigValue>,4>;
+  static_assert(std::is_same<OutOfLineImpl::ValueType,BigValue>::value,"value type is the stored type");
+  ASSERT_LE(sizeof(OutOfLineImpl) + sizeof(BigValue),sizeof(InlineImpl) + sizeof(void*));
+
+  using Tree = SimpleRadixTree<OutOfLineValue<BigValue>,2,16,4>;
+  using Path = TestPath<2,16>;
+  Tree tree{};
+  std::vector<Path> paths{{1,0,1,1},{1,0,1},{0,0,1,1,0,1},{}};
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    auto c = tree.cursor();
+    cursorGoto(c,paths[i]);
+    BigValue v{};
+    v.words.fill(i);
+    c.addNode().set(v);
+  }
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    auto c = tree.cursorRO();
+    cursorGoto(c,paths[i]);
+    ASSERT_TRUE(c.atValue());
+    ASSERT_EQ(c.nodeValueRO().getPtrRO()->words[7],i);
+  }
+  // Clearing frees the value, the node itself stays
+  auto c = tree.cursor();
+  ASSERT_TRUE(c.atValue());
+  ASSERT_TRUE(c.clearValue());
+  ASSERT_FALSE(c.atValue());
+  ASSERT_EQ(c.nodeValueRO().getPtrRO(),nullptr);
+  cursorGoto(c,Path{1,0,1});
+  ASSERT_TRUE(c.clearValue());
+  ASSERT_FALSE(c.atValue());
+  auto r = tree.cursorRO();
+  cursorGoto(r,Path{1,0,1,1});
+  ASSERT_EQ(r.nodeValueRO().getPtrRO()->words[0],0);
+}
 
 
 int main(int argc, char** argv) {
@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2019 Akamai Technologies, Inc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#include "gtest/gtest.h"
+
+#include "RandomUtils.h"
+
+#include "BinaryRadixTree.h"
+#include "BinaryWORMTreeUInt.h"
+#include "BinaryWORMTreeUIntBuilder.h"
+#include "CursorOps.h"
+#include "ValueDictionary.h"
+
+using namespace Akamai::Mapper::RadixTree;
+
+using Path = BinaryPath<16>;
+using StringDictionary = ValueDictionary<std::string,uint16_t>;
+using IndexTree = CompactBinaryWordTree<uint16_t,uint32_t,16>;
+using IndexWORMTree = BinaryWORMTreeUInt<std::vector<uint8_t>,Path,true,4,2>;
+
+TEST(ValueDictionary, Intern) {
+  StringDictionary dict{};
+  ASSERT_TRUE(dict.empty());
+  ASSERT_EQ(dict.intern("alpha"),0);
+  ASSERT_EQ(dict.intern("beta"),1);
+  std::string alpha{"alpha"};
+  ASSERT_EQ(dict.intern(alpha),0);
+  ASSERT_EQ(dict.intern(std::string{"beta"}),1);
+  ASSERT_EQ(dict.size(),2);
+  uint16_t index{0};
+  ASSERT_TRUE(dict.find("beta",&index));
+  ASSERT_EQ(index,1);
+  ASSERT_FALSE(dict.find("gamma",&index));
+  ASSERT_EQ(dict.size(),2);
+  // References stay put as the dictionary grows.
+  const std::string* alphaPtr = &dict.at(0);
+  for (std::size_t i = 0; i < 1000; ++i) { dict.intern(std::to_string(i)); }
+  ASSERT_EQ(alphaPtr,&dict.at(0));
+  ASSERT_EQ(dict.at(dict.intern("500")),"500");
+  ASSERT_THROW(dict.at(5000),std::out_of_range);
+}
+
+TEST(ValueDictionary, IndexExhausted) {
+  ValueDictionary<uint32_t,uint8_t> dict{};
+  for (uint32_t i = 0; i < 256; ++i) { ASSERT_EQ(dict.intern(i*7),i); }
+  ASSERT_EQ(dict.intern(7),1);
+  ASSERT_THROW(dict.intern(1),std::length_error);
+  ASSERT_EQ(dict.size(),256);
+}
+
+// Store strings through the dictionary cursor, read them back through the plain
+// index tree, dictionary wrapped cursors and a WORM tree built from the indices.
+TEST(ValueDictionary, TreeValues) {
+  RandomNumbers<uint64_t> rn(RandomSeeds::seed(0));
+  const std::vector<std::string> names{"north-america","south-america","europe","asia","africa","oceania"};
+  std::vector<std::pair<Path,std::string>> spots{};
+  for (std::size_t i = 0; i < 400; ++i) {
+    const uint64_t bits = rn.next();
+    Path p{};
+    const std::size_t length = 4 + (bits % 13);
+    for (std::size_t d = 0; d < length; ++d) { p.push_back((bits >> (8 + d)) & 0x1); }
+    spots.emplace_back(p,names[(bits >> 32) % names.size()]);
+  }
+
+  StringDictionary dict{};
+  IndexTree tree{};
+  for (const auto& spot : spots) {
+    auto w = makeDictionaryCursor(tree.cursor(),&dict);
+    cursorGoto(w,spot.first);
+    w.addNode().set(spot.second);
+  }
+  ASSERT_LE(dict.size(),names.size());
+
+  // Later spots may have overwritten earlier ones on the same path.
+  auto expected = [&spots](const Path& p) {
+    const std::string* v{nullptr};
+    for (const auto& spot : spots) { if (spot.first == p) { v = &spot.second; } }
+    return v;
+  };
+
+  IndexWORMTree worm(buildBinaryWORMTreeUIntBuffer<true,4,2>(tree.cursorRO(),std::vector<uint8_t>{}));
+  const StringDictionary& constDict = dict;
+  for (const auto& spot : spots) {
+    const std::string* v = expected(spot.first);
+    auto r = makeDictionaryCursor(tree.cursorRO(),&constDict);
+    cursorGoto(r,spot.first);
+    ASSERT_TRUE(r.atValue());
+    auto nv = r.nodeValueRO();
+    ASSERT_FALSE(nv.ptrIsCopy());
+    ASSERT_EQ(nv.getPtrRO(),&dict.at(nv.index()));
+    ASSERT_EQ(*nv.getPtrRO(),*v);
+
+    auto c = tree.cursorRO();
+    cursorGoto(c,spot.first);
+    ASSERT_EQ(dict.at(*c.nodeValueRO().getPtrRO()),*v);
+
+    // Lookup cursors only report the covering value.
+    auto l = makeDictionaryCursor(tree.lookupCursorRO(),&constDict);
+    cursorGoto(l,spot.first);
+    ASSERT_EQ(l.coveringNodeValueRO().getPtrRO(),nv.getPtrRO());
+
+    auto wr = makeDictionaryCursor(worm.cursorRO(),&constDict);
+    cursorGoto(wr,spot.first);
+    ASSERT_TRUE(wr.atValue());
+    ASSERT_EQ(wr.nodeValueRO().getPtrRO(),nv.getPtrRO());
+    auto wl = makeDictionaryCursor(worm.lookupCursorRO(),&constDict);
+    cursorGoto(wl,spot.first);
+    ASSERT_EQ(*wl.coveringNodeValueRO().getPtrRO(),*v);
+  }
+
+  // Clearing a value leaves the shared entry alone.
+  auto w = makeDictionaryCursor(tree.cursor(),&dict);
+  cursorGoto(w,spots[0].first);
+  const std::string cleared = *w.nodeValueRO().getPtrRO();
+  ASSERT_TRUE(w.clearValue());
+  ASSERT_FALSE(w.atValue());
+  ASSERT_EQ(w.nodeValueRO().getPtrRO(),nullptr);
+  uint16_t index{0};
+  ASSERT_TRUE(dict.find(cleared,&index));
+}